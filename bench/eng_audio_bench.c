@@ -0,0 +1,185 @@
+/**
+ * bench/eng_audio_bench.c — エンジン全体のベンチマーク (JSON 出力)
+ *
+ * ヘッドレスのエンジンで次を測り、リリースごとに比べられるよう JSON で標準出力に書く。
+ *   mix:  SE ボイスを 1〜最大数鳴らしたときの 1 ブロックの時間とスループット
+ *         (ボイス × フレーム / 秒)
+ *   load: 素材の形式ごとの読込時間 (SE の同期読込 / 圧縮 SE / BGM のストリームを開く) と、
+ *         読み込んだ SE 1 つが持つメモリ
+ *
+ *   eng_audio_bench [-v 最大ボイス数] [-b ブロック長] [-n ブロック数] [-l 読込回数] [-f 素材]...
+ *
+ * 既定は 256 ボイスまで、480 フレーム (10ms) × 1000 ブロック、読込は 20 回の平均。
+ * 素材は 16bit / 32bit float の WAV (2 秒、ステレオ 44.1kHz) を作業ディレクトリに書き出して使い、
+ * 終了時に消す。WAV 以外 (OGG / MP3 / FLAC) は -f で既存のファイルを足す (繰り返し指定可)。
+ *
+ * Copyright (c) 2026 Reo Shiozawa — MIT License
+ */
+#include "eng_test_util.h"
+
+#define BENCH_RATE      48000
+#define BENCH_SRC_RATE  44100
+#define BENCH_SECONDS   2
+#define BENCH_MAX_FILES 16
+
+typedef struct {
+    const char* name;
+    const char* path;
+    bool        generated; /* 終了時に消す */
+} BenchFile;
+
+#define BENCH_USAGE "eng_audio_bench [-v 最大ボイス数] [-b ブロック長] [-n ブロック数] [-l 読込回数] [-f 素材]..."
+
+/* 左 440Hz / 右 660Hz の正弦波 */
+static double bench_wave(uint32_t i, uint32_t ch, void* user) {
+    (void)user;
+    return 0.25 * sin(ENG_TEST_TAU * (ch ? 660.0 : 440.0) * (double)i / BENCH_SRC_RATE);
+}
+
+/* ステレオの WAV を書き出す。float=true で 32bit float。 */
+static int write_wav(const char* path, bool is_float) {
+    return eng_test_write_wav(path, BENCH_SRC_RATE, 2, BENCH_SRC_RATE * BENCH_SECONDS, is_float, bench_wave, NULL);
+}
+
+static ENG_Audio* open_engine(uint32_t queue, uint64_t cache_budget) {
+    ENG_AudioConfig cfg = eng_audio_config_default();
+    cfg.no_device          = true;
+    cfg.sample_rate        = BENCH_RATE;
+    cfg.channels           = 2;
+    cfg.command_queue_size = queue;
+    cfg.cache_budget       = cache_budget;
+    return eng_audio_create_ex(&cfg);
+}
+
+/* ── mix ────────────────────────────────────────────────*/
+static int bench_mix(const char* wav, uint32_t max_voices, uint32_t block, uint32_t blocks) {
+    ENG_Audio*  a   = open_engine(max_voices * 2 + 64, 0);
+    ENG_SoundID id  = a ? eng_se_load(a, wav) : 0;
+    float*      out = malloc(sizeof(float) * block * 2);
+    if (!id || !out || !eng_se_set_voices(a, id, max_voices, ENG_STEAL_OLDEST)) {
+        fprintf(stderr, "[eng_audio_bench] mix の初期化失敗\n");
+        free(out);
+        eng_audio_destroy(a);
+        return 0;
+    }
+    eng_se_set_loop(a, id, true);
+    double block_ns = (double)block * 1e9 / BENCH_RATE;
+    double idle     = eng_test_run(a, out, block, blocks, 20);
+    printf("  \"mix\": {\n");
+    printf("    \"block_frames\": %u, \"blocks\": %u, \"idle_ns_per_block\": %.0f,\n", block, blocks, idle);
+    printf("    \"cases\": [\n");
+    uint32_t playing = 0;
+    for (uint32_t v = 1; v <= max_voices; v *= 4) {
+        for (; playing < v; ++playing) eng_se_play(a, id);
+        double ns = eng_test_run(a, out, block, blocks, 20);
+        printf("      { \"voices\": %u, \"ns_per_block\": %.0f, \"ns_per_voice\": %.1f, "
+               "\"voice_frames_per_sec\": %.0f, \"realtime_percent\": %.3f }%s\n",
+               v, ns, (ns - idle) / (double)v, (double)v * block * 1e9 / ns, 100.0 * ns / block_ns,
+               v * 4 <= max_voices ? "," : "");
+    }
+    printf("    ]\n  },\n");
+    free(out);
+    eng_audio_destroy(a);
+    return 1;
+}
+
+/* ── load ───────────────────────────────────────────────*/
+/* loads 回読み込んで解放し、1 回あたりの時間 (マイクロ秒) を返す。mem には最後の 1 回のメモリ。 */
+static double time_se_load(ENG_Audio* a, const char* path, uint32_t flags, uint32_t loads, ENG_SoundMemory* mem) {
+    ENG_LoadParams p;
+    memset(&p, 0, sizeof(p));
+    p.bus   = ENG_BUS_SE;
+    p.flags = flags;
+    double total = 0.0;
+    for (uint32_t i = 0; i < loads; ++i) {
+        double      t0 = eng_test_now_ns();
+        ENG_SoundID id = eng_se_load_ex(a, path, &p);
+        total += eng_test_now_ns() - t0;
+        if (!id) return -1.0;
+        if (i + 1 == loads) eng_se_get_memory(a, id, mem);
+        eng_se_free(a, id);
+    }
+    return total / loads / 1000.0;
+}
+
+static double time_bgm_load(ENG_Audio* a, const char* path, uint32_t loads) {
+    double total = 0.0;
+    for (uint32_t i = 0; i < loads; ++i) {
+        double      t0 = eng_test_now_ns();
+        ENG_SoundID id = eng_bgm_load(a, path);
+        total += eng_test_now_ns() - t0;
+        if (!id) return -1.0;
+        eng_bgm_free(a, id);
+    }
+    return total / loads / 1000.0;
+}
+
+static int bench_load(const BenchFile* files, uint32_t count, uint32_t loads) {
+    /* キャッシュを 0 にして毎回デコードし直させる (既定の上限が変わってもキャッシュの当たりを測らない) */
+    ENG_Audio* a = open_engine(0, 0);
+    if (!a) return 0;
+    printf("  \"load\": [\n");
+    int ok = 1;
+    for (uint32_t i = 0; i < count; ++i) {
+        ENG_SoundMemory full, comp;
+        memset(&full, 0, sizeof(full));
+        memset(&comp, 0, sizeof(comp));
+        double se   = time_se_load(a, files[i].path, 0, loads, &full);
+        double enc  = time_se_load(a, files[i].path, ENG_LOAD_FLAG_COMPRESSED, loads, &comp);
+        double bgm  = time_bgm_load(a, files[i].path, loads);
+        if (se < 0.0 || enc < 0.0 || bgm < 0.0) {
+            fprintf(stderr, "[eng_audio_bench] 読み込めない: %s\n", files[i].path);
+            ok = 0;
+        }
+        printf("    { \"format\": \"%s\", \"se_load_us\": %.1f, \"se_bytes\": %llu, "
+               "\"compressed_load_us\": %.1f, \"compressed_bytes\": %llu, \"bgm_open_us\": %.1f }%s\n",
+               files[i].name, se, (unsigned long long)full.decoded_bytes, enc,
+               (unsigned long long)(comp.encoded_bytes + comp.decoded_bytes), bgm, i + 1 < count ? "," : "");
+    }
+    printf("  ],\n");
+    eng_audio_destroy(a);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    uint32_t  max_voices = 256, block = 480, blocks = 1000, loads = 20;
+    BenchFile files[BENCH_MAX_FILES] = {
+        { "wav_s16", "eng_audio_bench_s16.wav", true },
+        { "wav_f32", "eng_audio_bench_f32.wav", true },
+    };
+    uint32_t nfiles = 2;
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (a[0] != '-' || !a[1] || a[2] || i + 1 >= argc) eng_test_usage(BENCH_USAGE);
+        const char* arg = argv[++i];
+        if (a[1] == 'f') {
+            if (nfiles == BENCH_MAX_FILES) eng_test_usage(BENCH_USAGE);
+            const char* ext = strrchr(arg, '.');
+            files[nfiles++] = (BenchFile){ ext ? ext + 1 : arg, arg, false };
+            continue;
+        }
+        uint32_t v = (uint32_t)strtoul(arg, NULL, 10);
+        switch (a[1]) {
+        case 'v': max_voices = v; break;
+        case 'b': block = v; break;
+        case 'n': blocks = v; break;
+        case 'l': loads = v; break;
+        default:  eng_test_usage(BENCH_USAGE);
+        }
+    }
+    if (max_voices == 0 || block == 0 || blocks == 0 || loads == 0) eng_test_usage(BENCH_USAGE);
+
+    if (!write_wav(files[0].path, false) || !write_wav(files[1].path, true)) {
+        fprintf(stderr, "[eng_audio_bench] 素材を書き出せない\n");
+        return 1;
+    }
+    printf("{\n");
+    printf("  \"engine\": { \"sample_rate\": %u, \"channels\": 2, \"source_rate\": %u, \"source_seconds\": %u },\n",
+           BENCH_RATE, BENCH_SRC_RATE, BENCH_SECONDS);
+    int ok = bench_mix(files[0].path, max_voices, block, blocks);
+    ok &= bench_load(files, nfiles, loads);
+    printf("  \"ok\": %s\n}\n", ok ? "true" : "false");
+    for (uint32_t i = 0; i < nfiles; ++i)
+        if (files[i].generated) remove(files[i].path);
+    return ok ? 0 : 1;
+}
@@ -16,27 +16,477 @@ extern "C" {
 
 /* ── 型定義 ─────────────────────────────────────────────*/
 typedef struct ENG_Audio ENG_Audio;
-typedef uint32_t ENG_SoundID; /* 0 = 無効 */
+/*
+ * 0 = 無効。下位 20 ビットがスロット番号、上位 11 ビットが世代なので常に 2^31 未満。
+ * 解放すると世代が進み、同じスロットが再利用されても古い ID は無効として扱われる。
+ */
+typedef uint32_t ENG_SoundID;
+
+/** SE の同時発音数が上限に達したときの動作。 */
+typedef enum {
+    ENG_STEAL_OLDEST   = 0, /* 最も古く鳴り始めたボイスを止めて再利用 (既定) */
+    ENG_STEAL_QUIETEST = 1, /* 最も音量の小さいボイスを止めて再利用 */
+    ENG_STEAL_NONE     = 2, /* 新しい発音を捨てる */
+} ENG_StealMode;
+
+/**
+ * リサンプラの品質。どれも線形補間で、折り返しを抑えるローパスの次数で重さを選ぶ。
+ * ENG_RESAMPLE_ORDER(n) で次数 0〜8 を直接指定できる (次数が高いほど重く、高域がきれいになる)。
+ */
+#define ENG_RESAMPLE_ORDER(n) ((uint32_t)(n) + 1u)
+enum {
+    ENG_RESAMPLE_DEFAULT = 0,                     /* 読込時は 4 次、ピッチ用はローパスなし */
+    ENG_RESAMPLE_LINEAR  = ENG_RESAMPLE_ORDER(0), /* ローパスなし (最も軽い) */
+    ENG_RESAMPLE_HIGH    = ENG_RESAMPLE_ORDER(8), /* 8 次 (最も重い) */
+};
+
+/** エンジン生成設定。eng_audio_config_default() で初期化してから変更する。 */
+typedef struct {
+    uint32_t    sample_rate;   /* 0 = デバイス既定 (ヘッドレス時と async_device 時は 48000) */
+    uint32_t    channels;      /* 0 = デバイス既定 (ヘッドレス時と async_device 時は 2) */
+    bool        no_device;     /* true: 再生デバイスを開かない (eng_audio_render で引き出す) */
+    uint32_t    period_frames; /* 周期サイズ (フレーム)。0 = period_ms を使う */
+    uint32_t    period_ms;     /* 周期サイズ (ミリ秒)。両方 0 なら低遅延プロファイルの既定値 */
+    uint32_t    periods;       /* 周期数。0 = バックエンド既定 */
+    const char* backend;       /* "wasapi" "coreaudio" "alsa" "pulseaudio" "null" など。NULL = 自動 */
+    bool        exclusive;     /* 排他モードを要求 (使えなければ共有モードで開く) */
+    uint32_t    command_queue_size; /* コマンドキュー容量 (2 の累乗に切り上げ)。0 = 4096 */
+    uint32_t    loader_threads;     /* 読込ジョブスレッド数。0 = 1 (ヘッドレス時は使わない) */
+    uint64_t    cache_budget;       /* 未使用の SE デコード済みデータを残しておく上限 (バイト)。0 = 残さない */
+    float       cull_gain;          /* 実効音量がこれ未満のまま cull_ms 続いた発音を止める。0 = 止めない */
+    uint32_t    cull_ms;            /* 0 = 200 */
+    uint32_t    max_voices;         /* 実際に鳴らす SE ボイスの上限 (超えた分は仮想化)。0 = 無制限 */
+    float       spatial_lod_distance; /* これより遠い 3D の SE は簡易定位で鳴らす。0 = 切り替えない */
+    uint32_t    load_resample;      /* 読込時にエンジンのレートへ変換するときの品質 (ENG_RESAMPLE_*) */
+    uint32_t    pitch_resample;     /* ピッチ・ドップラー用リサンプラの品質 (ENG_RESAMPLE_*) */
+    uint32_t    decode_ahead_ms;    /* 圧縮 SE の先読み (ミリ秒)。0 = 100 */
+    bool        async_device;       /* true: 再生デバイスを裏のスレッドで開き、待たずに返る (下記) */
+} ENG_AudioConfig;
+
+/** 非同期読込の状態。 */
+typedef enum {
+    ENG_LOAD_NONE    = 0, /* 無効な ID */
+    ENG_LOAD_PENDING = 1, /* 読込中 (SE はまだ鳴らない) */
+    ENG_LOAD_READY   = 2, /* 再生可能 */
+    ENG_LOAD_FAILED  = 3, /* 読込失敗 (ID は削除するまで有効) */
+} ENG_LoadState;
+
+/** ミキサーバス。全てマスターの直下にある。 */
+typedef enum {
+    ENG_BUS_BGM   = 0, /* eng_bgm_load の既定 */
+    ENG_BUS_SE    = 1, /* eng_se_load の既定 */
+    ENG_BUS_VOICE = 2,
+    ENG_BUS_UI    = 3,
+    ENG_BUS_COUNT
+} ENG_Bus;
+
+/** 読込フラグ。 */
+enum {
+    ENG_LOAD_FLAG_ASYNC      = 1u << 0, /* *_load_async と同じ */
+    ENG_LOAD_FLAG_COMPRESSED = 1u << 1, /* SE: 圧縮したまま持ち、発音ごとにデコードする (eng_se_load_ex 参照) */
+};
+
+/** *_load_ex の引数。 */
+typedef struct {
+    ENG_Bus  bus;             /* 出力先のバス */
+    uint32_t flags;           /* ENG_LOAD_FLAG_* */
+    uint32_t decode_ahead_ms; /* ENG_LOAD_FLAG_COMPRESSED の先読み (ミリ秒)。0 = 生成設定の decode_ahead_ms */
+} ENG_LoadParams;
+
+/** 実際に確定した再生デバイスの設定。 */
+typedef struct {
+    const char* backend;       /* バックエンド名 */
+    uint32_t    sample_rate;   /* デバイス側のサンプルレート */
+    uint32_t    channels;      /* デバイス側のチャンネル数 */
+    uint32_t    period_frames; /* 周期サイズ (デバイス側フレーム) */
+    uint32_t    periods;       /* 周期数 */
+    bool        exclusive;     /* 排他モードで開けたか */
+    float       latency_ms;    /* period_frames * periods から求めたバッファ遅延 */
+    uint32_t    reopens;       /* 失ったデバイスを開き直した回数 */
+    uint32_t    reroutes;      /* バックエンドが既定のデバイスの変更に追従した回数 */
+} ENG_AudioDeviceInfo;
+
+/** 再生デバイスの状態。 */
+typedef enum {
+    ENG_DEVICE_NONE    = 0, /* ヘッドレス */
+    ENG_DEVICE_OPENING = 1, /* 開いている途中 */
+    ENG_DEVICE_RUNNING = 2, /* 再生中 */
+    ENG_DEVICE_LOST    = 3, /* 開けない (抜かれた等)。一定間隔で既定のデバイスを開き直す */
+} ENG_DeviceState;
 
 /* ── ライフサイクル ─────────────────────────────────────*/
 
+/** 既定値の設定を返す。 */
+ENG_AudioConfig eng_audio_config_default(void);
+
 /** 音声エンジン初期化。成功時はポインタ、失敗時は NULL を返す。 */
 ENG_Audio* eng_audio_create(void);
 
+/** 設定付きで音声エンジンを初期化する。cfg=NULL は既定値。 */
+ENG_Audio* eng_audio_create_ex(const ENG_AudioConfig* cfg);
+
 /** 音声エンジンを破棄し全リソースを解放する。 */
 void       eng_audio_destroy(ENG_Audio* a);
 
+/**
+ * ヘッドレス (no_device) エンジンから frames フレームをミックスして out に書き込む。
+ * out はインターリーブ f32 で frames * channels 要素以上。実時間を待たずに返る。
+ * 戻り値: 書き込んだフレーム数 (デバイス付きエンジンでは 0)。
+ */
+uint64_t   eng_audio_render(ENG_Audio* a, float* out, uint64_t frames);
+
+/** エンジンのサンプルレート。 */
+uint32_t   eng_audio_sample_rate(ENG_Audio* a);
+
+/** エンジンの出力チャンネル数。 */
+uint32_t   eng_audio_channels(ENG_Audio* a);
+
+/**
+ * エンジン時刻 (ミックス済みフレーム数, サンプルレートは eng_audio_sample_rate)。
+ * *_at 系の予約時刻はこの時計で指定する。
+ */
+uint64_t   eng_audio_time_frames(ENG_Audio* a);
+
+/** 確定したデバイス設定を取得する。ヘッドレス時とデバイスが再生中でないときは false。 */
+bool       eng_audio_get_device_info(ENG_Audio* a, ENG_AudioDeviceInfo* out);
+
+/** 確定した出力バッファ遅延 (ミリ秒)。ヘッドレス時は 0。 */
+float      eng_audio_latency_ms(ENG_Audio* a);
+
+/*
+ * 再生デバイスは裏のスレッドが見張る。デバイスが止まったら (USB ヘッドセットを抜いた等)
+ * 同じ設定で既定のデバイスを開き直す。エンジンとサウンドはそのままなので、
+ * 読み込み直しもデコードし直しもない。デバイスがない間はミックスが進まず、
+ * 再生位置・フェード・予約時刻もそこで止まる。既定のデバイスの切り替えは、
+ * 追従できるバックエンド (WASAPI / Core Audio 等) ではその場で切り替わる (reroutes)。
+ *
+ * async_device=true のときは生成時にデバイスを開かず、このスレッドが開く。
+ * バックエンドの列挙とデバイスを開く時間を待たずに読込を始められる。
+ * エンジンはデバイスの既定値ではなく sample_rate / channels (0 なら 48000 / 2) で組み、
+ * デバイスの形式との違いは miniaudio が変換する。開けるまでは ENG_DEVICE_OPENING、
+ * 開けなければ ENG_DEVICE_LOST になって開き直しを続ける (生成は失敗しない)。
+ */
+
+/** 再生デバイスの状態。 */
+ENG_DeviceState eng_audio_device_state(ENG_Audio* a);
+
+/** デバイスが再生を始めるまで最大 timeout_ms 待つ。戻り値: 再生中か。 */
+bool       eng_audio_wait_device(ENG_Audio* a, uint32_t timeout_ms);
+
+/** 今のデバイスを閉じて既定のデバイスを開き直すよう頼む (待たずに返る)。ヘッドレス時は false。 */
+bool       eng_audio_reopen_device(ENG_Audio* a);
+
+/* ── コマンドキュー ─────────────────────────────────────*/
+/*
+ * 再生制御とパラメータ変更 (play/stop/音量/パン/ピッチ/ループ/フェード等) は
+ * ロックフリーのリングに積まれ、オーディオスレッドが次のミックスブロックの
+ * 境界で適用する。状態の取得 (再生中か・位置など) への反映もそれ以降になる。
+ * 呼び出しは単一スレッド (スクリプトスレッド) から行うこと。
+ */
+
+/** コマンドキューの使用状況。 */
+typedef struct {
+    uint32_t capacity;   /* 容量 */
+    uint32_t pending;    /* 未適用の件数 */
+    uint32_t high_water; /* 同時に積まれた最大件数 */
+    uint32_t overflows;  /* 満杯になり呼び出し側で吐き出した回数 */
+} ENG_QueueStats;
+
+/**
+ * バッチ開始。eng_audio_batch_end までの変更は同じブロックでまとめて適用される。
+ * 入れ子可。
+ */
+void eng_audio_batch_begin(ENG_Audio* a);
+
+/** バッチ終了。積んだ変更をオーディオスレッドに公開する。 */
+void eng_audio_batch_end(ENG_Audio* a);
+
+/** コマンドキューの使用状況を取得する。 */
+void eng_audio_get_queue_stats(ENG_Audio* a, ENG_QueueStats* out);
+
+/* ── 計測 ───────────────────────────────────────────────*/
+/*
+ * オーディオスレッドがミックス (デバイスのコールバック、ヘッドレス時は render の
+ * 1 チャンク) ごとに、ロックを取らずに書き込む計測値。取得は読むだけなので、
+ * 項目同士は同じ瞬間の値とは限らない。
+ */
+typedef struct {
+    uint64_t callbacks;     /* 計測したミックスの回数 */
+    float    mix_min_us;    /* ミックス 1 回にかかった時間 (マイクロ秒) */
+    float    mix_avg_us;
+    float    mix_p99_us;    /* 99 パーセンタイル (1/4 オクターブ刻みのヒストグラムの区間の上端) */
+    float    mix_max_us;
+    float    load;          /* ミックス時間 ÷ 出力した音の長さ (直近の指数平均。1.0 以上は間に合っていない) */
+    float    load_peak;     /* load の最大 */
+    uint64_t xruns;         /* 出力が途切れたと推定した回数 (ミックスが出力の長さを超えた、
+                               またはコールバックの間隔が空きすぎた)。ヘッドレス時は 0 */
+    uint32_t voices;        /* 鳴っている BGM と SE ボイス (予約中を含む。仮想化中は除く) */
+    uint32_t voices_peak;
+    uint32_t voices_virtual; /* 発音数の上限で仮想化されている SE ボイス */
+    uint64_t voices_culled; /* 無音停止で止めた発音の累計 */
+    uint64_t stream_stalls; /* BGM と圧縮 SE のデコードが間に合わず、読み出しが途中で無音になった回数 */
+    uint32_t jobs_pending;  /* 読込・ストリーミングのジョブキューにある件数 (処理中を含む) */
+} ENG_AudioStats;
+
+/** 計測値を取得する。 */
+void eng_audio_get_stats(ENG_Audio* a, ENG_AudioStats* out);
+
+/** 計測値を 0 に戻す。次のミックスから反映される。 */
+void eng_audio_reset_stats(ENG_Audio* a);
+
+/* ── 録音 ───────────────────────────────────────────────*/
+/*
+ * 最終出力 (マスター音量・マスターの解析の後、デバイスに渡す直前) を WAV に書き出す。
+ * オーディオスレッドはロックフリーのリングに写すだけで、ファイルへは録音ごとの
+ * 書き出しスレッドがまとめて書く。ディスクが遅れてリングが溢れた分は捨てて数える
+ * (オーディオスレッドはディスクを待たない)。
+ * ヘッドレス時はスレッドを持たず、eng_audio_render の中で書く (捨てるフレームは出ない)。
+ */
+#define ENG_RECORD_BUFFER_MS_DEFAULT 2000
+
+/** eng_audio_record_start_ex の引数。 */
+typedef struct {
+    uint32_t buffer_ms; /* リングの長さ (ミリ秒)。0 = 2000 */
+    bool     pcm16;     /* true: 16bit 整数で書く (既定は 32bit float) */
+} ENG_RecordParams;
+
+/** 録音の状況。止めた後も次の録音を始めるまで最後の値を返す。 */
+typedef struct {
+    bool     recording;
+    uint32_t buffer_frames;  /* リングの長さ (フレーム) */
+    uint32_t buffer_peak;    /* リングに溜まった最大フレーム (ディスクの遅れの目安) */
+    uint64_t frames_written; /* ファイルに書いたフレーム */
+    uint64_t frames_dropped; /* リングが溢れて捨てたフレーム */
+} ENG_RecordStats;
+
+/** 録音を始める。既に録音中、ファイルを作れない、".flac" を指定したときは false。 */
+bool eng_audio_record_start(ENG_Audio* a, const char* path);
+
+/** 設定付きで録音を始める。p=NULL は既定値。 */
+bool eng_audio_record_start_ex(ENG_Audio* a, const char* path, const ENG_RecordParams* p);
+
+/**
+ * 録音を止め、リングに残った分を書いてファイルを閉じる。
+ * 捨てたフレームがあれば stderr に報告する。録音していない、または書き込みに失敗していれば false。
+ */
+bool eng_audio_record_stop(ENG_Audio* a);
+
+/** 録音の状況を取得する。 */
+void eng_audio_get_record_stats(ENG_Audio* a, ENG_RecordStats* out);
+
+/* ── 非同期読込 ─────────────────────────────────────────*/
+/*
+ * *_load_async はファイルのヘッダだけを呼び出し側で読み、デコードは
+ * 読込ジョブスレッド (loader_threads 本) に任せてすぐに ID を返す。
+ * ヘッドレス時はジョブスレッドを持たないため、同期読込と同じく即座に完了する。
+ */
+
+/** 読込中の BGM/SE の数。 */
+uint32_t eng_audio_loads_pending(ENG_Audio* a);
+
+/**
+ * 読み込んだ全 BGM/SE の進捗 (0.0〜1.0)。読込済みは 1、読込中はデコード済みの割合として平均する。
+ * 読込がひとつもなければ 1.0。
+ */
+float    eng_audio_load_progress(ENG_Audio* a);
+
+/** 実行中の非同期読込が全て終わるまで待つ。 */
+void     eng_audio_wait_loads(ENG_Audio* a);
+
+/* ── デコードキャッシュ ─────────────────────────────────*/
+/*
+ * SE のデコード済みデータはパス (バンク内なら登録名) ごとに 1 つだけ持ち、
+ * 同じパスの SE 同士で参照カウントして共有する。
+ * どの SE からも使われなくなったデータはすぐには捨てず、cache_budget まで残して
+ * 次の eng_se_load ではデコードし直さずに使う。上限を超えた分は使われなくなった順 (LRU) に捨てる。
+ * 使用中のデータは捨てないため、使用中だけで上限を超えることはある。
+ */
+typedef struct {
+    uint64_t hits;           /* デコード済みデータを再利用した読込 */
+    uint64_t misses;         /* 新たにデコードした読込 */
+    uint64_t evictions;      /* 上限超過で捨てた数 */
+    uint64_t resident_bytes; /* 保持中のデコード済みデータ (使用中を含む。バンクのデータは数えない) */
+    uint64_t unused_bytes;   /* そのうちどの SE からも使われていない分 */
+    uint32_t entries;        /* 保持中のデータ数 */
+    uint64_t budget;         /* 現在の上限 */
+    uint64_t encoded_bytes;  /* resident_bytes のうち圧縮 SE が圧縮したまま持っている分 */
+    uint64_t voice_bytes;    /* 圧縮 SE のボイスが持つ先読みバッファ (resident_bytes には含まない) */
+} ENG_CacheStats;
+
+/** 未使用データの保持上限 (バイト) を変える。超えていればその場で捨てる。 */
+void eng_audio_set_cache_budget(ENG_Audio* a, uint64_t bytes);
+
+/** キャッシュの統計を取得する。 */
+void eng_audio_get_cache_stats(ENG_Audio* a, ENG_CacheStats* out);
+
+/* ── サウンドバンク ─────────────────────────────────────*/
+/*
+ * tools/eng_bank_build で作った .bank を読み取り専用で mmap する。
+ * 以後の eng_se_load / eng_se_load_async は、バンクにその名前があれば
+ * ファイルを開かずにマップ上のデータを使う (PCM はコピーもデコードもしない)。
+ * 名前はビルド時に渡したパスそのもの。BGM (ストリーミング) は対象外。
+ */
+typedef uint32_t ENG_BankID; /* 0 = 無効 */
+
+/** バンクを開く。戻り値: BankID (0=失敗) */
+ENG_BankID eng_bank_load(ENG_Audio* a, const char* path);
+
+/** バンクを閉じる。このバンクから読んだ SE が残っていれば false。 */
+bool       eng_bank_unload(ENG_Audio* a, ENG_BankID id);
+
+/* ── ミキサーバス ───────────────────────────────────────*/
+/*
+ * 各バスは ma_sound_group で、読込時に指定したバスのサウンドをまとめて鳴らす。
+ * 音量・パン・フェード・ミュートは鳴っている数によらずバスへの 1 操作で済む。
+ * 最終的な音量は サウンド×バス×マスター。
+ */
+
+/** バス音量 (0.0〜)。 */
+void  eng_bus_set_volume(ENG_Audio* a, ENG_Bus bus, float vol);
+float eng_bus_get_volume(ENG_Audio* a, ENG_Bus bus);
+
+/** バスのパン: -1=左, 0=中央, 1=右。 */
+void  eng_bus_set_pan(ENG_Audio* a, ENG_Bus bus, float pan);
+
+/** バスを現在のフェード音量から target へ duration 秒でフェードする (音量とは別に掛かる)。 */
+void  eng_bus_fade(ENG_Audio* a, ENG_Bus bus, float target, float duration);
+
+/** ミュート。解除すると元の音量に戻る。 */
+void  eng_bus_set_mute(ENG_Audio* a, ENG_Bus bus, bool mute);
+bool  eng_bus_is_muted(ENG_Audio* a, ENG_Bus bus);
+
+/* ── インサートエフェクト ───────────────────────────────*/
+/*
+ * バス・BGM・SE の出力に挿し込むエフェクト。ノードグラフ上のノードとして
+ * 対象の後ろにつなぐ。同じ対象に複数つなぐと接続した順に掛かる。
+ * SE に挿した場合は、その SE の全ボイスをまとめて 1 回処理する。
+ * パラメータ変更は次のブロックから約 20ms かけて滑らかに反映される。
+ */
+typedef uint32_t ENG_FxID; /* 0 = 無効 */
+
+typedef enum {
+    ENG_FX_LOWPASS    = 0, /* FREQ, Q */
+    ENG_FX_HIGHPASS   = 1, /* FREQ, Q */
+    ENG_FX_PEAK       = 2, /* FREQ, Q, GAIN_DB (ピーキング EQ) */
+    ENG_FX_COMPRESSOR = 3, /* THRESHOLD_DB, RATIO, ATTACK_MS, RELEASE_MS, GAIN_DB (メイクアップ) */
+    ENG_FX_LIMITER    = 4, /* THRESHOLD_DB, RELEASE_MS, GAIN_DB (比は無限大、アタックは即時) */
+    ENG_FX_REVERB     = 5, /* DECAY, DAMPING, WET, DRY */
+    ENG_FX_METER      = 6, /* パラメータなし。音は変えずに測る (eng_fx_get_meter) */
+    ENG_FX_TYPE_COUNT
+} ENG_FxType;
+
+typedef enum {
+    ENG_FX_FREQ = 0,       /* Hz */
+    ENG_FX_Q,
+    ENG_FX_GAIN_DB,
+    ENG_FX_THRESHOLD_DB,
+    ENG_FX_RATIO,
+    ENG_FX_ATTACK_MS,
+    ENG_FX_RELEASE_MS,
+    ENG_FX_DECAY,          /* 残響時間 (秒, -60dB まで) */
+    ENG_FX_DAMPING,        /* 高域の減衰 0〜1 */
+    ENG_FX_WET,            /* 残響の量 */
+    ENG_FX_DRY,            /* 原音の量 */
+    ENG_FX_PARAM_COUNT
+} ENG_FxParam;
+
+/** エフェクトを作る (どこにもつながっていない)。戻り値: FxID (0=失敗) */
+ENG_FxID eng_fx_create(ENG_Audio* a, ENG_FxType type);
+
+/** 外して破棄する。 */
+void     eng_fx_free(ENG_Audio* a, ENG_FxID fx);
+
+/** パラメータの目標値を設定する。その種類にないパラメータは無視される。 */
+bool     eng_fx_set_param(ENG_Audio* a, ENG_FxID fx, ENG_FxParam param, float value);
+
+/**
+ * 挿し込む先。既にどこかにつながっていれば付け替える。
+ * BGM・SE を解放するとそこに挿していたエフェクトは外れる (破棄はされない)。
+ */
+bool     eng_fx_attach_bus(ENG_Audio* a, ENG_FxID fx, ENG_Bus bus);
+bool     eng_fx_attach_bgm(ENG_Audio* a, ENG_FxID fx, ENG_SoundID id);
+bool     eng_fx_attach_se(ENG_Audio* a, ENG_FxID fx, ENG_SoundID id);
+
+/**
+ * マスター出力 (主音量を掛けた後、デバイスに渡す直前) に挿す。ENG_FX_METER のみで、
+ * 同時に ENG_MASTER_METERS 個まで。
+ */
+bool     eng_fx_attach_master(ENG_Audio* a, ENG_FxID fx);
+
+/** 対象から外す。 */
+void     eng_fx_detach(ENG_Audio* a, ENG_FxID fx);
+
+/*
+ * 解析 (ENG_FX_METER)。オーディオスレッドが挿した位置の音を測り、
+ * ENG_METER_HOP フレームごとに結果を 2 面のスナップショットの裏側へ書いて表に出す。
+ * 取得はスクリプトスレッドから表側を写すだけで、ミックスを止めない
+ * (取得中に次の結果が出たら、オーディオスレッドはその回の公開を飛ばす)。
+ * dB の値は ENG_METER_FLOOR_DB で下を切る。ENG_METER_MAX_CHANNELS を超える
+ * チャンネル数のエンジンでは測らない (channels = 0)。
+ */
+#define ENG_MASTER_METERS      4
+#define ENG_METER_MAX_CHANNELS 8
+#define ENG_METER_FFT_SIZE     2048                      /* ハン窓 */
+#define ENG_METER_BINS         (ENG_METER_FFT_SIZE / 2)
+#define ENG_METER_HOP          (ENG_METER_FFT_SIZE / 4)  /* 更新間隔 (フレーム) */
+#define ENG_METER_FLOOR_DB     (-120.0f)
+
+typedef struct {
+    uint32_t channels;
+    float    peak_db[ENG_METER_MAX_CHANNELS];     /* サンプルピーク。すぐ上がり 1.7 秒で 20dB 下がる */
+    float    peak_max_db[ENG_METER_MAX_CHANNELS]; /* 作成 (リセット) 以降の最大ピーク */
+    float    rms_db[ENG_METER_MAX_CHANNELS];      /* 時定数 300ms の RMS */
+    float    lufs_momentary;  /* ITU-R BS.1770 の K 特性。400ms 窓 (100ms ごとに更新) */
+    float    lufs_short;      /* 3 秒窓。チャンネルの重みは全て 1 (5.1 のサラウンド補正はしない) */
+    uint64_t frames;          /* 測ったフレーム数 */
+} ENG_MeterLevels;
+
+/** 最新の測定値。ENG_FX_METER 以外は false。 */
+bool     eng_fx_get_meter(ENG_Audio* a, ENG_FxID fx, ENG_MeterLevels* out);
+
+/**
+ * 最新のスペクトル (全チャンネルの平均) を dBFS で out に書く。振幅 1 の正弦波がほぼ 0dB。
+ * bands が ENG_METER_BINS 以上なら FFT のビンそのまま (i 番目が i × レート / ENG_METER_FFT_SIZE Hz)。
+ * 少なければ 20Hz からナイキストまでを対数で bands 等分し、帯域内の最大値を入れる。
+ * 戻り値: 書いた数 (0=失敗)
+ */
+uint32_t eng_fx_get_spectrum(ENG_Audio* a, ENG_FxID fx, float* out, uint32_t bands);
+
+/** 最大ピークとラウドネスの履歴を消す (次の更新から反映)。 */
+void     eng_fx_reset_meter(ENG_Audio* a, ENG_FxID fx);
+
 /* ── BGM (ストリーミング) ────────────────────────────────*/
 
 /** ファイルをストリーミング読込。戻り値: SoundID (0=失敗) */
 ENG_SoundID eng_bgm_load(ENG_Audio* a, const char* path);
 
+/**
+ * eng_bgm_load と同じ (BGM は元から先頭のデコードを待たずに返る)。SE と揃えるための別名。
+ * 読込完了前に再生した場合は、データが届いた時点から鳴り始める。
+ */
+ENG_SoundID eng_bgm_load_async(ENG_Audio* a, const char* path);
+
+/** バスなどを指定して読込。params=NULL なら eng_bgm_load と同じ。 */
+ENG_SoundID eng_bgm_load_ex(ENG_Audio* a, const char* path, const ENG_LoadParams* params);
+
+/** 読込状態。progress (NULL 可) に 0.0〜1.0 を返す。 */
+ENG_LoadState eng_bgm_load_state(ENG_Audio* a, ENG_SoundID id, float* progress);
+
 /** BGM 再生開始。 */
 void eng_bgm_play(ENG_Audio* a, ENG_SoundID id);
 
 /** BGM 停止 (位置リセット)。 */
 void eng_bgm_stop(ENG_Audio* a, ENG_SoundID id);
 
+/**
+ * エンジン時刻 frame ちょうどから BGM を再生する (サンプル単位で正確)。
+ * 過去の時刻なら即時。既に過ぎた予約停止は解除される。
+ */
+void eng_bgm_play_at(ENG_Audio* a, ENG_SoundID id, uint64_t frame);
+
+/** エンジン時刻 frame ちょうどで BGM を止める (位置は保持)。 */
+void eng_bgm_stop_at(ENG_Audio* a, ENG_SoundID id, uint64_t frame);
+
 /** BGM 一時停止。 */
 void eng_bgm_pause(ENG_Audio* a, ENG_SoundID id);
 
@@ -46,6 +496,29 @@ void eng_bgm_resume(ENG_Audio* a, ENG_SoundID id);
 /** ループ設定。 */
 void eng_bgm_set_loop(ENG_Audio* a, ENG_SoundID id, bool loop);
 
+/**
+ * ループ区間を設定する (イントロ付きループ)。ループ中は end に達すると start へ
+ * サンプル単位で途切れずに戻る。位置はファイルのサンプルレートでのフレーム、
+ * end=0 は曲末。読込時にはファイルの区間 (WAV の smpl チャンク、Ogg / FLAC の
+ * LOOPSTART / LOOPLENGTH / LOOPEND タグ) が設定済み。
+ * 終了位置を指定する区間は 1 秒 (ストリームの 1 ページ) 以上にすること。
+ * 再生中の変更は先読み済みの分 (約 2 秒) を鳴らした後に効く。不正な区間なら false。
+ */
+bool eng_bgm_set_loop_points(ENG_Audio* a, ENG_SoundID id, uint64_t start, uint64_t end);
+
+/**
+ * 今の曲が終わったら、間を空けずに path を続けて鳴らす (ギャップレス)。
+ * 呼んだ時点で path の先頭の先読みを始める。ヘッダの解析は eng_bgm_load と同じく
+ * 呼び出し側で行う。予約できるのは 1 曲までで、チャンネル数が違う曲は予約できない。
+ * ループ中の曲は終わらないので、切り替えたいときは eng_bgm_set_loop で止める
+ * (先読み済みの分は 1 周多く鳴ることがある)。切り替わると再生位置は 0 に戻り、
+ * ループ設定とループ区間は新しい曲のものになる。
+ */
+bool eng_bgm_queue(ENG_Audio* a, ENG_SoundID id, const char* path, bool loop);
+
+/** 予約した曲がまだ始まっていなければ true。 */
+bool eng_bgm_is_queued(ENG_Audio* a, ENG_SoundID id);
+
 /** 音量設定 (0.0〜1.0)。 */
 void eng_bgm_set_volume(ENG_Audio* a, ENG_SoundID id, float vol);
 
@@ -63,28 +536,103 @@ void eng_bgm_free(ENG_Audio* a, ENG_SoundID id);
 
 /* ── SE (インメモリ) ────────────────────────────────────*/
 
-/** SE ファイルをメモリに読込。戻り値: SoundID (0=失敗) */
+/**
+ * SE ファイルをメモリに読込。戻り値: SoundID (0=失敗)
+ * 開いているバンクに同じ名前があればそちらを使う。
+ * 同じパスを読み込み済み (キャッシュに残っているものを含む) ならデコードし直さずに共有する。
+ * デコード済み PCM を共有するボイスを既定で 8 個確保する。
+ */
 ENG_SoundID eng_se_load(ENG_Audio* a, const char* path);
 
-/** SE 再生 (同一 ID を重ねて鳴らすことも可)。 */
+/**
+ * デコードを待たずに ID を返す。完了するまでの SE 再生は無視される。
+ * 音量などの設定は読込中でも受け付け、完了時に反映される。
+ */
+ENG_SoundID eng_se_load_async(ENG_Audio* a, const char* path);
+
+/**
+ * バスなどを指定して読込。params=NULL なら eng_se_load と同じ。
+ *
+ * ENG_LOAD_FLAG_COMPRESSED を付けると Vorbis/FLAC/MP3 などを圧縮したままメモリに持ち、
+ * 先頭 decode_ahead_ms だけをデコードしておく。ボイスは発音ごとに自前のデコーダで
+ * 続きを同じ長さのリングへ先読みする (読込ジョブスレッドで。ヘッドレス時はミックス中に)。
+ * 長い環境音やボイスでメモリを減らす代わりに、鳴っているボイスの数だけデコードの負荷が掛かる。
+ * - 読込はファイルを読んで先頭をデコードするだけなので、ASYNC を付けても同期で行う
+ * - 長さの分からないファイルは読めない。バンクの PCM のエントリは通常の読込になる
+ * - 素材のレートのまま鳴らすので、エンジンとレートが違えばピッチ用リサンプラを通す
+ * - 途中へのシーク (仮想化からの復帰など) は先読みが追い付くまで無音になる
+ * - 同じパスを読み込み済みなら、そのときの先読み長のデータを共有する
+ */
+ENG_SoundID eng_se_load_ex(ENG_Audio* a, const char* path, const ENG_LoadParams* params);
+
+/** SE 1 つ分のメモリ。 */
+typedef struct {
+    bool     compressed;    /* ENG_LOAD_FLAG_COMPRESSED で読み込んだ */
+    uint64_t encoded_bytes; /* 圧縮したまま持っているデータ (全体が先頭に収まる短い SE は 0) */
+    uint64_t decoded_bytes; /* デコード済みのデータ (圧縮 SE は先頭の分だけ) */
+    uint64_t voice_bytes;   /* ボイスの先読みバッファ (一度でも鳴らしたボイスの分。デコーダ自体は含まない) */
+    uint64_t full_bytes;    /* 全体をデコードして持った場合の大きさ */
+} ENG_SoundMemory;
+
+/**
+ * SE のメモリの内訳を取得する。失敗時は false。
+ * 同じパスの SE 同士は元データを共有するので、足し合わせると二重に数える。
+ */
+bool eng_se_get_memory(ENG_Audio* a, ENG_SoundID id, ENG_SoundMemory* out);
+
+/** 読込状態。progress (NULL 可) にデコード済みの割合を返す。 */
+ENG_LoadState eng_se_load_state(ENG_Audio* a, ENG_SoundID id, float* progress);
+
+/**
+ * SE 再生 (同一 ID を重ねて鳴らすことも可)。
+ * 空きボイスで発音し、埋まっていれば eng_se_set_voices の方式で奪う。
+ */
 void eng_se_play(ENG_Audio* a, ENG_SoundID id);
 
-/** SE 再生 (音量指定)。 */
+/** SE 再生 (音量指定)。音量はこの発音にのみ適用される。 */
 void eng_se_play_vol(ENG_Audio* a, ENG_SoundID id, float vol);
 
-/** SE 停止 (全インスタンス)。 */
+/**
+ * SE の同時発音数と奪い方を設定する。
+ * ボイスはここで確保し直すため、鳴っている音は止まる。失敗時 (mode が範囲外を含む) は false。
+ */
+bool eng_se_set_voices(ENG_Audio* a, ENG_SoundID id, uint32_t max_voices, ENG_StealMode mode);
+
+/**
+ * エンジン時刻 frame ちょうどに SE を発音する (サンプル単位で正確)。
+ * 予約中のボイスは使用中として扱われるので、同時発音数の範囲で複数予約できる。
+ */
+void eng_se_play_at(ENG_Audio* a, ENG_SoundID id, uint64_t frame);
+
+/** SE 停止 (全インスタンス、予約も取り消す)。 */
 void eng_se_stop(ENG_Audio* a, ENG_SoundID id);
 
 /** SE 音量設定。 */
 void eng_se_set_volume(ENG_Audio* a, ENG_SoundID id, float vol);
 
-/** SE ピッチ設定 (1.0=等倍)。 */
+/**
+ * SE ピッチ設定 (1.0=等倍)。
+ * 元データは読込時にエンジンのレートへ変換してあるので、ピッチ 1 でドップラーも掛からない
+ * 発音はピッチ用リサンプラを通さずにミックスする。
+ */
 void eng_se_set_pitch(ENG_Audio* a, ENG_SoundID id, float pitch);
 
+/**
+ * SE のピッチ用リサンプラの品質を設定する (ENG_RESAMPLE_*。既定は生成設定の pitch_resample)。
+ * ボイスを作り直すため、鳴っている音は止まる。失敗時は false。
+ */
+bool eng_se_set_resample(ENG_Audio* a, ENG_SoundID id, uint32_t quality);
+
 /** SE ループ設定。 */
 void eng_se_set_loop(ENG_Audio* a, ENG_SoundID id, bool loop);
 
-/** SE が再生中かどうか。 */
+/**
+ * SE の優先度を設定する (大きいほど優先。既定 0)。
+ * eng_audio_set_voice_budget の上限を超えたとき、優先度の低いものから仮想化される。
+ */
+void eng_se_set_priority(ENG_Audio* a, ENG_SoundID id, int priority);
+
+/** SE が再生中かどうか (仮想化中も再生中として扱う)。 */
 bool eng_se_is_playing(ENG_Audio* a, ENG_SoundID id);
 
 /** SE 解放。 */
@@ -95,9 +643,26 @@ void eng_se_free(ENG_Audio* a, ENG_SoundID id);
 /** マスター音量設定 (0.0〜1.0)。 */
 void eng_audio_set_master_volume(ENG_Audio* a, float vol);
 
-/** マスター音量取得。 */
+/** マスター音量取得 (最後に設定した値)。 */
 float eng_audio_get_master_volume(ENG_Audio* a);
 
+/**
+ * 実際に鳴らす SE ボイスの上限 (0 = 無制限)。
+ * 超えた分は優先度、同じなら実効音量の低いものから仮想化する。仮想化したボイスは
+ * デコードもミックスもせず再生位置だけ進め、上限に空きができると続きの位置から鳴り直す
+ * (ループしないものは末尾を過ぎた時点で終わる)。BGM は数えない。失敗時は false。
+ */
+bool eng_audio_set_voice_budget(ENG_Audio* a, uint32_t max_voices);
+
+/** SE ボイスの上限を取得する。 */
+uint32_t eng_audio_get_voice_budget(ENG_Audio* a);
+
+/**
+ * 無音発音の自動停止。実効音量 (音量×フェード) が gain 未満のまま ms ミリ秒続いた
+ * BGM・SE ボイスをオーディオスレッドで止める (BGM は位置を保つ)。gain=0 で無効、ms=0 で 200。
+ */
+void eng_audio_set_cull(ENG_Audio* a, float gain, uint32_t ms);
+
 /** SE の長さを秒単位で返す */
 float eng_se_duration(ENG_Audio* a, ENG_SoundID id);
 
@@ -108,6 +673,14 @@ void eng_bgm_set_pitch(ENG_Audio* a, ENG_SoundID id, float pitch);
 
 /* ── フェード ───────────────────────────────────────────*/
 
+/** フェードアウト完了時の動作。オーディオスレッドが完了したブロックで適用する。 */
+typedef enum {
+    ENG_FADE_CONTINUE = 0, /* 音量 0 のまま鳴らし続ける (従来の動作) */
+    ENG_FADE_STOP     = 1, /* 停止して先頭へ (eng_bgm_stop と同じ) */
+    ENG_FADE_PAUSE    = 2, /* 位置を保って停止 (eng_bgm_play で続きから) */
+    ENG_FADE_FREE     = 3, /* 停止して解放 (以後 ID は無効) */
+} ENG_FadeEnd;
+
 /**
  * BGM フェードイン: 音量 0→1 で再生開始。
  * @param duration  フェード秒数。
@@ -120,12 +693,19 @@ void eng_bgm_fade_in(ENG_Audio* a, ENG_SoundID id, float duration);
  */
 void eng_bgm_fade_out(ENG_Audio* a, ENG_SoundID id, float duration);
 
+/** eng_bgm_fade_out の完了時動作つき版。 */
+void eng_bgm_fade_out_ex(ENG_Audio* a, ENG_SoundID id, float duration, ENG_FadeEnd end);
+
 /**
  * BGM クロスフェード: from をフェードアウトしつつ to をフェードイン。
  * to は先頭から再生開始される。
  */
 void eng_bgm_crossfade(ENG_Audio* a, ENG_SoundID from_id, ENG_SoundID to_id, float duration);
 
+/** eng_bgm_crossfade の完了時動作つき版。end は from 側に適用する。 */
+void eng_bgm_crossfade_ex(ENG_Audio* a, ENG_SoundID from_id, ENG_SoundID to_id, float duration,
+                          ENG_FadeEnd end);
+
 /* ── パン (左右定位) ────────────────────────────────────*/
 
 /** BGM パン設定: -1=左, 0=中央, 1=右。 */
@@ -134,6 +714,76 @@ void eng_bgm_set_pan(ENG_Audio* a, ENG_SoundID id, float pan);
 /** SE パン設定: -1=左, 0=中央, 1=右。 */
 void eng_se_set_pan(ENG_Audio* a, ENG_SoundID id, float pan);
 
+/* ── 3D 定位 ────────────────────────────────────────────*/
+/*
+ * 右手系 (既定の聴取者は原点から -Z を向き、上は +Y)。単位は任意だが距離減衰の
+ * 最小・最大距離と揃える。位置を設定したサウンドは 3D になり、それまでのパンは
+ * 3D の定位に重ねて掛かる。SE は同じ ID のボイス全てが同じ位置で鳴る。
+ * 位置はオーディオスレッドがミックスのブロックごとに読むので、毎フレーム書き換えてよい。
+ */
+
+/** 3D の設定項目。 */
+typedef enum {
+    ENG_SPATIAL_ENABLED = 0,     /* 1 = 3D, 0 = 2D に戻す (位置の設定で 1 になる) */
+    ENG_SPATIAL_MODEL,           /* 距離減衰: 0=なし 1=逆数 (既定) 2=線形 3=指数 */
+    ENG_SPATIAL_MIN_DISTANCE,    /* これより近くは減衰しない (既定 1) */
+    ENG_SPATIAL_MAX_DISTANCE,    /* これより遠くは減衰が進まない (既定 無限) */
+    ENG_SPATIAL_ROLLOFF,         /* 減衰の強さ (既定 1) */
+    ENG_SPATIAL_CONE_INNER,      /* 指向性: 内側の角度 (度。既定 360 = 無指向) */
+    ENG_SPATIAL_CONE_OUTER,      /* 外側の角度 (度。既定 360) */
+    ENG_SPATIAL_CONE_OUTER_GAIN, /* 外側の音量 (既定 0) */
+    ENG_SPATIAL_DOPPLER,         /* ドップラー効果の強さ (既定 1、0 = なし) */
+    ENG_SPATIAL_PARAM_COUNT
+} ENG_SpatialParam;
+
+/** 聴取者の位置。 */
+void eng_audio_set_listener_position(ENG_Audio* a, float x, float y, float z);
+
+/** 聴取者の向き (前方)。 */
+void eng_audio_set_listener_direction(ENG_Audio* a, float x, float y, float z);
+
+/** 聴取者の上方向 (既定 0,1,0)。 */
+void eng_audio_set_listener_up(ENG_Audio* a, float x, float y, float z);
+
+/** 聴取者の速度 (ドップラー効果用。単位は距離/秒)。 */
+void eng_audio_set_listener_velocity(ENG_Audio* a, float x, float y, float z);
+
+/**
+ * 簡易定位に切り替える距離 (0 = 切り替えない)。聴取者からこれより遠い SE は
+ * 3D 処理を外し、ブロックごとに求めた距離減衰とパンだけで鳴らす (指向性とドップラーは掛からない)。
+ * パンは 3D と同じ法則に eng_se_set_pan のパンを重ねたもので、切り替えの前後で左右の音量は変わらない。
+ */
+void eng_audio_set_spatial_lod(ENG_Audio* a, float distance);
+
+/** SE の位置。 */
+void eng_se_set_position(ENG_Audio* a, ENG_SoundID id, float x, float y, float z);
+
+/**
+ * 複数の SE の位置をまとめて設定する (x[i], y[i], z[i] が ids[i] の位置)。
+ * 命令キューを通さずに書き込むので、数千個を毎フレーム動かしてもキューを使い切らない。
+ * 無効な ID は飛ばす。
+ */
+void eng_se_set_positions(ENG_Audio* a, const ENG_SoundID* ids, const float* x, const float* y,
+                          const float* z, uint32_t count);
+
+/** SE の速度 (ドップラー効果用)。 */
+void eng_se_set_velocity(ENG_Audio* a, ENG_SoundID id, float x, float y, float z);
+
+/** SE の向き (指向性用。既定 0,0,-1)。 */
+void eng_se_set_direction(ENG_Audio* a, ENG_SoundID id, float x, float y, float z);
+
+/** SE の 3D 設定。範囲外の値は false。 */
+bool eng_se_set_spatial(ENG_Audio* a, ENG_SoundID id, ENG_SpatialParam param, float value);
+
+/** BGM の位置 (簡易定位には切り替わらない)。 */
+void eng_bgm_set_position(ENG_Audio* a, ENG_SoundID id, float x, float y, float z);
+
+/** BGM の速度 (ドップラー効果用)。 */
+void eng_bgm_set_velocity(ENG_Audio* a, ENG_SoundID id, float x, float y, float z);
+
+/** BGM の 3D 設定。範囲外の値は false。 */
+bool eng_bgm_set_spatial(ENG_Audio* a, ENG_SoundID id, ENG_SpatialParam param, float value);
+
 /* ── BGM 長さ ───────────────────────────────────────────*/
 
 /** BGM の全長 (秒) を返す。取得失敗時は 0。 */
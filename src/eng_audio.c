@@ -4,120 +4,3641 @@
  * Copyright (c) 2026 Reo Shiozawa — MIT License
  */
 
+/* 32 ビットの POSIX でも off_t を 64 ビットにする (file_seek64 で 2GB を超えるため)。 */
+#if !defined(_WIN32) && !defined(_FILE_OFFSET_BITS)
+#define _FILE_OFFSET_BITS 64
+#endif
+
 /* miniaudio のみを実装するファイル。他ファイルは include のみ。 */
 #define MINIAUDIO_IMPLEMENTATION
 #include "miniaudio.h"
 
-#include "eng_audio.h"
-#include <stdlib.h>
-#include <string.h>
-#include <stdio.h>
+#include "eng_audio.h"
+#include "eng_bank.h"
+#include "eng_dsp.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <float.h>
+
+/* ── 定数 ───────────────────────────────────────────────*/
+#define ENG_SLOT_CHUNK_BITS    6    /* スロットは 64 個ずつのチャンクで確保する (移動しない) */
+#define ENG_SLOT_CHUNK         (1u << ENG_SLOT_CHUNK_BITS)
+#define ENG_ID_INDEX_BITS      20   /* SoundID の下位 = スロット番号+1、上位 11 ビット = 世代 */
+#define ENG_ID_INDEX_MASK      ((1u << ENG_ID_INDEX_BITS) - 1)
+#define ENG_ID_GEN_MASK        0x7FFu
+#define ENG_SE_DEFAULT_VOICES  8    /* SE 1 つあたりの既定同時発音数 */
+#define ENG_HEADLESS_RATE      48000
+#define ENG_HEADLESS_CHANNELS  2
+#define ENG_RENDER_CHUNK       1024 /* render でジョブ処理を挟む間隔 (フレーム) */
+#define ENG_CMD_QUEUE_DEFAULT  4096 /* コマンドキューの既定容量 (2 の累乗) */
+#define ENG_LOADER_THREADS_DEFAULT 1 /* 読込ジョブスレッドの既定数 */
+#define ENG_CULL_MS_DEFAULT    200  /* 無音停止までの既定時間 */
+#define ENG_VOICE_KEEP_BIAS    1.5f /* 発音数の振り分けで鳴っているボイスに掛ける音量の下駄 */
+#define ENG_PITCH_PRIME_FRAMES 16   /* 鳴っている途中でピッチ用リサンプラを掛けるときに通す直前のフレーム数 */
+#define ENG_DECODE_AHEAD_MS_DEFAULT 100 /* 圧縮 SE の既定の先読み */
+#define ENG_STATS_BUCKETS      64   /* ミックス時間のヒストグラム: 1us 未満 + 1/4 オクターブ刻み */
+#define ENG_RECORD_WRITE_BYTES (1u << 20) /* 録音ファイルへ 1 回に書く大きさ (stdio のバッファ) */
+#define ENG_RECORD_CHUNK       4096 /* 録音のリングから 1 回に取り出す上限 (フレーム) */
+#define ENG_RECORD_POLL_MS     10   /* 書き出しスレッドがリングを見に行く間隔 */
+#define ENG_DEVICE_RETRY_MS    1000 /* 開けなかった再生デバイスを開き直す間隔 */
+/* 1 回のミックスで読むフレーム数の上限。ノードグラフの合成用キャッシュ
+ * (既定 480) を超えると、途中で開始する予約発音が次の読み出しまで遅れる。 */
+#define ENG_MIX_SLICE          MA_DEFAULT_NODE_CACHE_CAP_IN_FRAMES_PER_BUS
+/* 圧縮 SE の先読みの下限 (フレーム)。ボイスは 1 回に ENG_MIX_SLICE 前後をまとめて読む */
+#define ENG_DECODE_AHEAD_MIN   (ENG_MIX_SLICE * 2)
+
+/* ── 3D 定位 ────────────────────────────────────────────*/
+/*
+ * 音源の位置。スロットのチャンクと同じ 64 個単位の SoA で持ち、スロットの解放をまたいで使い回す。
+ * 書くのはスクリプトスレッド (命令キューを通さない)、読むのはオーディオスレッド。
+ * 成分ごとに書くので、読む側が前後のフレームの成分を混ぜて読むことはある。
+ */
+typedef struct {
+    float x[ENG_SLOT_CHUNK];
+    float y[ENG_SLOT_CHUNK];
+    float z[ENG_SLOT_CHUNK];
+} EmitterChunk;
+
+/* サウンドの 3D 設定 (オーディオスレッド側の値) */
+typedef struct {
+    float    param[ENG_SPATIAL_PARAM_COUNT];
+    ma_vec3f velocity;
+    ma_vec3f direction;
+    bool     lod;      /* 遠いので簡易定位 (距離減衰とパン) で鳴らしている */
+    float    gain;     /* 距離減衰の見積もり (2D は 1。発音数の振り分けに使う) */
+    float    lod_gain; /* 簡易定位の音量 (距離減衰 × 大きい側のチャンネルの係数) */
+    float    lod_pan;  /* 簡易定位のパン (3D のパンの法則とユーザーのパンを合わせたもの) */
+} EngSpatial;
+
+/* ── 圧縮 SE ────────────────────────────────────────────*/
+/*
+ * ENG_LOAD_FLAG_COMPRESSED で読んだ元データ。圧縮したままのバイト列と、
+ * 先頭 head_frames をデコードした PCM (素材のレート、f32) を持つ。
+ * 先頭はボイスが鳴り始めてから先読みが追い付くまでの間に使う。
+ */
+typedef struct {
+    void*       owned;        /* ファイルから読んだバイト列 (バンクのマップを指すときは NULL) */
+    const void* data;         /* 圧縮データ (全体が head に収まれば NULL) */
+    size_t      size;
+    float*      head;
+    ma_uint64   head_frames;
+    ma_uint64   length;       /* 全体のフレーム数 */
+    ma_uint32   channels;
+    ma_uint32   sample_rate;
+    ma_uint32   ring_frames;  /* ボイスごとの先読みリングの容量 */
+    ma_channel  map[MA_MAX_CHANNELS];
+} EncAsset;
+
+/* EncStream のデコーダとリング */
+enum { ENC_RING_NONE, ENC_RING_READY, ENC_RING_FAILED };
+
+/*
+ * 圧縮 SE のボイスが読むデータソース。先頭は EncAsset の PCM を読み、その先は
+ * 読込ジョブがこのボイスのデコーダで埋めるリングから読む (単一生産者・単一消費者)。
+ * シークはオーディオスレッドで gen を進めて読み直しを頼み、ジョブが埋め直して
+ * ring_gen を揃えるまでリングは読まない。デコーダとリングは初めて埋めるときに作る。
+ * ループは ma_data_source の汎用処理に任せる (先頭へ戻る間は head を読むので途切れない)。
+ */
+typedef struct {
+    ma_data_source_base base;
+    EncAsset*  asset;
+    ENG_Audio* owner;
+    ma_uint64  cursor;     /* 次に返すフレーム (オーディオスレッドのみ) */
+    ma_uint64  ring_next;  /* リングから次に出てくるフレーム (オーディオスレッドのみ) */
+    MA_ATOMIC(4, ma_uint32) gen;      /* 読み直しの要求ごとに進める */
+    MA_ATOMIC(8, ma_uint64) target;   /* 読み直す位置 */
+    MA_ATOMIC(4, ma_uint32) ring_gen; /* リングの中身がどの要求に応えたものか */
+    MA_ATOMIC(4, ma_uint32) busy;     /* ジョブを投入済み (終わるまで解放できない) */
+    MA_ATOMIC(4, ma_uint32) ring_state; /* ENC_RING_* (作るのはジョブ) */
+    /* 以下はジョブのみ */
+    ma_decoder dec;
+    ma_uint64  dec_pos;
+    ma_pcm_rb  ring;
+} EncStream;
+
+/* ── SE ボイス ──────────────────────────────────────────*/
+/* 元データ (SoundSlot.sound) のデコード済み PCM を共有する発音単位。 */
+typedef struct {
+    ma_sound  sound;
+    EncStream* enc;      /* 圧縮 SE: sound の読み出し元 (それ以外は NULL) */
+    ma_uint64 start_at;  /* 予約発音のエンジン時刻 (0=即時)。この時刻までは使用中扱い */
+    ma_uint64 quiet;     /* 実効音量がしきい値未満のまま経過したフレーム数 (オーディオスレッド) */
+    float     volume;    /* 発音の音量 (簡易定位中は距離減衰を掛けて ma_sound に渡す) */
+    /* 仮想化 (発音数の上限で外された)。ミックスせず、再生位置は時刻から求める */
+    MA_ATOMIC(4, ma_uint32) virt;
+    bool      keep;      /* 振り分け中: 上限内に残る */
+    ma_uint64 virt_pos;  /* 外したときの再生位置 */
+    ma_uint64 virt_at;   /* 外したときのエンジン時刻 */
+} SEVoice;
+
+/* 発音数の振り分けで比べる値 (オーディオスレッド) */
+typedef struct {
+    SEVoice* voice;
+    int      priority;
+    float    gain;
+} VoiceRank;
+
+/* ── デコードキャッシュ ─────────────────────────────────*/
+/*
+ * SE の元データ 1 つ (パスまたはバンク登録名ごと)。
+ * hold が resource manager の共有ノードを参照し続けるので、SE が全て解放されても
+ * このエントリを捨てるまではデコード済みデータが残り、同じパスの読込はそれを共有する。
+ * エントリは個別に確保する (hold はジョブから参照されるため移動できない)。
+ * 圧縮 SE は hold の代わりに enc を持ち、同じパスでも通常の読込とは別のエントリになる。
+ */
+typedef struct CacheEntry {
+    ma_resource_manager_data_source hold;
+    EncAsset* enc;                /* 圧縮 SE の元データ (それ以外は NULL) */
+    struct CacheEntry* next;      /* ハッシュ連鎖 */
+    struct CacheEntry* lru_prev;  /* 未使用 (refs=0) の間だけ LRU リストに入る */
+    struct CacheEntry* lru_next;
+    char*     key;
+    ma_uint32 hash;
+    ma_uint32 refs;               /* このデータを使っている SE の数 */
+    ma_uint64 bytes;              /* デコード完了まで 0 */
+    bool      sized;              /* デコードが終わり bytes が確定した */
+} CacheEntry;
+
+/* ── 計測 ───────────────────────────────────────────────*/
+/*
+ * 書くのはオーディオスレッド (ヘッドレス時は render の呼び出し側) だけなので、
+ * 加算も読んで足して書くだけで済ませる (RMW 命令を使わない)。取得側は読むだけ。
+ */
+typedef struct {
+    ma_timer  timer;
+    MA_ATOMIC(4, ma_uint32) hist[ENG_STATS_BUCKETS];
+    MA_ATOMIC(8, ma_uint64) blocks;      /* ミックス回数 */
+    MA_ATOMIC(8, ma_uint64) mix_ns;      /* ミックス時間の合計 */
+    MA_ATOMIC(8, ma_uint64) min_ns;
+    MA_ATOMIC(8, ma_uint64) max_ns;
+    MA_ATOMIC(4, ma_uint32) load_ppm;    /* 直近の負荷 (100 万分率、指数平均) */
+    MA_ATOMIC(4, ma_uint32) load_peak_ppm;
+    MA_ATOMIC(8, ma_uint64) xruns;
+    MA_ATOMIC(8, ma_uint64) stalls;      /* BGM・圧縮 SE の読み出しが MA_BUSY で途切れた回数 */
+    MA_ATOMIC(8, ma_uint64) culled;
+    MA_ATOMIC(4, ma_uint32) voices;
+    MA_ATOMIC(4, ma_uint32) voices_peak;
+    MA_ATOMIC(4, ma_uint32) virtual_voices;
+    MA_ATOMIC(4, ma_uint32) reset;       /* スクリプトスレッドからのリセット要求 */
+    ma_uint64 last_start;                /* 前回のコールバック開始 (オーディオスレッドのみ) */
+    ma_uint64 last_out;                  /* 前回のコールバックで出した音の長さ (ns) */
+} EngStats;
+
+static void stat_add64(ma_uint64* p, ma_uint64 v) {
+    ma_atomic_store_explicit_64(p, ma_atomic_load_explicit_64(p, ma_atomic_memory_order_relaxed) + v,
+                                ma_atomic_memory_order_relaxed);
+}
+
+/* ── BGM ストリーム ─────────────────────────────────────*/
+/* BGM の 1 曲分。ストリームはジョブから参照されるので個別に確保する。 */
+typedef struct {
+    ma_resource_manager_data_source src;
+    MA_ATOMIC(8, ma_uint64) loop_beg;  /* ループ区間 (エンジンのレートのフレーム) */
+    MA_ATOMIC(8, ma_uint64) loop_end;  /* ~0 = 曲末 */
+    bool loop;                         /* 切り替わったときのループ設定 */
+} BgmTrack;
+
+/*
+ * BGM の ma_sound が読むデータソース。今の曲を読み、曲末に達したら予約された曲へ
+ * 同じ読み出しの中で切り替える (サンプル単位で途切れない)。
+ * ループ区間はストリームのデコーダに処理させる。ストリームに汎用のループ処理を
+ * 掛けると、ループのたびにシークのジョブを待って途切れるため。
+ */
+typedef struct {
+    ma_data_source_base base;
+    BgmTrack* cur;      /* 今の曲 (atomic。切り替えはオーディオスレッド) */
+    BgmTrack* queued;   /* 次の曲 (atomic。置くのはスクリプトスレッド) */
+    BgmTrack* retired;  /* 切り替えで終わった曲 (atomic。解放はスクリプトスレッド) */
+    MA_ATOMIC(8, ma_uint64) cursor; /* 今の曲の再生位置 (ループ区間で折り返す) */
+    EngStats* stats;
+} BgmStream;
+
+/* ── サウンドスロット ────────────────────────────────────*/
+typedef struct SoundSlot {
+    ma_sound  sound;     /* BGM=再生本体 / SE=デコード済みデータの保持元 (直接は鳴らさない) */
+    bool      used;
+    bool      streaming; /* BGM=true, SE=false */
+    ma_uint32 index;     /* テーブル内の位置 */
+    ma_uint32 gen;       /* 解放のたびに進める世代。古い ID を弾くのに使う */
+    ma_uint32 next_free; /* 空きリストの次 (index+1, 0=終端) */
+    ma_uint32 bank;      /* 読込元のバンク (index+1, 0=ファイルから) */
+    ma_uint32 bus;       /* 出力先 (ENG_Bus) */
+    CacheEntry* cache;   /* SE の元データ */
+    EncStream*  enc;     /* 圧縮 SE: sound の読み出し元 (ボイスの雛形。直接は読まない) */
+    ma_uint32 fx_head;   /* 挿しているエフェクトの先頭 (FxID, 0=なし) */
+    BgmStream stream;    /* BGM: sound の読み出し元 */
+
+    /* 3D 定位 */
+    EmitterChunk* emit;           /* 位置 (emit->x[index % 64] など。解放しても付け替えない) */
+    EngSpatial    spatial;        /* オーディオスレッド側の値 */
+    bool          spatial_shadow; /* スクリプトスレッドから見た 3D の有無 */
+
+    /* SE ボイスプール (読込完了時に確保し、発音時は確保しない) */
+    ENG_LoadState state;        /* SE のみ。PENDING の間はボイスがない */
+    SEVoice*      voices;
+    ma_uint32     voice_count;
+    ma_uint32     voice_want;   /* 読込完了時に確保するボイス数 */
+    ma_uint32     voice_next;   /* 次に使うボイス。ラウンドロビンなので常に最も古い発音 */
+    ENG_StealMode steal;
+    int           priority;     /* 発音数の上限で残す順 (大きいほど優先。オーディオスレッド側の値) */
+    float         volume;
+    float         pitch;
+    float         pan;
+    bool          looping;
+    ma_uint32     resample;     /* ピッチ用リサンプラの品質 (ENG_RESAMPLE_*) */
+
+    /* 発音中リスト (オーディオスレッドのみ。スクリプトスレッドは engine_lock 中に外す) */
+    struct SoundSlot* live_next;
+    bool          live;
+    ma_uint32     fade_end;     /* BGM: フェード完了時の動作 (ENG_FadeEnd) */
+    ma_uint64     quiet;        /* BGM: 実効音量がしきい値未満のまま経過したフレーム数 */
+    MA_ATOMIC(4, ma_uint32) released; /* BGM: ENG_FADE_FREE で止めた。回収はスクリプトスレッド */
+} SoundSlot;
+
+/*
+ * スロットテーブル。チャンク単位で伸ばすのでスロットのアドレスは解放まで変わらない
+ * (ma_sound はグラフから参照されるため移動できない)。空きは単方向リストで O(1)。
+ */
+typedef struct {
+    SoundSlot** chunks;
+    ma_uint32   chunk_count;
+    EmitterChunk** emit;    /* chunks と同じ並びの位置 */
+    ma_uint32   count;      /* 使ったことのあるスロット数 */
+    ma_uint32   free_head;  /* 空きリスト先頭 (index+1, 0=空) */
+} SlotTable;
+
+/* mmap したサウンドバンク。エントリは SE 読込で初めて使うときに resource manager へ登録する。 */
+typedef struct {
+    EngBank   map;
+    bool      used;
+    ma_uint32 refs;  /* このバンクから読み込んだ SE の数 (0 でないと解放できない) */
+    char**    keys;  /* エントリごとの登録名 (未登録は NULL) */
+} BankSlot;
+
+/* ── インサートエフェクト ───────────────────────────────*/
+/* 解析の結果 1 回分。FxNode が 2 面持つ */
+typedef struct {
+    ENG_MeterLevels levels;
+    float           power[ENG_METER_BINS];
+} MeterSnap;
+
+#define METER_SNAP_IDLE 2u  /* FxNode.reading: どの面も写していない */
+
+/* ノードグラフに挿す 1 入力 1 出力のノード。DSP 本体は eng_dsp.c。 */
+typedef struct {
+    ma_node_base base;                          /* 先頭 (ma_node* として渡す) */
+    EngDsp       dsp;                           /* オーディオスレッドのみ */
+    MA_ATOMIC(4, float)     param[ENG_FX_PARAM_COUNT]; /* スクリプトスレッドが書く目標値 */
+    MA_ATOMIC(4, ma_uint32) dirty;              /* param が変わった */
+
+    /*
+     * 解析のみ。オーディオスレッドが裏の面 (front ^ 1) に書いてから front を切り替え、
+     * スクリプトスレッドは reading に面を書いてから写す。オーディオスレッドは
+     * reading の面には書かず、その回の公開を飛ばす。
+     */
+    MeterSnap* snap;
+    MA_ATOMIC(4, ma_uint32) front;
+    MA_ATOMIC(4, ma_uint32) reading;
+    MA_ATOMIC(4, ma_uint32) reset;              /* eng_fx_reset_meter の要求 */
+    ma_uint32  published;                       /* 公開した時点の更新回数 (オーディオスレッドのみ) */
+} FxNode;
+
+typedef enum {
+    FX_TARGET_NONE,
+    FX_TARGET_BUS,
+    FX_TARGET_BGM,
+    FX_TARGET_SE,
+    FX_TARGET_MASTER,
+} FxTarget;
+
+typedef struct {
+    FxNode*    node;    /* グラフから参照されるので個別に確保する */
+    bool       used;
+    ma_uint32  target;  /* FxTarget */
+    ma_uint32  bus;     /* FX_TARGET_BUS の接続先 / FX_TARGET_MASTER の master_meters の位置 */
+    SoundSlot* sound;   /* FX_TARGET_BGM / SE の接続先 */
+    ma_uint32  next;    /* 同じ対象に次に掛かるエフェクト (FxID, 0=末尾) */
+} FxSlot;
+
+/* ── 録音 ───────────────────────────────────────────────*/
+/*
+ * 録音 1 回分。リングはオーディオスレッドが書き、書き出しスレッド
+ * (ヘッドレス時は render の呼び出し側) が読んでエンコーダに渡す。
+ */
+typedef struct {
+    struct ENG_Audio* owner;
+    ma_pcm_rb  ring;
+    ma_encoder enc;
+    FILE*      file;
+    char*      file_buf;    /* stdio のバッファ (ENG_RECORD_WRITE_BYTES)。書き込みをまとめる */
+    ma_int16*  s16;         /* 16bit で書くときの変換先 (ENG_RECORD_CHUNK フレーム) */
+    ma_uint32  channels;
+    bool       threaded;
+    ma_thread  thread;
+    MA_ATOMIC(4, ma_uint32) stop;   /* 1 = 残りを書いて終える */
+    MA_ATOMIC(4, ma_uint32) failed; /* 書き込みに失敗した (以後は読み捨てる) */
+} EngRecorder;
+
+/* ── コマンドキュー ─────────────────────────────────────*/
+/*
+ * 再生制御・パラメータ変更はスクリプトスレッドからリングに積み、
+ * オーディオスレッドがミックスブロックの境界でまとめて適用する。
+ */
+typedef enum {
+    CMD_PLAY,           /* BGM: 開始 / SE: 発音 (flag=1 なら f0 を音量に使う)。u = 開始時刻 (0=即時) */
+    CMD_STOP_AT,        /* u = 停止するエンジン時刻 (位置は保持) */
+    CMD_STOP,           /* 停止して先頭へ (SE は全ボイス) */
+    CMD_PAUSE,          /* 位置を保ったまま停止 */
+    CMD_SEEK,           /* u = フレーム位置 */
+    CMD_VOLUME,         /* f0 */
+    CMD_PITCH,          /* f0 */
+    CMD_PAN,            /* f0 */
+    CMD_LOOP,           /* flag */
+    CMD_FADE,           /* f0 → f1 を u ミリ秒で。flag: CMD_FADE_START | 完了時動作 << 1 */
+    CMD_CROSSFADE_IN,   /* 先頭から音量 0→1 で u ミリ秒かけて開始 */
+    CMD_MASTER_VOLUME,  /* f0 (slot 不要) */
+    CMD_CULL,           /* f0 = しきい値, u = 継続フレーム数 (slot 不要) */
+    CMD_BUS_VOLUME,     /* flag = バス, f0 (slot 不要。以下同じ) */
+    CMD_BUS_PAN,        /* flag = バス, f0 */
+    CMD_BUS_FADE,       /* flag = バス, f0 → f1 を u ミリ秒で */
+    CMD_BUS_MUTE,       /* flag = バス, u = 1 でミュート */
+    CMD_LOOP_POINTS,    /* BGM: u = 開始 << 32 | 終了 (エンジンのフレーム。終了 0xFFFFFFFF = 曲末) */
+    CMD_PRIORITY,       /* SE: flag = 優先度 (int) */
+    CMD_SPATIAL,        /* flag = ENG_SpatialParam, f0 */
+    CMD_EMITTER,        /* flag = CMD_VEC_*, (f0, f1, u の下位 32 ビット) = (x, y, z) */
+    CMD_LISTENER,       /* flag = CMD_VEC_*, ベクトルは CMD_EMITTER と同じ (slot 不要。以下同じ) */
+    CMD_SPATIAL_LOD,    /* f0 = 簡易定位に切り替える距離 */
+} CmdOp;
+
+#define CMD_FADE_START 1u
+
+/* CMD_EMITTER / CMD_LISTENER で設定するベクトル */
+enum { CMD_VEC_POSITION, CMD_VEC_VELOCITY, CMD_VEC_DIRECTION, CMD_VEC_UP };
+
+typedef struct {
+    ma_uint32  op;
+    ma_uint32  flag;
+    SoundSlot* slot;
+    float      f0, f1;
+    ma_uint64  u;
+} EngCmd;
+
+/* ── エンジン本体 ────────────────────────────────────────*/
+struct ENG_Audio {
+    ma_engine  engine;       /* デバイスを持たないエンジン。device のコールバックから引き出す */
+    ma_resource_manager rm;  /* 読込用。ヘッドレス時はジョブスレッドを持たず render 内で処理する */
+    ma_fence   loads;        /* 非同期読込の完了待ち (読込ごとに acquire、デコード完了で release) */
+    ma_context context;
+    ma_device  device;
+    bool       headless;
+
+    /*
+     * 再生デバイスの見張り。device / context を開く・閉じるのは見張りスレッドだけ
+     * (同期で開く生成時を除く)。取得系は device_lock を取ってから読む。
+     */
+    ma_device_config device_config;  /* 開き直しにも使う */
+    ma_backend   device_backend;     /* 指定されたバックエンド (device_backend_count=1 のとき) */
+    ma_uint32    device_backend_count;
+    bool         context_ready;
+    bool         device_ready;       /* device が初期化済み */
+    ma_uint32    device_reopens;
+    ma_thread    device_thread;
+    bool         device_threaded;
+    ma_event     device_wake;        /* 失った・開き直しを頼まれた・終了 */
+    ma_mutex     device_lock;
+    MA_ATOMIC(4, ma_uint32) device_state;   /* ENG_DeviceState */
+    MA_ATOMIC(4, ma_uint32) device_lost;    /* 開き直す */
+    MA_ATOMIC(4, ma_uint32) device_quit;
+    MA_ATOMIC(4, ma_uint32) device_closing; /* 自分で止めている (止まった通知を無視する) */
+    MA_ATOMIC(4, ma_uint32) device_reroutes;
+
+    ma_sound_group buses[ENG_BUS_COUNT]; /* マスター直下のグループ */
+    float      bus_volume[ENG_BUS_COUNT]; /* オーディオスレッド側の値 (ミュート中も保持) */
+    bool       bus_muted[ENG_BUS_COUNT];
+    /* スクリプトスレッドから見た値 (getter 用。キューの適用を待たない) */
+    float      master_shadow;
+    float      bus_volume_shadow[ENG_BUS_COUNT];
+    bool       bus_muted_shadow[ENG_BUS_COUNT];
+
+    /*
+     * コマンドキュー (単一生産者 = スクリプトスレッド / 単一消費者)。
+     * 消費は cmd_lock を取った側だけが行う。通常はオーディオスレッドだが、
+     * 解放や満杯時はスクリプトスレッドが奪って即時に吐き出す。
+     */
+    EngCmd*   cmds;
+    ma_uint32 cmd_mask;
+    MA_ATOMIC(4, ma_uint32) cmd_write;  /* 公開済みの書込位置 */
+    MA_ATOMIC(4, ma_uint32) cmd_read;   /* 消費済みの位置 */
+    MA_ATOMIC(4, ma_uint32) cmd_lock;   /* 1 = 消費中 */
+    ma_uint32 cmd_pending;              /* 未公開を含む書込位置 (生産側のみ) */
+    ma_uint32 batch_depth;              /* >0 の間は公開を遅らせる */
+    ma_uint32 cmd_high_water;
+    ma_uint32 cmd_overflows;
+
+    SlotTable  bgm;
+    SlotTable  se;
+    BankSlot*  banks;
+    ma_uint32  bank_count;
+    FxSlot*    fx;
+    ma_uint32  fx_count;
+    ma_uint32  bus_fx[ENG_BUS_COUNT]; /* バスに挿したエフェクトの先頭 (FxID, 0=なし) */
+    ma_uint32  master_fx;             /* マスターに挿した解析の先頭 (FxID, 0=なし) */
+    /*
+     * マスターの解析と録音はグラフの外でミックス結果に掛ける。オーディオスレッドは
+     * master_busy を立ててからここを読み、外す側は消してから master_busy が下りるのを待つ。
+     */
+    FxNode*    master_meters[ENG_MASTER_METERS]; /* atomic */
+    EngRecorder* recorder;                       /* atomic。録音中のみ */
+    MA_ATOMIC(4, ma_uint32) master_busy;
+    /* 録音の状況 (録音を始めたときに 0 に戻す) */
+    MA_ATOMIC(8, ma_uint64) rec_written;  /* 書き出し側が足す */
+    MA_ATOMIC(8, ma_uint64) rec_dropped;  /* オーディオスレッドが足す */
+    MA_ATOMIC(4, ma_uint32) rec_peak;     /* オーディオスレッドのみ書く */
+    ma_uint32  rec_frames;
+
+    /* 発音中のスロット (オーディオスレッドが毎ブロック見る) */
+    SoundSlot* live;
+    ma_uint64  service_time;  /* 前回見たときのエンジン時刻 */
+    float      cull_gain;
+    ma_uint64  cull_frames;
+    MA_ATOMIC(4, ma_uint32) bgm_released; /* 回収待ちの BGM がある */
+    /* 実際に鳴らす SE ボイスの上限 (0=無制限)。変更はスクリプトスレッドが engine_lock 中に行う */
+    ma_uint32  voice_budget;
+    VoiceRank* voice_heap;    /* 振り分け用の作業領域 (voice_budget 個) */
+    float      lod_distance;  /* これより遠い 3D の SE は簡易定位 (0=切り替えない) */
+
+    /* デコードキャッシュ (スクリプトスレッドのみ) */
+    CacheEntry** cache_buckets;   /* 2 の累乗個 */
+    ma_uint32    cache_bucket_count;
+    ma_uint32    cache_count;
+    CacheEntry*  lru_head;        /* 最も長く使われていない未使用エントリ */
+    CacheEntry*  lru_tail;
+    ma_uint64    cache_budget;
+    ma_uint64    cache_bytes;     /* 確定済み bytes の合計 */
+    ma_uint64    cache_encoded;   /* そのうち圧縮 SE の圧縮データ */
+    ma_uint64    cache_unused;    /* そのうち LRU に並んでいる分 */
+    ma_uint64    cache_hits;
+    ma_uint64    cache_misses;
+    ma_uint64    cache_evictions;
+    ma_uint32    decode_ahead_ms; /* 圧縮 SE の既定の先読み */
+    MA_ATOMIC(8, ma_uint64) enc_voice_bytes; /* 圧縮 SE のボイスのリング (ジョブが足す) */
+
+    EngStats     stats;
+};
+
+/* ── スロットテーブル ───────────────────────────────────*/
+static SoundSlot* slot_at(const SlotTable* t, ma_uint32 i) {
+    return &t->chunks[i >> ENG_SLOT_CHUNK_BITS][i & (ENG_SLOT_CHUNK - 1)];
+}
+
+static ENG_SoundID slot_id(const SoundSlot* s) {
+    return (ENG_SoundID)((s->gen << ENG_ID_INDEX_BITS) | (s->index + 1));
+}
+
+/* ID を検証してスロットを返す。解放済み・世代違いは NULL。 */
+static SoundSlot* slot_get(const SlotTable* t, ENG_SoundID id) {
+    ma_uint32 i = (id & ENG_ID_INDEX_MASK) - 1;
+    if ((id & ENG_ID_INDEX_MASK) == 0 || i >= t->count) return NULL;
+    SoundSlot* s = slot_at(t, i);
+    return s->used && s->gen == (id >> ENG_ID_INDEX_BITS) ? s : NULL;
+}
+
+/* 空きスロットを取り出す (used はまだ立てない)。足りなければチャンクを足す。 */
+static SoundSlot* slot_alloc(SlotTable* t) {
+    if (t->free_head) {
+        SoundSlot* s = slot_at(t, t->free_head - 1);
+        t->free_head = s->next_free;
+        s->next_free = 0;
+        return s;
+    }
+    if (t->count >= ENG_ID_INDEX_MASK) return NULL;
+    if (t->count == t->chunk_count * ENG_SLOT_CHUNK) {
+        ma_uint32   n      = t->chunk_count;
+        SoundSlot** chunks = realloc(t->chunks, sizeof(SoundSlot*) * (n + 1));
+        if (!chunks) return NULL;
+        t->chunks = chunks;
+        EmitterChunk** emit = realloc(t->emit, sizeof(EmitterChunk*) * (n + 1));
+        if (!emit) return NULL;
+        t->emit      = emit;
+        t->chunks[n] = calloc(ENG_SLOT_CHUNK, sizeof(SoundSlot));
+        t->emit[n]   = calloc(1, sizeof(EmitterChunk));
+        if (!t->chunks[n] || !t->emit[n]) {
+            free(t->chunks[n]);
+            free(t->emit[n]);
+            return NULL;
+        }
+        t->chunk_count++;
+    }
+    SoundSlot* s = slot_at(t, t->count);
+    s->index = t->count++;
+    s->emit  = t->emit[s->index >> ENG_SLOT_CHUNK_BITS];
+    return s;
+}
+
+/* スロットを空に戻す。世代を進めるので、それまでの ID は以後すべて無効になる。 */
+static void slot_release(SlotTable* t, SoundSlot* s) {
+    ma_uint32     index = s->index;
+    ma_uint32     gen   = s->gen;
+    EmitterChunk* emit  = s->emit;
+    memset(s, 0, sizeof(*s));
+    s->index     = index;
+    s->emit      = emit;
+    s->gen       = (gen + 1) & ENG_ID_GEN_MASK;
+    s->next_free = t->free_head;
+    t->free_head = index + 1;
+}
+
+static void slot_table_free(SlotTable* t) {
+    for (ma_uint32 i = 0; i < t->chunk_count; ++i) {
+        free(t->chunks[i]);
+        free(t->emit[i]);
+    }
+    free(t->chunks);
+    free(t->emit);
+    memset(t, 0, sizeof(*t));
+}
+
+/* ── エフェクトの配線 ───────────────────────────────────*/
+/*
+ * 対象ごとにエフェクトを FxSlot.next で単方向につなぎ、グラフを
+ * 音源 → fx → fx → ... → 出力先 の順に張る。付け外しはスクリプトスレッドで行い、
+ * 接続の切り替え自体は miniaudio のノードグラフがオーディオスレッドと排他する。
+ */
+static FxSlot* fx_at(ENG_Audio* a, ma_uint32 id) {
+    return &a->fx[id - 1];
+}
+
+/* チェーンの入口。エフェクトがなければ出力先そのもの。 */
+static ma_node* fx_entry(ENG_Audio* a, ma_uint32 head, ma_node* dest) {
+    return head ? (ma_node*)fx_at(a, head)->node : dest;
+}
+
+/* チェーン内を先頭から順につなぎ、末尾を dest に出す。 */
+static void fx_wire(ENG_Audio* a, ma_uint32 head, ma_node* dest) {
+    for (ma_uint32 i = head; i; i = fx_at(a, i)->next) {
+        FxSlot* f = fx_at(a, i);
+        ma_node_attach_output_bus(f->node, 0, fx_entry(a, f->next, dest), 0);
+    }
+}
+
+/*
+ * チェーンを master_meters の決まった位置に写す。位置は付けたときに決めて動かさないので、
+ * 付け外しの途中でも同じノードが 2 度処理されることはない。
+ */
+static void fx_rewire_master(ENG_Audio* a) {
+    FxNode* nodes[ENG_MASTER_METERS] = {0};
+    for (ma_uint32 i = a->master_fx; i; i = fx_at(a, i)->next) nodes[fx_at(a, i)->bus] = fx_at(a, i)->node;
+    for (ma_uint32 i = 0; i < ENG_MASTER_METERS; ++i) ma_atomic_store_ptr(&a->master_meters[i], nodes[i]);
+    while (ma_atomic_load_32(&a->master_busy)) ma_yield(); /* 外したノードを使い終えるまで */
+}
+
+static void fx_rewire_bus(ENG_Audio* a, ma_uint32 bus) {
+    ma_node* dest = ma_engine_get_endpoint(&a->engine);
+    fx_wire(a, a->bus_fx[bus], dest);
+    ma_node_attach_output_bus(&a->buses[bus], 0, fx_entry(a, a->bus_fx[bus], dest), 0);
+}
+
+/* BGM は本体、SE は全ボイスをチェーンの入口につなぐ (元データは鳴らさないので対象外)。 */
+static void fx_rewire_sound(ENG_Audio* a, SoundSlot* s) {
+    ma_node* dest  = (ma_node*)&a->buses[s->bus];
+    ma_node* entry = fx_entry(a, s->fx_head, dest);
+    fx_wire(a, s->fx_head, dest);
+    if (s->streaming) {
+        ma_node_attach_output_bus(&s->sound, 0, entry, 0);
+        return;
+    }
+    for (ma_uint32 i = 0; i < s->voice_count; ++i)
+        ma_node_attach_output_bus(&s->voices[i].sound, 0, entry, 0);
+}
+
+/* 対象のチェーン先頭が入っている場所。 */
+static ma_uint32* fx_head_of(ENG_Audio* a, const FxSlot* f) {
+    switch ((FxTarget)f->target) {
+    case FX_TARGET_BUS:    return &a->bus_fx[f->bus];
+    case FX_TARGET_MASTER: return &a->master_fx;
+    case FX_TARGET_BGM:
+    case FX_TARGET_SE:     return &f->sound->fx_head;
+    default:               return NULL;
+    }
+}
+
+static void fx_rewire(ENG_Audio* a, const FxSlot* f) {
+    if (f->target == FX_TARGET_BUS) fx_rewire_bus(a, f->bus);
+    else if (f->target == FX_TARGET_MASTER) fx_rewire_master(a);
+    else if (f->target != FX_TARGET_NONE) fx_rewire_sound(a, f->sound);
+}
+
+/* チェーンから外して出力を切る。残ったチェーンはつなぎ直す。 */
+static void fx_unlink(ENG_Audio* a, ma_uint32 id) {
+    FxSlot*    f    = fx_at(a, id);
+    ma_uint32* head = fx_head_of(a, f);
+    if (!head) return;
+    while (*head != id) head = &fx_at(a, *head)->next;
+    *head = f->next;
+    FxSlot target = *f;
+    f->target = FX_TARGET_NONE;
+    f->sound  = NULL;
+    f->next   = 0;
+    fx_rewire(a, &target);
+    ma_node_detach_output_bus(f->node, 0);
+}
+
+/* チェーンの末尾に足してつなぎ直す。f の接続先は設定済みであること。 */
+static void fx_link(ENG_Audio* a, ma_uint32 id) {
+    ma_uint32* head = fx_head_of(a, fx_at(a, id));
+    while (*head) head = &fx_at(a, *head)->next;
+    *head = id;
+    fx_rewire(a, fx_at(a, id));
+}
+
+/* BGM / SE を解放する前に、挿していたエフェクトを全て外す (破棄はしない)。 */
+static void fx_clear(ENG_Audio* a, SoundSlot* s) {
+    for (ma_uint32 i = s->fx_head; i;) {
+        FxSlot* f = fx_at(a, i);
+        i = f->next;
+        ma_node_detach_output_bus(f->node, 0);
+        f->target = FX_TARGET_NONE;
+        f->sound  = NULL;
+        f->next   = 0;
+    }
+    s->fx_head = 0;
+}
+
+static void fx_node_free(FxNode* n) {
+    eng_dsp_uninit(&n->dsp);
+    free(n->snap);
+    free(n);
+}
+
+static SoundSlot* bgm_slot(ENG_Audio* a, ENG_SoundID id) {
+    SoundSlot* s = a ? slot_get(&a->bgm, id) : NULL;
+    return s && !ma_atomic_load_32(&s->released) ? s : NULL;
+}
+static SoundSlot* se_slot(ENG_Audio* a, ENG_SoundID id) {
+    return a ? slot_get(&a->se, id) : NULL;
+}
+
+/* ── エフェクトの処理 (オーディオスレッド) ─────────────*/
+/* 解析が進んでいたら裏の面に書いて表に出す。読む側が裏を写している間は次の回に回す。 */
+static void meter_publish(FxNode* n) {
+    ma_uint32 updates = eng_dsp_meter_updates(&n->dsp);
+    if (updates == n->published) return;
+    ma_uint32 back = ma_atomic_load_32(&n->front) ^ 1u;
+    if (ma_atomic_load_32(&n->reading) == back) return;
+    MeterSnap* snap = &n->snap[back];
+    eng_dsp_meter_levels(&n->dsp, &snap->levels);
+    memcpy(snap->power, eng_dsp_meter_power(&n->dsp), sizeof(snap->power));
+    ma_atomic_store_32(&n->front, back);
+    n->published = updates;
+}
+
+/* 変わったパラメータを DSP に渡してから処理する。 */
+static void fx_node_run(FxNode* n, const float* in, float* out, ma_uint32 frames) {
+    if (ma_atomic_exchange_32(&n->dirty, 0)) {
+        for (ma_uint32 i = 0; i < ENG_FX_PARAM_COUNT; ++i)
+            eng_dsp_set(&n->dsp, (ENG_FxParam)i, ma_atomic_load_f32(&n->param[i]));
+    }
+    if (n->snap && ma_atomic_exchange_32(&n->reset, 0)) eng_dsp_meter_reset(&n->dsp);
+    eng_dsp_process(&n->dsp, in, out, frames);
+    if (n->snap) meter_publish(n);
+}
+
+/* ── 録音 (オーディオスレッド / 書き出しスレッド) ──────*/
+/* ミックス結果をリングに写す (オーディオスレッド)。入りきらない分は捨てて数える。 */
+static void record_push(EngRecorder* r, const float* in, ma_uint64 frames) {
+    ENG_Audio* a    = r->owner;
+    ma_uint64  done = 0;
+    while (done < frames) {
+        ma_uint32 n = (ma_uint32)ma_min(frames - done, 0xFFFFFFFF);
+        void*     dst;
+        if (ma_pcm_rb_acquire_write(&r->ring, &n, &dst) != MA_SUCCESS || n == 0) break;
+        memcpy(dst, in + done * r->channels, (size_t)n * r->channels * sizeof(float));
+        ma_pcm_rb_commit_write(&r->ring, n);
+        done += n;
+    }
+    if (done < frames) ma_atomic_fetch_add_64(&a->rec_dropped, frames - done);
+    ma_uint32 fill = ma_pcm_rb_available_read(&r->ring);
+    if (fill > ma_atomic_load_32(&a->rec_peak)) ma_atomic_store_32(&a->rec_peak, fill);
+}
+
+/* マスターの解析と録音にミックス結果を渡す。 */
+static void master_taps_run(ENG_Audio* a, float* out, ma_uint64 frames) {
+    ma_atomic_store_32(&a->master_busy, 1);
+    for (ma_uint32 i = 0; i < ENG_MASTER_METERS; ++i) {
+        FxNode* n = (FxNode*)ma_atomic_load_ptr(&a->master_meters[i]);
+        if (n) fx_node_run(n, out, out, (ma_uint32)frames);
+    }
+    EngRecorder* r = (EngRecorder*)ma_atomic_load_ptr(&a->recorder);
+    if (r) record_push(r, out, frames);
+    ma_atomic_store_32(&a->master_busy, 0);
+}
+
+/* 64 ビットのオフセットでシークする (long が 32 ビットの環境でも 2GB を超えられる)。成功で 0。 */
+static int file_seek64(FILE* f, ma_int64 offset, int whence) {
+#ifdef _WIN32
+    return _fseeki64(f, offset, whence);
+#else
+    return fseeko(f, (off_t)offset, whence);
+#endif
+}
+
+/* エンコーダの書き込み先。stdio のバッファで大きな書き込みにまとまる。 */
+static ma_result record_file_write(ma_encoder* e, const void* buf, size_t bytes, size_t* written) {
+    EngRecorder* r = (EngRecorder*)e->pUserData;
+    *written = fwrite(buf, 1, bytes, r->file);
+    return *written == bytes ? MA_SUCCESS : MA_IO_ERROR;
+}
+
+static ma_result record_file_seek(ma_encoder* e, ma_int64 offset, ma_seek_origin origin) {
+    EngRecorder* r      = (EngRecorder*)e->pUserData;
+    int          whence = origin == ma_seek_origin_start ? SEEK_SET
+                        : origin == ma_seek_origin_end   ? SEEK_END : SEEK_CUR;
+    return file_seek64(r->file, offset, whence) == 0 ? MA_SUCCESS : MA_IO_ERROR;
+}
+
+/* リングに溜まった分をエンコーダに渡す (書き出し側)。戻り値: 取り出したフレーム数。 */
+static ma_uint64 record_drain(EngRecorder* r) {
+    ma_uint64 total = 0;
+    for (;;) {
+        ma_uint32 n = ENG_RECORD_CHUNK;
+        void*     src;
+        if (ma_pcm_rb_acquire_read(&r->ring, &n, &src) != MA_SUCCESS || n == 0) break;
+        if (!ma_atomic_load_32(&r->failed)) {
+            const void* buf = src;
+            if (r->s16) {
+                ma_pcm_f32_to_s16(r->s16, src, (ma_uint64)n * r->channels, ma_dither_mode_none);
+                buf = r->s16;
+            }
+            ma_uint64 wrote = 0;
+            if (ma_encoder_write_pcm_frames(&r->enc, buf, n, &wrote) != MA_SUCCESS || wrote < n) {
+                fprintf(stderr, "[eng_audio] 録音ファイルへの書き込み失敗\n");
+                ma_atomic_store_32(&r->failed, 1);
+            }
+            ma_atomic_fetch_add_64(&r->owner->rec_written, wrote);
+        }
+        ma_pcm_rb_commit_read(&r->ring, n);
+        total += n;
+    }
+    return total;
+}
+
+/* 書き出しスレッド。止めるよう頼まれたら、その時点でリングにある分を書いて終える。 */
+static ma_thread_result MA_THREADCALL record_thread(void* data) {
+    EngRecorder* r = (EngRecorder*)data;
+    while (!ma_atomic_load_32(&r->stop)) {
+        if (record_drain(r) == 0) ma_sleep(ENG_RECORD_POLL_MS);
+    }
+    record_drain(r);
+    return (ma_thread_result)0;
+}
+
+/* ファイルを閉じて解放する。戻り値: 最後まで書けたか。 */
+static bool record_close(EngRecorder* r) {
+    bool ok = !ma_atomic_load_32(&r->failed);
+    ma_encoder_uninit(&r->enc); /* ヘッダのサイズを書き直す */
+    if (fclose(r->file) != 0) ok = false;
+    ma_pcm_rb_uninit(&r->ring);
+    free(r->file_buf);
+    free(r->s16);
+    free(r);
+    return ok;
+}
+
+/* ── 3D 定位 ────────────────────────────────────────────*/
+static const float k_spatial_default[ENG_SPATIAL_PARAM_COUNT] = {
+    0.0f, (float)ma_attenuation_model_inverse, 1.0f, FLT_MAX, 1.0f, 360.0f, 360.0f, 0.0f, 1.0f,
+};
+
+static bool spatial_on(const SoundSlot* s) {
+    return s->spatial.param[ENG_SPATIAL_ENABLED] != 0.0f;
+}
+
+/* 位置を書く (スクリプトスレッド)。 */
+static void emitter_store(SoundSlot* s, float x, float y, float z) {
+    ma_uint32 lane = s->index & (ENG_SLOT_CHUNK - 1);
+    ma_atomic_store_explicit_f32(&s->emit->x[lane], x, ma_atomic_memory_order_relaxed);
+    ma_atomic_store_explicit_f32(&s->emit->y[lane], y, ma_atomic_memory_order_relaxed);
+    ma_atomic_store_explicit_f32(&s->emit->z[lane], z, ma_atomic_memory_order_relaxed);
+}
+
+/* 読込時に 3D 設定を既定値 (2D、原点) にする。 */
+static void spatial_init(SoundSlot* s) {
+    memcpy(s->spatial.param, k_spatial_default, sizeof(k_spatial_default));
+    s->spatial.velocity  = ma_vec3f_init_3f(0.0f, 0.0f, 0.0f);
+    s->spatial.direction = ma_vec3f_init_3f(0.0f, 0.0f, -1.0f);
+    s->spatial.lod       = false;
+    s->spatial.gain      = 1.0f;
+    s->spatial.lod_gain  = 1.0f;
+    s->spatial.lod_pan   = 0.0f;
+    emitter_store(s, 0.0f, 0.0f, 0.0f);
+}
+
+/* ma_sound 1 つに設定項目 p を反映する。 */
+static void spatial_apply(ma_sound* snd, const EngSpatial* sp, ma_uint32 p) {
+    const float* v = sp->param;
+    switch (p) {
+    case ENG_SPATIAL_ENABLED:
+        ma_sound_set_spatialization_enabled(snd, v[p] != 0.0f && !sp->lod);
+        break;
+    case ENG_SPATIAL_MODEL:        ma_sound_set_attenuation_model(snd, (ma_attenuation_model)(int)v[p]); break;
+    case ENG_SPATIAL_MIN_DISTANCE: ma_sound_set_min_distance(snd, v[p]); break;
+    case ENG_SPATIAL_MAX_DISTANCE: ma_sound_set_max_distance(snd, v[p]); break;
+    case ENG_SPATIAL_ROLLOFF:      ma_sound_set_rolloff(snd, v[p]); break;
+    case ENG_SPATIAL_CONE_INNER:
+    case ENG_SPATIAL_CONE_OUTER:
+    case ENG_SPATIAL_CONE_OUTER_GAIN:
+        ma_sound_set_cone(snd, ma_degrees_to_radians_f(v[ENG_SPATIAL_CONE_INNER]),
+                          ma_degrees_to_radians_f(v[ENG_SPATIAL_CONE_OUTER]), v[ENG_SPATIAL_CONE_OUTER_GAIN]);
+        break;
+    case ENG_SPATIAL_DOPPLER:      ma_sound_set_doppler_factor(snd, v[p]); break;
+    }
+}
+
+static void spatial_apply_vec(ma_sound* snd, ma_uint32 which, ma_vec3f v) {
+    if (which == CMD_VEC_VELOCITY) ma_sound_set_velocity(snd, v.x, v.y, v.z);
+    else                           ma_sound_set_direction(snd, v.x, v.y, v.z);
+}
+
+/* 作ったばかりの ma_sound に 3D 設定を全て反映する。 */
+static void spatial_apply_all(ma_sound* snd, const EngSpatial* sp) {
+    for (ma_uint32 p = 0; p < ENG_SPATIAL_PARAM_COUNT; ++p) spatial_apply(snd, sp, p);
+    spatial_apply_vec(snd, CMD_VEC_VELOCITY, sp->velocity);
+    spatial_apply_vec(snd, CMD_VEC_DIRECTION, sp->direction);
+}
+
+/* ボイスの音量を ma_sound に渡す。簡易定位中は距離減衰を掛ける。 */
+static void se_voice_apply_volume(const SoundSlot* s, SEVoice* v) {
+    ma_sound_set_volume(&v->sound, s->spatial.lod ? v->volume * s->spatial.lod_gain : v->volume);
+}
+
+/* 簡易定位の切り替え。3D に戻すときはパンと音量も元に戻す。 */
+static void spatial_set_lod(SoundSlot* s, bool lod) {
+    if (s->spatial.lod == lod) return;
+    s->spatial.lod = lod;
+    for (ma_uint32 i = 0; i < s->voice_count; ++i) {
+        SEVoice* v = &s->voices[i];
+        spatial_apply(&v->sound, &s->spatial, ENG_SPATIAL_ENABLED);
+        if (!lod) {
+            ma_sound_set_pan(&v->sound, s->pan);
+            se_voice_apply_volume(s, v);
+        }
+    }
+}
+
+/* 設定項目をスロットの全ての ma_sound に反映する (オーディオスレッド)。 */
+static void spatial_set(SoundSlot* s, ma_uint32 p, float value) {
+    s->spatial.param[p] = value;
+    if (p == ENG_SPATIAL_ENABLED && value == 0.0f) {
+        spatial_set_lod(s, false);
+        s->spatial.gain = 1.0f;
+    }
+    spatial_apply(&s->sound, &s->spatial, p);
+    for (ma_uint32 i = 0; i < s->voice_count; ++i) spatial_apply(&s->voices[i].sound, &s->spatial, p);
+}
+static void spatial_set_vec(SoundSlot* s, ma_uint32 which, ma_vec3f v) {
+    if (which == CMD_VEC_VELOCITY) s->spatial.velocity  = v;
+    else                           s->spatial.direction = v;
+    spatial_apply_vec(&s->sound, which, v);
+    for (ma_uint32 i = 0; i < s->voice_count; ++i) spatial_apply_vec(&s->voices[i].sound, which, v);
+}
+
+/*
+ * 簡易定位の音量とパンを求める。ma_spatializer と同じく、聴取者から見た方向と
+ * 出力の左右のチャンネルの向き (聴取者のチャンネルマップ) の内積から L/R の係数を出し
+ * (反対側も minSpatializationChannelGain までは残す)、その後にユーザーのパン (バランス) を掛ける。
+ * ma_sound のパンもバランスなので、大きい側を音量に、小さい側との比をパンにすれば
+ * 3D で鳴らしたときと同じ L/R になる。
+ */
+static void spatial_lod_mix(const ma_spatializer* sp, const ma_spatializer_listener* l, ma_vec3f rel, float d,
+                            float g, float user_pan, float* gain, float* pan) {
+    float lr[2] = { 1.0f, 1.0f };
+    if (d > 0.001f && l->config.channelsOut >= 2) {
+        ma_vec3f u = ma_vec3f_init_3f(rel.x / d, rel.y / d, rel.z / d);
+        for (ma_uint32 i = 0; i < 2; ++i) {
+            ma_channel ch = ma_channel_map_get_channel(l->config.pChannelMapOut, l->config.channelsOut, i);
+            if (!ma_is_spatial_channel_position(ch)) continue;
+            float k = ma_mix_f32_fast(1.0f, ma_vec3f_dot(u, ma_get_channel_direction(ch)),
+                                      ma_spatializer_get_directional_attenuation_factor(sp));
+            lr[i] = ma_max((k + 1.0f) * 0.5f, sp->minSpatializationChannelGain);
+        }
+    }
+    if (user_pan > 0.0f) lr[0] *= 1.0f - user_pan;
+    else                 lr[1] *= 1.0f + user_pan;
+    float peak = ma_max(lr[0], lr[1]);
+    *gain = g * peak;
+    *pan  = peak <= 0.0f ? 0.0f : lr[1] < lr[0] ? lr[1] / peak - 1.0f : 1.0f - lr[0] / peak;
+}
+
+/*
+ * 3D のスロットに位置を反映し、距離減衰を見積もる (オーディオスレッド、ブロックごと)。
+ * SE は聴取者から lod_distance より遠ければ 3D 処理を外し、見積もった減衰とパンで鳴らす
+ * (spatial_lod_mix。境目で音量が飛ばないよう 3D と同じパンの法則を使う)。
+ */
+static void spatial_service(ENG_Audio* a, SoundSlot* s) {
+    ma_uint32 lane = s->index & (ENG_SLOT_CHUNK - 1);
+    ma_vec3f  pos  = ma_vec3f_init_3f(
+        ma_atomic_load_explicit_f32(&s->emit->x[lane], ma_atomic_memory_order_relaxed),
+        ma_atomic_load_explicit_f32(&s->emit->y[lane], ma_atomic_memory_order_relaxed),
+        ma_atomic_load_explicit_f32(&s->emit->z[lane], ma_atomic_memory_order_relaxed));
+    ma_sound_set_position(&s->sound, pos.x, pos.y, pos.z);
+    if (s->streaming) return;
+
+    /* SE の元データの ma_sound は鳴らさないが、聴取者から見た位置の計算に使う */
+    ma_vec3f rel;
+    ma_spatializer_get_relative_position_and_direction(&s->sound.engineNode.spatializer,
+                                                       &a->engine.listeners[0], &rel, NULL);
+    const float* v = s->spatial.param;
+    float d = ma_vec3f_len(rel);
+    float g = 1.0f;
+    switch ((ma_attenuation_model)(int)v[ENG_SPATIAL_MODEL]) {
+    case ma_attenuation_model_inverse:
+        g = ma_attenuation_inverse(d, v[ENG_SPATIAL_MIN_DISTANCE], v[ENG_SPATIAL_MAX_DISTANCE], v[ENG_SPATIAL_ROLLOFF]);
+        break;
+    case ma_attenuation_model_linear:
+        g = ma_attenuation_linear(d, v[ENG_SPATIAL_MIN_DISTANCE], v[ENG_SPATIAL_MAX_DISTANCE], v[ENG_SPATIAL_ROLLOFF]);
+        break;
+    case ma_attenuation_model_exponential:
+        g = ma_attenuation_exponential(d, v[ENG_SPATIAL_MIN_DISTANCE], v[ENG_SPATIAL_MAX_DISTANCE], v[ENG_SPATIAL_ROLLOFF]);
+        break;
+    default:
+        break;
+    }
+    s->spatial.gain = ma_clamp(g, 0.0f, 1.0f);
+    spatial_set_lod(s, a->lod_distance > 0.0f && d > a->lod_distance);
+
+    if (s->spatial.lod)
+        spatial_lod_mix(&s->sound.engineNode.spatializer, &a->engine.listeners[0], rel, d, s->spatial.gain, s->pan,
+                        &s->spatial.lod_gain, &s->spatial.lod_pan);
+    for (ma_uint32 i = 0; i < s->voice_count; ++i) {
+        SEVoice* sv = &s->voices[i];
+        if (s->spatial.lod) {
+            ma_sound_set_pan(&sv->sound, s->spatial.lod_pan);
+            se_voice_apply_volume(s, sv);
+        } else {
+            ma_sound_set_position(&sv->sound, pos.x, pos.y, pos.z);
+        }
+    }
+}
+
+/* ── 圧縮 SE ────────────────────────────────────────────*/
+static ma_uint32 enc_frame_bytes(const EncAsset* as) {
+    return as->channels * (ma_uint32)sizeof(float);
+}
+
+/* 元データが持つバイト数 (圧縮データ + 先頭の PCM。バンクのマップは数えない) */
+static ma_uint64 enc_asset_bytes(const EncAsset* as) {
+    return (as->owned ? as->size : 0) + as->head_frames * enc_frame_bytes(as);
+}
+
+static void enc_asset_free(EncAsset* as) {
+    if (!as) return;
+    ma_free(as->owned, NULL);
+    free(as->head);
+    free(as);
+}
+
+/*
+ * 圧縮 SE の元データを作る。data=NULL なら path のファイルを丸ごと読む。
+ * 先頭 ahead_ms を素材のレートのままデコードし、全体が収まれば圧縮データは捨てる。
+ */
+static EncAsset* enc_asset_open(ma_vfs* vfs, const char* path, const void* data, size_t size,
+                                ma_uint32 ahead_ms, ma_result* result) {
+    EncAsset* as = calloc(1, sizeof(EncAsset));
+    *result = MA_OUT_OF_MEMORY;
+    if (!as) return NULL;
+    if (!data) {
+        *result = ma_vfs_open_and_read_file(vfs, path, &as->owned, &size, NULL);
+        if (*result != MA_SUCCESS) { free(as); return NULL; }
+        data = as->owned;
+    }
+    as->data = data;
+    as->size = size;
+    ma_decoder_config dc = ma_decoder_config_init(ma_format_f32, 0, 0);
+    ma_decoder        dec;
+    *result = ma_decoder_init_memory(data, size, &dc, &dec);
+    if (*result != MA_SUCCESS) { enc_asset_free(as); return NULL; }
+    ma_decoder_get_data_format(&dec, NULL, &as->channels, &as->sample_rate, as->map, MA_MAX_CHANNELS);
+    if (ma_decoder_get_length_in_pcm_frames(&dec, &as->length) != MA_SUCCESS || as->length == 0) {
+        fprintf(stderr, "[eng_audio] 長さが分からないため圧縮 SE にできない '%s'\n", path);
+        *result = MA_INVALID_FILE;
+    } else {
+        ma_uint64 ahead = ma_max((ma_uint64)ahead_ms * as->sample_rate / 1000, ENG_DECODE_AHEAD_MIN);
+        as->head_frames = ma_min(ahead, as->length);
+        as->ring_frames = (ma_uint32)ma_min(ma_min(ahead, as->length - as->head_frames), 0x7FFFFFFF);
+        as->head        = malloc((size_t)(as->head_frames * enc_frame_bytes(as)));
+        if (!as->head) *result = MA_OUT_OF_MEMORY;
+    }
+    if (*result == MA_SUCCESS) {
+        ma_uint64 got = 0;
+        ma_decoder_read_pcm_frames(&dec, as->head, as->head_frames, &got);
+        /* 長さより早く尽きた分は無音 */
+        memset(as->head + got * as->channels, 0, (size_t)((as->head_frames - got) * enc_frame_bytes(as)));
+    }
+    ma_decoder_uninit(&dec);
+    if (*result != MA_SUCCESS) { enc_asset_free(as); return NULL; }
+    if (as->head_frames == as->length) {
+        ma_free(as->owned, NULL);
+        as->owned = NULL;
+        as->data  = NULL;
+        as->size  = 0;
+    }
+    return as;
+}
+
+/* ボイス用のデコーダとリングを作る (ジョブ)。 */
+static bool enc_stream_open_ring(EncStream* st) {
+    const EncAsset*   as = st->asset;
+    ma_decoder_config dc = ma_decoder_config_init(ma_format_f32, as->channels, as->sample_rate);
+    if (ma_decoder_init_memory(as->data, as->size, &dc, &st->dec) != MA_SUCCESS) return false;
+    if (ma_pcm_rb_init(ma_format_f32, as->channels, as->ring_frames, NULL, NULL, &st->ring) != MA_SUCCESS) {
+        ma_decoder_uninit(&st->dec);
+        return false;
+    }
+    ma_atomic_fetch_add_64(&st->owner->enc_voice_bytes, (ma_uint64)as->ring_frames * enc_frame_bytes(as));
+    return true;
+}
+
+/*
+ * リングを埋める (ジョブ)。読み直しを頼まれていれば中身を捨てて target からデコードし直す。
+ * 埋め終えてから ring_gen を揃えるので、それまでオーディオスレッドはリングを読まない。
+ */
+static void enc_stream_fill(EncStream* st) {
+    const EncAsset* as    = st->asset;
+    ma_uint32       state = ma_atomic_load_32(&st->ring_state);
+    if (state == ENC_RING_FAILED) return;
+    if (state == ENC_RING_NONE) {
+        if (!enc_stream_open_ring(st)) {
+            fprintf(stderr, "[eng_audio] 圧縮 SE のデコーダを作れない\n");
+            ma_atomic_store_32(&st->ring_state, ENC_RING_FAILED);
+            return;
+        }
+        ma_atomic_store_32(&st->ring_state, ENC_RING_READY);
+    }
+    ma_uint32 g = ma_atomic_load_32(&st->gen);
+    if (g != ma_atomic_load_32(&st->ring_gen)) {
+        ma_uint64 pos = ma_atomic_load_64(&st->target);
+        ma_pcm_rb_reset(&st->ring);
+        ma_decoder_seek_to_pcm_frame(&st->dec, pos);
+        st->dec_pos = pos;
+    }
+    ma_uint32 bpf = enc_frame_bytes(as);
+    while (st->dec_pos < as->length && ma_atomic_load_32(&st->gen) == g) {
+        ma_uint32 n = ma_pcm_rb_available_write(&st->ring);
+        if (n > as->length - st->dec_pos) n = (ma_uint32)(as->length - st->dec_pos);
+        void* buf;
+        if (n == 0 || ma_pcm_rb_acquire_write(&st->ring, &n, &buf) != MA_SUCCESS || n == 0) break;
+        ma_uint64 got = 0;
+        ma_decoder_read_pcm_frames(&st->dec, buf, n, &got);
+        if (got < n) memset((char*)buf + got * bpf, 0, (size_t)((n - got) * bpf));
+        ma_pcm_rb_commit_write(&st->ring, n);
+        st->dec_pos += n;
+    }
+    ma_atomic_store_32(&st->ring_gen, g);
+}
+
+static ma_result enc_stream_job(ma_job* job) {
+    EncStream* st = (EncStream*)job->data.custom.data0;
+    enc_stream_fill(st);
+    ma_atomic_store_32(&st->busy, 0); /* 以後 st には触らない (解放する側が待っている) */
+    return MA_SUCCESS;
+}
+
+/*
+ * 読み直しか、リングの残りが半分を切っていれば補充をジョブに頼む (オーディオスレッド)。
+ * ヘッドレス時はジョブスレッドがないので、その場で埋める。
+ */
+static void enc_stream_request(EncStream* st) {
+    const EncAsset* as = st->asset;
+    if (!as->data || ma_atomic_load_32(&st->ring_state) == ENC_RING_FAILED) return;
+    if (ma_atomic_load_32(&st->ring_gen) == ma_atomic_load_32(&st->gen)) {
+        ma_uint64 avail = ma_pcm_rb_available_read(&st->ring);
+        if (st->ring_next + avail >= as->length || avail >= as->ring_frames / 2) return;
+    }
+    if (ma_atomic_exchange_32(&st->busy, 1)) return;
+    if (st->owner->headless) {
+        enc_stream_fill(st);
+        ma_atomic_store_32(&st->busy, 0);
+        return;
+    }
+    ma_job job = ma_job_init(MA_JOB_TYPE_CUSTOM);
+    job.data.custom.proc  = enc_stream_job;
+    job.data.custom.data0 = (ma_uintptr)st;
+    if (ma_resource_manager_post_job(&st->owner->rm, &job) != MA_SUCCESS)
+        ma_atomic_store_32(&st->busy, 0); /* 次の読み出しで頼み直す */
+}
+
+static ma_result enc_stream_read(ma_data_source* ds, void* out, ma_uint64 frames, ma_uint64* read) {
+    EncStream*      st      = (EncStream*)ds;
+    const EncAsset* as      = st->asset;
+    ma_uint32       bpf     = enc_frame_bytes(as);
+    ma_uint64       done    = 0;
+    bool            stalled = false;
+    while (done < frames && st->cursor < as->length) {
+        ma_uint64 n   = ma_min(frames - done, as->length - st->cursor);
+        char*     dst = (char*)out + done * bpf;
+        if (st->cursor < as->head_frames) {
+            n = ma_min(n, as->head_frames - st->cursor);
+            memcpy(dst, as->head + st->cursor * as->channels, (size_t)(n * bpf));
+        } else {
+            ma_uint32 k = (ma_uint32)ma_min(n, 0xFFFFFFFF);
+            void*     src;
+            if (ma_atomic_load_32(&st->ring_gen) != ma_atomic_load_32(&st->gen)
+                || ma_pcm_rb_acquire_read(&st->ring, &k, &src) != MA_SUCCESS || k == 0) {
+                stalled = true; /* 先読みが間に合っていない */
+                break;
+            }
+            memcpy(dst, src, (size_t)k * bpf);
+            ma_pcm_rb_commit_read(&st->ring, k);
+            st->ring_next += k;
+            n = k;
+        }
+        st->cursor += n;
+        done       += n;
+    }
+    enc_stream_request(st);
+    *read = done;
+    if (stalled) {
+        stat_add64(&st->owner->stats.stalls, 1);
+        return MA_BUSY;
+    }
+    return done == 0 && st->cursor >= as->length ? MA_AT_END : MA_SUCCESS;
+}
+
+/* 先頭の範囲へのシークはその場で済む。その先はリングを frame から埋め直させる。 */
+static ma_result enc_stream_seek(ma_data_source* ds, ma_uint64 frame) {
+    EncStream*      st   = (EncStream*)ds;
+    const EncAsset* as   = st->asset;
+    ma_uint64       from = ma_max(frame, as->head_frames); /* リングは先頭の続きから */
+    st->cursor = frame;
+    if (as->data && from < as->length && from != st->ring_next) {
+        st->ring_next = from;
+        ma_atomic_store_64(&st->target, from);
+        ma_atomic_fetch_add_32(&st->gen, 1);
+        enc_stream_request(st);
+    }
+    return MA_SUCCESS;
+}
+
+static ma_result enc_stream_format(ma_data_source* ds, ma_format* format, ma_uint32* channels,
+                                   ma_uint32* rate, ma_channel* map, size_t map_cap) {
+    const EncAsset* as = ((EncStream*)ds)->asset;
+    if (format)   *format   = ma_format_f32;
+    if (channels) *channels = as->channels;
+    if (rate)     *rate     = as->sample_rate;
+    if (map)      memcpy(map, as->map, sizeof(ma_channel) * ma_min(map_cap, as->channels));
+    return MA_SUCCESS;
+}
+
+static ma_result enc_stream_cursor(ma_data_source* ds, ma_uint64* cursor) {
+    *cursor = ((EncStream*)ds)->cursor;
+    return MA_SUCCESS;
+}
+
+static ma_result enc_stream_length(ma_data_source* ds, ma_uint64* length) {
+    *length = ((EncStream*)ds)->asset->length;
+    return MA_SUCCESS;
+}
+
+static ma_data_source_vtable g_enc_stream_vtable = {
+    enc_stream_read,
+    enc_stream_seek,
+    enc_stream_format,
+    enc_stream_cursor,
+    enc_stream_length,
+    NULL,
+    0,
+};
+
+static EncStream* enc_stream_open(ENG_Audio* a, EncAsset* as) {
+    EncStream* st = calloc(1, sizeof(EncStream));
+    if (!st) return NULL;
+    ma_data_source_config dsc = ma_data_source_config_init();
+    dsc.vtable = &g_enc_stream_vtable;
+    if (ma_data_source_init(&dsc, &st->base) != MA_SUCCESS) {
+        free(st);
+        return NULL;
+    }
+    st->asset     = as;
+    st->owner     = a;
+    st->ring_next = as->head_frames;
+    ma_atomic_store_64(&st->target, as->head_frames);
+    ma_atomic_store_32(&st->gen, 1); /* ring_gen = 0 なのでリングは空扱い */
+    return st;
+}
+
+/* 頼んだジョブが終わるのを待って解放する (スクリプトスレッド。読む ma_sound は先に破棄しておく)。 */
+static void enc_stream_close(EncStream* st) {
+    if (!st) return;
+    while (ma_atomic_load_32(&st->busy)) ma_yield();
+    if (ma_atomic_load_32(&st->ring_state) == ENC_RING_READY) {
+        ma_decoder_uninit(&st->dec);
+        ma_pcm_rb_uninit(&st->ring);
+        ma_atomic_fetch_sub_64(&st->owner->enc_voice_bytes,
+                               (ma_uint64)st->asset->ring_frames * enc_frame_bytes(st->asset));
+    }
+    ma_data_source_uninit(&st->base);
+    free(st);
+}
+
+/* ボイスを 1 つ作る。圧縮 SE は自前の読み出し元を、それ以外は元データを共有する。 */
+static ma_result se_voice_init(ENG_Audio* a, SoundSlot* s, SEVoice* v) {
+    if (!s->enc)
+        return ma_sound_init_copy(&a->engine, &s->sound, MA_SOUND_FLAG_NO_SPATIALIZATION, &a->buses[s->bus], &v->sound);
+    v->enc = enc_stream_open(a, s->enc->asset);
+    if (!v->enc) return MA_OUT_OF_MEMORY;
+    ma_result r = ma_sound_init_from_data_source(&a->engine, v->enc, MA_SOUND_FLAG_NO_SPATIALIZATION,
+                                                 &a->buses[s->bus], &v->sound);
+    if (r != MA_SUCCESS) {
+        enc_stream_close(v->enc);
+        v->enc = NULL;
+    }
+    return r;
+}
+
+static void se_voice_uninit(SEVoice* v) {
+    ma_sound_uninit(&v->sound);
+    enc_stream_close(v->enc);
+}
+
+/* SE ボイスプールを破棄する。 */
+static void se_voices_release(SoundSlot* s) {
+    for (ma_uint32 i = 0; i < s->voice_count; ++i)
+        se_voice_uninit(&s->voices[i]);
+    free(s->voices);
+    s->voices      = NULL;
+    s->voice_count = 0;
+    s->voice_next  = 0;
+}
+
+/*
+ * データバッファに積まれた読込ジョブが全て終わるまで待つ。
+ * miniaudio のジョブは完了を通知した後にも対象へ書き込むため、読込中の SE を解放する前に呼ぶ。
+ */
+static void source_wait_jobs(ma_resource_manager_data_source* ds) {
+    if (!ds || (ds->flags & MA_RESOURCE_MANAGER_DATA_SOURCE_FLAG_STREAM)) return;
+    ma_resource_manager_data_buffer* db = &ds->backend.buffer;
+    while (ma_atomic_load_32(&db->executionPointer) != ma_atomic_load_32(&db->executionCounter))
+        ma_yield();
+}
+static void sound_wait_jobs(ma_sound* snd) {
+    source_wait_jobs(snd->pResourceManagerDataSource);
+}
+
+/* ENG_RESAMPLE_* をローパスの次数にする (ENG_RESAMPLE_DEFAULT なら def)。 */
+static ma_uint32 resample_order(ma_uint32 quality, ma_uint32 def) {
+    return quality == ENG_RESAMPLE_DEFAULT ? def : ma_min(quality - 1, MA_MAX_FILTER_ORDER);
+}
+
+/*
+ * ピッチ用リサンプラが要るか。元データは読込時にエンジンのレートへ変換してあるので、
+ * ピッチ 1 でドップラーも掛からなければ素通しと同じ結果になる。
+ */
+static bool se_pitch_needed(ENG_Audio* a, const SoundSlot* s) {
+    return s->pitch != 1.0f
+        || (spatial_on(s) && s->spatial.param[ENG_SPATIAL_DOPPLER] != 0.0f)
+        || s->sound.engineNode.sampleRate != ma_engine_get_sample_rate(&a->engine);
+}
+
+/*
+ * 発音し直すボイスのピッチ用リサンプラを掛け外しする。
+ * 外すのはここだけにする (鳴っている途中で外すと補間の遅れの分だけ音が飛ぶ)。
+ * 掛け直すときは前に使ったときの補間状態を捨てる。
+ */
+static void se_voice_set_pitching(SEVoice* v, bool on) {
+    ma_engine_node* n = &v->sound.engineNode;
+    if (on && ma_atomic_load_32(&n->isPitchDisabled)) ma_resampler_reset(&n->resampler);
+    ma_atomic_store_32(&n->isPitchDisabled, on ? MA_FALSE : MA_TRUE);
+}
+
+/*
+ * 鳴っているボイスにピッチ用リサンプラを掛け始める (オーディオスレッド)。
+ * 直前に鳴らしたフレームを通して補間とローパスの状態を作っておく
+ * (空の状態から始めると 0 から立ち上がってプチッと鳴る)。
+ * 圧縮 SE は遡って読むとリングを埋め直すことになるので、次に鳴らすフレームを繰り返して通す。
+ */
+static void se_voice_resume_pitching(SEVoice* v) {
+    ma_engine_node* n  = &v->sound.engineNode;
+    ma_data_source* ds = ma_sound_get_data_source(&v->sound);
+    ma_uint32       ch = n->resampler.channels;
+    ma_uint64       cur = 0, got = 0;
+    float           in[ENG_PITCH_PRIME_FRAMES * 8], out[(ENG_PITCH_PRIME_FRAMES + 1) * 8];
+    ma_resampler_reset(&n->resampler);
+    if (ch <= 8 && v->enc) {
+        if (v->sound.processingCacheFramesRemaining > 0)
+            for (got = 0; got < ENG_PITCH_PRIME_FRAMES; ++got)
+                memcpy(in + got * ch, v->sound.pProcessingCache, sizeof(float) * ch);
+    } else if (ch <= 8 && ma_data_source_get_cursor_in_pcm_frames(ds, &cur) == MA_SUCCESS
+               && cur > v->sound.processingCacheFramesRemaining) {
+        /* 読み出し元の位置は ma_sound が先読みして溜めている分だけ進んでいる */
+        ma_uint64 played = cur - v->sound.processingCacheFramesRemaining;
+        ma_uint64 k = ma_min(played, ENG_PITCH_PRIME_FRAMES);
+        if (ma_data_source_seek_to_pcm_frame(ds, played - k) == MA_SUCCESS) {
+            ma_data_source_read_pcm_frames(ds, in, k, &got);
+            ma_data_source_seek_to_pcm_frame(ds, cur);
+        }
+    }
+    if (got > 0) {
+        ma_uint64 out_frames = ENG_PITCH_PRIME_FRAMES + 1;
+        ma_resampler_process_pcm_frames(&n->resampler, in, &got, out, &out_frames);
+    }
+    ma_atomic_store_32(&n->isPitchDisabled, MA_FALSE);
+}
+
+/* ピッチ用リサンプラが要るようになったら、鳴っているボイスにもすぐ掛ける (オーディオスレッド)。 */
+static void se_pitch_update(ENG_Audio* a, SoundSlot* s) {
+    if (s->streaming || !se_pitch_needed(a, s)) return;
+    for (ma_uint32 i = 0; i < s->voice_count; ++i) {
+        SEVoice* v = &s->voices[i];
+        if (!ma_atomic_load_32(&v->sound.engineNode.isPitchDisabled)) continue;
+        if (ma_sound_is_playing(&v->sound)) se_voice_resume_pitching(v);
+        else                                se_voice_set_pitching(v, true);
+    }
+}
+
+/* 元データを共有するボイスを count 個確保し、現在の SE 設定を反映する。 */
+static bool se_voices_alloc(ENG_Audio* a, SoundSlot* s, ma_uint32 count) {
+    SEVoice* v = calloc(count, sizeof(SEVoice));
+    if (!v) return false;
+    /* リサンプラの設定は ma_sound を作るときにだけエンジンから写される */
+    ma_resampler_config pitch_cfg = a->engine.pitchResamplingConfig;
+    a->engine.pitchResamplingConfig.linear.lpfOrder = resample_order(s->resample, pitch_cfg.linear.lpfOrder);
+    for (ma_uint32 i = 0; i < count; ++i) {
+        ma_result r = se_voice_init(a, s, &v[i]);
+        if (r != MA_SUCCESS) {
+            fprintf(stderr, "[eng_audio] SEボイス確保失敗: %s\n", ma_result_description(r));
+            while (i > 0) se_voice_uninit(&v[--i]);
+            free(v);
+            a->engine.pitchResamplingConfig = pitch_cfg;
+            return false;
+        }
+        v[i].volume = s->volume;
+        se_voice_apply_volume(s, &v[i]);
+        ma_sound_set_pitch(&v[i].sound, s->pitch);
+        se_voice_set_pitching(&v[i], se_pitch_needed(a, s));
+        ma_sound_set_pan(&v[i].sound, s->pan);
+        ma_sound_set_looping(&v[i].sound, s->looping ? MA_TRUE : MA_FALSE);
+        spatial_apply_all(&v[i].sound, &s->spatial);
+        if (s->fx_head)
+            ma_node_attach_output_bus(&v[i].sound, 0, fx_entry(a, s->fx_head, NULL), 0);
+    }
+    a->engine.pitchResamplingConfig = pitch_cfg;
+    s->voices      = v;
+    s->voice_count = count;
+    s->voice_next  = 0;
+    return true;
+}
+
+/* 鳴っているか、予約発音を待っているか、仮想化中のボイスは使用中。 */
+static bool se_voice_busy(SEVoice* v, ma_uint64 now) {
+    return v->start_at > now || ma_sound_is_playing(&v->sound) || ma_atomic_load_32(&v->virt);
+}
+
+/* 奪うときに比べる音量。仮想化中のボイスは聞こえていないので最も小さい扱い。 */
+static float se_voice_volume(SEVoice* v) {
+    return ma_atomic_load_32(&v->virt) ? 0.0f : ma_sound_get_volume(&v->sound);
+}
+
+/*
+ * 発音に使うボイスを選ぶ。
+ * voice_next から順に空いているボイスを探し、あればそれを使う。予約発音・仮想化・
+ * QUIETEST で飛ばしたボイスがあるので、voice_next が空いているとも最も古いとも限らない。
+ * 全部使用中のときだけ steal 方式に従って奪う (OLDEST はラウンドロビンの次、NULL=発音しない)。
+ * 走査は最大でも voice_count 回で、発音回数には依存しない。
+ */
+static SEVoice* se_voice_acquire(SoundSlot* s, ma_uint64 now) {
+    if (s->voice_count == 0) return NULL;
+    ma_uint32 idx  = s->voice_next;
+    bool      found = false;
+    for (ma_uint32 n = 0; n < s->voice_count; ++n) {
+        ma_uint32 i = (s->voice_next + n) % s->voice_count;
+        if (!se_voice_busy(&s->voices[i], now)) { idx = i; found = true; break; }
+    }
+    if (!found) {
+        if (s->steal == ENG_STEAL_NONE) return NULL;
+        if (s->steal == ENG_STEAL_QUIETEST) {
+            float quietest = se_voice_volume(&s->voices[idx]);
+            for (ma_uint32 i = 0; i < s->voice_count; ++i) {
+                float vol = se_voice_volume(&s->voices[i]);
+                if (vol < quietest) { quietest = vol; idx = i; }
+            }
+        }
+    }
+    s->voice_next = (idx + 1) % s->voice_count;
+    return &s->voices[idx];
+}
+
+/* at = 発音するエンジン時刻 (0 または過去なら即時)。 */
+static void se_trigger(ENG_Audio* a, SoundSlot* s, float vol, ma_uint64 at) {
+    SEVoice* v = se_voice_acquire(s, ma_engine_get_time_in_pcm_frames(&a->engine));
+    if (!v) return;
+    ma_sound_stop(&v->sound);
+    ma_atomic_store_32(&v->virt, 0);
+    v->volume = vol;
+    se_voice_apply_volume(s, v);
+    se_voice_set_pitching(v, se_pitch_needed(a, s));
+    ma_sound_seek_to_pcm_frame(&v->sound, 0);
+    ma_sound_set_start_time_in_pcm_frames(&v->sound, at);
+    v->start_at = at;
+    ma_sound_start(&v->sound);
+}
+
+/*
+ * 仮想化中のボイスが now に鳴っているはずの位置を pos に返す。
+ * ピッチは今の値で通して進める (圧縮 SE は素材のレートで数える)。ループせずに末尾を過ぎていれば false。
+ */
+static bool se_voice_virt_pos(SEVoice* v, ma_uint64 now, ma_uint64* pos) {
+    ma_uint64 len  = 0;
+    double    rate = (double)v->sound.engineNode.sampleRate
+                   / (double)ma_engine_get_sample_rate(ma_sound_get_engine(&v->sound));
+    ma_sound_get_length_in_pcm_frames(&v->sound, &len);
+    ma_uint64 p = v->virt_pos + (ma_uint64)((double)(now - v->virt_at) * ma_sound_get_pitch(&v->sound) * rate);
+    if (len > 0 && p >= len) {
+        if (!ma_sound_is_looping(&v->sound)) return false;
+        p %= len;
+    }
+    *pos = p;
+    return true;
+}
+
+/* 鳴っているボイスを仮想化する。止めて、その時点の位置と時刻を覚えておく。 */
+static void se_voice_virtualize(SEVoice* v, ma_uint64 now) {
+    ma_uint64 pos = 0;
+    ma_sound_get_cursor_in_pcm_frames(&v->sound, &pos);
+    v->virt_pos = pos;
+    v->virt_at  = now;
+    ma_atomic_store_32(&v->virt, 1); /* 止める前に立てる (鳴っている判定が途切れないように) */
+    ma_sound_stop(&v->sound);
+}
+
+/* 仮想化を解いて、進んだ位置から鳴らし直す。既に終わっていれば先頭へ戻すだけ。 */
+static void se_voice_promote(SEVoice* v, ma_uint64 now) {
+    ma_uint64 pos = 0;
+    bool alive = se_voice_virt_pos(v, now, &pos);
+    ma_sound_seek_to_pcm_frame(&v->sound, alive ? pos : 0);
+    if (alive) ma_sound_start(&v->sound);
+    ma_atomic_store_32(&v->virt, 0);
+}
+
+/* BGM を at から鳴らす。既に過ぎた予約停止は解除する (未来の予約停止は残す)。 */
+static void bgm_start(ENG_Audio* a, SoundSlot* s, ma_uint64 at) {
+    ma_uint64 now = ma_engine_get_time_in_pcm_frames(&a->engine);
+    if (ma_node_get_state_time(&s->sound, ma_node_state_stopped) <= now)
+        ma_sound_reset_stop_time(&s->sound);
+    ma_sound_set_start_time_in_pcm_frames(&s->sound, at);
+    ma_sound_start(&s->sound);
+}
+
+/* ── BGM ストリーム (オーディオスレッド) ─────────────────*/
+static BgmTrack* bgm_cur(BgmStream* b) {
+    return (BgmTrack*)ma_atomic_load_ptr(&b->cur);
+}
+
+/* 再生位置を n フレーム進める。ループ中はループ区間の先頭へ折り返す。 */
+static void bgm_stream_advance(BgmStream* b, BgmTrack* t, ma_uint64 n) {
+    ma_uint64 c = ma_atomic_load_64(&b->cursor) + n;
+    if (ma_data_source_is_looping(&t->src)) {
+        ma_uint64 beg = ma_atomic_load_64(&t->loop_beg);
+        ma_uint64 end = ma_atomic_load_64(&t->loop_end);
+        if (end == ~(ma_uint64)0) ma_resource_manager_data_source_get_length_in_pcm_frames(&t->src, &end);
+        if (end > beg && c >= end) c = beg + (c - end) % (end - beg);
+    }
+    ma_atomic_store_64(&b->cursor, c);
+}
+
+/* 予約された曲へ切り替える。終わった曲はスクリプトスレッドに渡す。 */
+static bool bgm_stream_next(BgmStream* b) {
+    BgmTrack* next = (BgmTrack*)ma_atomic_exchange_ptr(&b->queued, NULL);
+    if (!next) return false;
+    BgmTrack* old = bgm_cur(b);
+    ma_atomic_store_ptr(&b->cur, next);
+    ma_atomic_store_64(&b->cursor, 0);
+    ma_data_source_set_looping(b, next->loop ? MA_TRUE : MA_FALSE);
+    ma_atomic_store_ptr(&b->retired, old);
+    return true;
+}
+
+static ma_result bgm_stream_read(ma_data_source* ds, void* out, ma_uint64 frames, ma_uint64* read) {
+    BgmStream* b    = (BgmStream*)ds;
+    ma_uint64  done = 0;
+    ma_result  r    = MA_SUCCESS;
+    ma_uint32  ch;
+    ma_resource_manager_data_source_get_data_format(&bgm_cur(b)->src, NULL, &ch, NULL, NULL, 0);
+    while (done < frames) {
+        BgmTrack* t   = bgm_cur(b);
+        ma_uint64 got = 0;
+        r = ma_resource_manager_data_source_read_pcm_frames(&t->src, (float*)out + done * ch, frames - done, &got);
+        bgm_stream_advance(b, t, got);
+        done += got;
+        if (r == MA_AT_END || (r == MA_SUCCESS && got == 0)) {
+            if (!bgm_stream_next(b)) { r = MA_AT_END; break; }
+            r = MA_SUCCESS;
+            continue;
+        }
+        if (r != MA_SUCCESS) {
+            if (r == MA_BUSY) stat_add64(&b->stats->stalls, 1); /* 先読みが間に合っていない */
+            break;
+        }
+    }
+    *read = done;
+    return r == MA_AT_END && done > 0 ? MA_SUCCESS : r;
+}
+
+static ma_result bgm_stream_seek(ma_data_source* ds, ma_uint64 frame) {
+    BgmStream* b = (BgmStream*)ds;
+    ma_atomic_store_64(&b->cursor, frame);
+    return ma_resource_manager_data_source_seek_to_pcm_frame(&bgm_cur(b)->src, frame);
+}
+
+static ma_result bgm_stream_format(ma_data_source* ds, ma_format* format, ma_uint32* channels,
+                                   ma_uint32* rate, ma_channel* map, size_t map_cap) {
+    return ma_resource_manager_data_source_get_data_format(&bgm_cur((BgmStream*)ds)->src,
+                                                           format, channels, rate, map, map_cap);
+}
+
+static ma_result bgm_stream_cursor(ma_data_source* ds, ma_uint64* cursor) {
+    *cursor = ma_atomic_load_64(&((BgmStream*)ds)->cursor);
+    return MA_SUCCESS;
+}
+
+static ma_result bgm_stream_length(ma_data_source* ds, ma_uint64* length) {
+    return ma_resource_manager_data_source_get_length_in_pcm_frames(&bgm_cur((BgmStream*)ds)->src, length);
+}
+
+static ma_result bgm_stream_set_looping(ma_data_source* ds, ma_bool32 loop) {
+    return ma_resource_manager_data_source_set_looping(&bgm_cur((BgmStream*)ds)->src, loop);
+}
+
+static ma_data_source_vtable g_bgm_stream_vtable = {
+    bgm_stream_read,
+    bgm_stream_seek,
+    bgm_stream_format,
+    bgm_stream_cursor,
+    bgm_stream_length,
+    bgm_stream_set_looping,
+    MA_DATA_SOURCE_SELF_MANAGED_RANGE_AND_LOOP_POINT,
+};
+
+/* 区間の終了位置。曲末 (~0) は長さに直す。長さが分からなければ 0。 */
+static ma_uint64 bgm_track_end(BgmTrack* t, ma_uint64 end) {
+    if (end != ~(ma_uint64)0) return end;
+    ma_uint64 len = 0;
+    ma_resource_manager_data_source_get_length_in_pcm_frames(&t->src, &len);
+    return len;
+}
+
+/*
+ * ループ区間を設定する。デコーダは先読みするページを埋めるときに区間を見るので、
+ * 先読み済みの分 (cursor から最大 2 ページ先) に新旧どちらかの終了位置が入っていれば
+ * *stale を立てる。その分は古い区間のまま鳴る (鳴っていなければ bgm_track_refill で捨てる)。
+ */
+static bool bgm_track_set_loop(BgmTrack* t, ma_uint64 beg, ma_uint64 end, ma_uint64 cursor, bool* stale) {
+    ma_uint64 horizon = cursor + 2 * (ma_uint64)ma_resource_manager_data_stream_get_page_size_in_frames(&t->src.backend.stream);
+    ma_uint64 old_end = bgm_track_end(t, ma_atomic_load_64(&t->loop_end));
+    ma_uint64 new_end = bgm_track_end(t, end);
+    if (ma_data_source_set_loop_point_in_pcm_frames(&t->src, beg, end) != MA_SUCCESS) return false;
+    ma_atomic_store_64(&t->loop_beg, beg);
+    ma_atomic_store_64(&t->loop_end, end);
+    *stale = old_end == 0 || new_end == 0 || horizon >= old_end || horizon >= new_end;
+    return true;
+}
+
+/* 先読み済みのページを捨てて frame から読み直させる (鳴っていない曲に使う)。 */
+static void bgm_track_refill(BgmTrack* t, ma_uint64 frame) {
+    /* 同じ位置へのシークは何もしないので、一度ずらしてから戻す */
+    ma_resource_manager_data_source_seek_to_pcm_frame(&t->src, frame + 1);
+    ma_resource_manager_data_source_seek_to_pcm_frame(&t->src, frame);
+}
+
+/*
+ * ループの有無を変えた (オーディオスレッド)。先読み済みのページは古い設定のまま
+ * デコードされているので、曲末の折り返しを含みうるなら cursor から読み直させる。
+ * 鳴っている最中の読み直しは、そのページのデコードを待つ間だけ途切れる。
+ */
+static void bgm_track_loop_changed(BgmTrack* t, bool loop, ma_uint64 cursor, bool playing) {
+    ma_uint64 horizon = cursor + 2 * (ma_uint64)ma_resource_manager_data_stream_get_page_size_in_frames(&t->src.backend.stream);
+    ma_uint64 end     = bgm_track_end(t, ma_atomic_load_64(&t->loop_end));
+    t->loop = loop;
+    if (!playing || end == 0 || horizon >= end) bgm_track_refill(t, cursor);
+}
+
+/* ── BGM の曲 (スクリプトスレッド) ──────────────────────*/
+#define ENG_LOOP_TAG_SCAN (64 * 1024) /* ループタグを探すファイル先頭の範囲 */
+
+static ma_uint32 le32(const unsigned char* p) {
+    return (ma_uint32)p[0] | (ma_uint32)p[1] << 8 | (ma_uint32)p[2] << 16 | (ma_uint32)p[3] << 24;
+}
+
+/* WAV の smpl チャンクにある最初のループ。終了位置はチャンク上は含む側なので +1 する。 */
+static bool loop_tag_wav(FILE* f, ma_uint64* beg, ma_uint64* end) {
+    unsigned char h[12];
+    if (fread(h, 1, 12, f) != 12 || memcmp(h, "RIFF", 4) != 0 || memcmp(h + 8, "WAVE", 4) != 0) return false;
+    unsigned char c[8];
+    while (fread(c, 1, 8, f) == 8) {
+        ma_uint32 size = le32(c + 4);
+        if (memcmp(c, "smpl", 4) == 0 && size >= 60) {
+            unsigned char d[60]; /* ヘッダ 36 バイト + ループ 1 つ分 */
+            if (fread(d, 1, 60, f) != 60 || le32(d + 28) == 0) return false;
+            *beg = le32(d + 36 + 8);
+            *end = (ma_uint64)le32(d + 36 + 12) + 1;
+            return *end > *beg;
+        }
+        if (file_seek64(f, (ma_int64)size + (size & 1), SEEK_CUR) != 0) return false;
+    }
+    return false;
+}
+
+/* buf から "KEY=数字" を探す (キーは大文字で渡す。大小文字は区別しない)。 */
+static bool loop_tag_value(const char* buf, size_t n, const char* key, ma_uint64* out) {
+    size_t k = strlen(key);
+    for (size_t i = 0; i + k < n; ++i) {
+        size_t j = 0;
+        while (j < k && toupper((unsigned char)buf[i + j]) == key[j]) ++j;
+        if (j < k || !isdigit((unsigned char)buf[i + k])) continue;
+        ma_uint64 v = 0;
+        for (size_t p = i + k; p < n && isdigit((unsigned char)buf[p]); ++p) v = v * 10 + (ma_uint64)(buf[p] - '0');
+        *out = v;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * ファイルに埋め込まれたループ区間 (ファイルのレートのフレーム) を読む。
+ * WAV は smpl チャンク、それ以外は Ogg / FLAC の Vorbis コメント
+ * LOOPSTART と LOOPLENGTH (または LOOPEND) を先頭から探す。
+ */
+static bool loop_tags_read(const char* path, ma_uint64* beg, ma_uint64* end) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    bool ok = loop_tag_wav(f, beg, end);
+    char* buf = ok ? NULL : malloc(ENG_LOOP_TAG_SCAN);
+    if (buf) {
+        rewind(f);
+        size_t    n = fread(buf, 1, ENG_LOOP_TAG_SCAN, f);
+        ma_uint64 len;
+        if (loop_tag_value(buf, n, "LOOPSTART=", beg)) {
+            if (loop_tag_value(buf, n, "LOOPLENGTH=", &len)) {
+                *end = *beg + len;
+                ok   = len > 0;
+            } else if (loop_tag_value(buf, n, "LOOPEND=", end)) {
+                ok = *end > *beg;
+            } else {
+                *end = ~(ma_uint64)0;
+                ok   = true;
+            }
+        }
+        free(buf);
+    }
+    fclose(f);
+    return ok;
+}
+
+/*
+ * ループ区間 (エンジンのレートのフレーム) を検証する。曲末以降の終了位置は ~0 (曲末) に直す。
+ * デコーダの汎用ループ処理は 1 回の読み出しで終了位置を 2 度またげず、ページが途中で
+ * 終わってしまうので、終了位置のある区間はストリームの 1 ページ分以上を要る。
+ */
+static bool bgm_loop_check(BgmTrack* t, ma_uint64 beg, ma_uint64* end) {
+    ma_uint64 len  = 0;
+    ma_uint64 page = ma_resource_manager_data_stream_get_page_size_in_frames(&t->src.backend.stream);
+    ma_resource_manager_data_source_get_length_in_pcm_frames(&t->src, &len);
+    if (len && *end >= len) *end = ~(ma_uint64)0;
+    if (beg >= 0xFFFFFFFFu || (len && beg >= len)) return false;
+    return *end == ~(ma_uint64)0 || (*end < 0xFFFFFFFFu && *end >= beg + page);
+}
+
+/* ファイルのレートでのフレーム位置を、デコード後 (エンジンのレート) の位置に直す。 */
+static ma_uint64 bgm_track_frames(ENG_Audio* a, const BgmTrack* t, ma_uint64 frames) {
+    ma_uint32 in  = t->src.backend.stream.decoder.converter.sampleRateIn;
+    ma_uint32 out = ma_engine_get_sample_rate(&a->engine);
+    if (frames == ~(ma_uint64)0 || in == 0 || in == out) return frames;
+    return frames * out / in;
+}
+
+/*
+ * path をストリームとして開く。ヘッダの解析までは呼び出し側で行い、先頭ページの
+ * デコードはジョブに任せる (これが先読みになる)。done_fence があればデコード完了まで
+ * acquire される。ファイルにループ区間があればここで設定する。
+ */
+static BgmTrack* bgm_track_open(ENG_Audio* a, const char* path, bool loop, ma_fence* done_fence,
+                                ma_result* result) {
+    BgmTrack* t = calloc(1, sizeof(BgmTrack));
+    if (!t) {
+        *result = MA_OUT_OF_MEMORY;
+        return NULL;
+    }
+    ma_resource_manager_pipeline_notifications notes = ma_resource_manager_pipeline_notifications_init();
+    notes.done.pFence = done_fence;
+    ma_resource_manager_data_source_config dc = ma_resource_manager_data_source_config_init();
+    dc.pFilePath      = path;
+    dc.pNotifications = &notes;
+    dc.isLooping      = loop ? MA_TRUE : MA_FALSE;
+    dc.flags          = MA_RESOURCE_MANAGER_DATA_SOURCE_FLAG_STREAM | MA_RESOURCE_MANAGER_DATA_SOURCE_FLAG_ASYNC
+                      | MA_RESOURCE_MANAGER_DATA_SOURCE_FLAG_WAIT_INIT;
+    /* 初期化の途中で待ちが明けないよう、ma_sound と同じく初期化の間も fence を持つ */
+    if (done_fence) ma_fence_acquire(done_fence);
+    *result = ma_resource_manager_data_source_init_ex(&a->rm, &dc, &t->src);
+    if (done_fence) ma_fence_release(done_fence);
+    if (*result != MA_SUCCESS) {
+        free(t);
+        return NULL;
+    }
+    t->loop = loop;
+    ma_atomic_store_64(&t->loop_end, ~(ma_uint64)0);
+    ma_uint64 beg, end;
+    bool      stale;
+    if (loop_tags_read(path, &beg, &end)) {
+        beg = bgm_track_frames(a, t, beg);
+        end = bgm_track_frames(a, t, end);
+        if (!bgm_loop_check(t, beg, &end))
+            fprintf(stderr, "[eng_audio] ファイルのループ区間を無視 '%s' (範囲外か 1 ページ未満)\n", path);
+        else if (bgm_track_set_loop(t, beg, end, 0, &stale) && stale)
+            bgm_track_refill(t, 0); /* 先頭のページは区間を設定する前に読まれている */
+    }
+    return t;
+}
+
+static void bgm_track_close(BgmTrack* t) {
+    if (!t) return;
+    ma_resource_manager_data_source_uninit(&t->src);
+    free(t);
+}
+
+/* BGM の ma_sound と、今の曲・予約中の曲・終わった曲を破棄する。 */
+static void bgm_release(SoundSlot* s) {
+    ma_sound_uninit(&s->sound);
+    ma_data_source_uninit(&s->stream.base);
+    bgm_track_close(bgm_cur(&s->stream));
+    bgm_track_close((BgmTrack*)ma_atomic_exchange_ptr(&s->stream.queued, NULL));
+    bgm_track_close((BgmTrack*)ma_atomic_exchange_ptr(&s->stream.retired, NULL));
+    ma_atomic_store_ptr(&s->stream.cur, NULL);
+}
+
+/* 切り替えで終わった曲を解放する。 */
+static void bgm_retire(SoundSlot* s) {
+    bgm_track_close((BgmTrack*)ma_atomic_exchange_ptr(&s->stream.retired, NULL));
+}
+
+/* ── 発音中リスト (オーディオスレッド) ───────────────────*/
+/* 鳴らし始めたスロットを毎ブロックの確認対象にする。 */
+static void live_add(ENG_Audio* a, SoundSlot* s) {
+    if (s->live) return;
+    s->live      = true;
+    s->live_next = a->live;
+    a->live      = s;
+}
+
+/* 解放前に外す。スクリプトスレッドからは engine_lock 中に呼ぶ。 */
+static void live_remove(ENG_Audio* a, SoundSlot* s) {
+    if (!s->live) return;
+    SoundSlot** p = &a->live;
+    while (*p != s) p = &(*p)->live_next;
+    *p = s->live_next;
+    s->live      = false;
+    s->live_next = NULL;
+}
+
+/* 予約したフェードがサウンドに反映され、最後まで進んだか。 */
+static bool fade_done(ma_sound* snd) {
+    ma_engine_node* n = &snd->engineNode;
+    if (ma_atomic_uint64_get(&n->fadeSettings.fadeLengthInFrames) != ~(ma_uint64)0) return false;
+    return n->fader.cursorInFrames >= (ma_int64)n->fader.lengthInFrames;
+}
+
+/* 実効音量 (音量×フェード) がしきい値未満のまま続いたら true。quiet に経過を積む。 */
+static bool cull_check(const ENG_Audio* a, ma_sound* snd, ma_uint64* quiet, ma_uint64 elapsed) {
+    if (ma_sound_get_volume(snd) * ma_sound_get_current_fade_volume(snd) >= a->cull_gain) {
+        *quiet = 0;
+        return false;
+    }
+    *quiet += elapsed;
+    if (*quiet < a->cull_frames) return false;
+    *quiet = 0;
+    return true;
+}
+
+/* BGM のフェード完了動作と無音停止。まだ確認が要るなら true。 */
+static bool bgm_service(ENG_Audio* a, SoundSlot* s, ma_uint64 elapsed) {
+    if (s->fade_end != ENG_FADE_CONTINUE && fade_done(&s->sound)) {
+        ma_uint32 end = s->fade_end;
+        s->fade_end = ENG_FADE_CONTINUE;
+        ma_sound_stop(&s->sound);
+        if (end == ENG_FADE_STOP) ma_sound_seek_to_pcm_frame(&s->sound, 0);
+        if (end == ENG_FADE_FREE) {
+            /* ここでは止めるだけ。ma_sound の破棄はスクリプトスレッドが行う */
+            ma_atomic_store_32(&s->released, 1);
+            ma_atomic_store_32(&a->bgm_released, 1);
+            return false;
+        }
+    }
+    bool playing = ma_sound_is_playing(&s->sound) != MA_FALSE;
+    if (playing && a->cull_gain > 0.0f && cull_check(a, &s->sound, &s->quiet, elapsed)) {
+        ma_sound_stop(&s->sound);
+        stat_add64(&a->stats.culled, 1);
+        playing = false;
+    }
+    return playing || s->fade_end != ENG_FADE_CONTINUE;
+}
+
+/*
+ * SE ボイスの無音停止と、仮想化中に末尾を過ぎたボイスの終了。
+ * 鳴っている (予約中・仮想化中を含む) ボイスの数を返し、仮想化中の数を *virt に足す。
+ */
+static ma_uint32 se_service(ENG_Audio* a, SoundSlot* s, ma_uint64 now, ma_uint64 elapsed, ma_uint32* virt) {
+    ma_uint32 n = 0;
+    for (ma_uint32 i = 0; i < s->voice_count; ++i) {
+        SEVoice* v = &s->voices[i];
+        if (v->start_at > now) { ++n; continue; }
+        if (ma_atomic_load_32(&v->virt)) {
+            ma_uint64 pos;
+            if (!se_voice_virt_pos(v, now, &pos)) {
+                ma_sound_seek_to_pcm_frame(&v->sound, 0);
+                ma_atomic_store_32(&v->virt, 0);
+                continue;
+            }
+            ++n;
+            ++*virt;
+            continue;
+        }
+        if (!ma_sound_is_playing(&v->sound)) continue;
+        if (a->cull_gain > 0.0f && cull_check(a, &v->sound, &v->quiet, elapsed)) {
+            ma_sound_stop(&v->sound);
+            stat_add64(&a->stats.culled, 1);
+            continue;
+        }
+        ++n;
+    }
+    return n;
+}
+
+/* 振り分けの順位。優先度が同じなら実効音量で比べる。 */
+static bool voice_rank_less(const VoiceRank* x, const VoiceRank* y) {
+    if (x->priority != y->priority) return x->priority < y->priority;
+    return x->gain < y->gain;
+}
+
+/* 順位の最小ヒープ。根が残すものの中で最も低い。 */
+static void voice_heap_up(VoiceRank* h, ma_uint32 i) {
+    while (i > 0) {
+        ma_uint32 parent = (i - 1) / 2;
+        if (!voice_rank_less(&h[i], &h[parent])) return;
+        VoiceRank t = h[i]; h[i] = h[parent]; h[parent] = t;
+        i = parent;
+    }
+}
+static void voice_heap_down(VoiceRank* h, ma_uint32 n, ma_uint32 i) {
+    for (;;) {
+        ma_uint32 m = i, l = 2 * i + 1, r = l + 1;
+        if (l < n && voice_rank_less(&h[l], &h[m])) m = l;
+        if (r < n && voice_rank_less(&h[r], &h[m])) m = r;
+        if (m == i) return;
+        VoiceRank t = h[i]; h[i] = h[m]; h[m] = t;
+        i = m;
+    }
+}
+
+/*
+ * 実際に鳴らす SE ボイスを voice_budget 個 (0=無制限) に絞る。仮想化中のボイスは
+ * 予約発音を除く鳴っているボイスと一緒に順位を付け、上位 voice_budget 個を残す。
+ * 外れたボイスは仮想化し、残ったボイスのうち仮想化中のものは鳴らし直す。
+ * 音量は発音の音量×バス音量 (3D の SE は距離減衰の見積もりも掛ける)。
+ * 鳴っているボイスは入れ替わりを繰り返さないよう ENG_VOICE_KEEP_BIAS 倍の音量で比べる。
+ * 仮想化中のまま残ったボイスの数を返す。
+ */
+static ma_uint32 voice_arbitrate(ENG_Audio* a, ma_uint64 now) {
+    ma_uint32  cap  = a->voice_budget;
+    ma_uint32  n    = 0;
+    VoiceRank* heap = a->voice_heap;
+    for (SoundSlot* s = a->live; s; s = s->live_next) {
+        if (s->streaming) continue;
+        float bus = a->bus_muted[s->bus] ? 0.0f : a->bus_volume[s->bus];
+        for (ma_uint32 i = 0; i < s->voice_count; ++i) {
+            SEVoice* v    = &s->voices[i];
+            bool     virt = ma_atomic_load_32(&v->virt) != 0;
+            if (!virt && (v->start_at > now || !ma_sound_is_playing(&v->sound))) continue;
+            v->keep = cap == 0;
+            if (cap == 0) continue;
+            VoiceRank r = { v, s->priority, v->volume * s->spatial.gain * bus };
+            if (!virt) r.gain *= ENG_VOICE_KEEP_BIAS;
+            if (n < cap) {
+                heap[n] = r;
+                voice_heap_up(heap, n++);
+            } else if (voice_rank_less(&heap[0], &r)) {
+                heap[0] = r;
+                voice_heap_down(heap, n, 0);
+            }
+        }
+    }
+    for (ma_uint32 i = 0; i < n; ++i) heap[i].voice->keep = true;
+
+    ma_uint32 virt_count = 0;
+    for (SoundSlot* s = a->live; s; s = s->live_next) {
+        if (s->streaming) continue;
+        for (ma_uint32 i = 0; i < s->voice_count; ++i) {
+            SEVoice* v = &s->voices[i];
+            if (ma_atomic_load_32(&v->virt)) {
+                if (v->keep) se_voice_promote(v, now);
+                else         ++virt_count;
+            } else if (!v->keep && v->start_at <= now && ma_sound_is_playing(&v->sound)) {
+                se_voice_virtualize(v, now);
+                ++virt_count;
+            }
+        }
+    }
+    return virt_count;
+}
+
+/*
+ * ブロック境界で発音中のスロットを見て回り、止まったものはリストから外す。
+ * SE ボイスが上限を超えているか仮想化中のものがあれば、鳴らすボイスを振り分け直す。
+ */
+static void live_service(ENG_Audio* a) {
+    ma_uint64 now     = ma_engine_get_time_in_pcm_frames(&a->engine);
+    ma_uint64 elapsed = now - a->service_time;
+    ma_uint32 voices  = 0;
+    ma_uint32 se      = 0;
+    ma_uint32 virt    = 0;
+    a->service_time = now;
+    for (SoundSlot** p = &a->live; *p;) {
+        SoundSlot* s = *p;
+        ma_uint32  n;
+        if (spatial_on(s)) spatial_service(a, s);
+        if (s->streaming) {
+            n = bgm_service(a, s, elapsed) ? 1u : 0u;
+        } else {
+            n = se_service(a, s, now, elapsed, &virt);
+            se += n;
+        }
+        voices += n;
+        if (n > 0) {
+            p = &s->live_next;
+        } else {
+            *p = s->live_next;
+            s->live      = false;
+            s->live_next = NULL;
+        }
+    }
+    if (virt > 0 || (a->voice_budget > 0 && se > a->voice_budget)) {
+        virt = voice_arbitrate(a, now);
+        voices -= virt;
+    }
+    ma_atomic_store_explicit_32(&a->stats.virtual_voices, virt, ma_atomic_memory_order_relaxed);
+    ma_atomic_store_explicit_32(&a->stats.voices, voices, ma_atomic_memory_order_relaxed);
+    if (voices > ma_atomic_load_explicit_32(&a->stats.voices_peak, ma_atomic_memory_order_relaxed))
+        ma_atomic_store_explicit_32(&a->stats.voices_peak, voices, ma_atomic_memory_order_relaxed);
+}
+
+/* ── コマンドの適用 (消費側) ─────────────────────────────*/
+/* CMD_EMITTER / CMD_LISTENER のベクトル (z は u の下位 32 ビットに float のまま入れる) */
+static ma_vec3f cmd_vec(const EngCmd* c) {
+    ma_uint32 bits = (ma_uint32)c->u;
+    float     z;
+    memcpy(&z, &bits, sizeof(z));
+    return ma_vec3f_init_3f(c->f0, c->f1, z);
+}
+
+static void cmd_apply(ENG_Audio* a, const EngCmd* c) {
+    SoundSlot* s = c->slot;
+    if (s && ma_atomic_load_32(&s->released)) return; /* フェード完了で解放済み */
+    switch ((CmdOp)c->op) {
+    case CMD_PLAY:
+        s->fade_end = ENG_FADE_CONTINUE;
+        live_add(a, s);
+        if (s->streaming) bgm_start(a, s, c->u);
+        else              se_trigger(a, s, c->flag ? c->f0 : s->volume, c->u);
+        break;
+    case CMD_STOP_AT:
+        ma_sound_set_stop_time_in_pcm_frames(&s->sound, c->u);
+        break;
+    case CMD_STOP:
+        s->fade_end = ENG_FADE_CONTINUE;
+        if (s->streaming) {
+            ma_sound_stop(&s->sound);
+            ma_sound_seek_to_pcm_frame(&s->sound, 0);
+        }
+        for (ma_uint32 i = 0; i < s->voice_count; ++i) {
+            ma_sound_stop(&s->voices[i].sound);
+            ma_sound_seek_to_pcm_frame(&s->voices[i].sound, 0);
+            ma_atomic_store_32(&s->voices[i].virt, 0);
+            s->voices[i].start_at = 0;
+        }
+        break;
+    case CMD_PAUSE:
+        s->fade_end = ENG_FADE_CONTINUE;
+        ma_sound_stop(&s->sound);
+        break;
+    case CMD_SEEK:
+        ma_sound_seek_to_pcm_frame(&s->sound, c->u);
+        break;
+    case CMD_VOLUME:
+        if (s->streaming) { ma_sound_set_volume(&s->sound, c->f0); break; }
+        s->volume = c->f0;
+        for (ma_uint32 i = 0; i < s->voice_count; ++i) {
+            s->voices[i].volume = c->f0;
+            se_voice_apply_volume(s, &s->voices[i]);
+        }
+        break;
+    case CMD_PITCH:
+        if (s->streaming) { ma_sound_set_pitch(&s->sound, c->f0); break; }
+        s->pitch = c->f0;
+        for (ma_uint32 i = 0; i < s->voice_count; ++i)
+            ma_sound_set_pitch(&s->voices[i].sound, c->f0);
+        se_pitch_update(a, s);
+        break;
+    case CMD_PAN:
+        if (s->streaming) { ma_sound_set_pan(&s->sound, c->f0); break; }
+        s->pan = c->f0;
+        if (s->spatial.lod) break; /* 簡易定位中は次の spatial_service で 3D のパンと合わせて掛ける */
+        for (ma_uint32 i = 0; i < s->voice_count; ++i)
+            ma_sound_set_pan(&s->voices[i].sound, c->f0);
+        break;
+    case CMD_LOOP:
+        if (s->streaming) {
+            bool was = ma_sound_is_looping(&s->sound) != MA_FALSE;
+            ma_sound_set_looping(&s->sound, c->flag ? MA_TRUE : MA_FALSE);
+            if (was != (c->flag != 0))
+                bgm_track_loop_changed(bgm_cur(&s->stream), c->flag != 0, ma_atomic_load_64(&s->stream.cursor),
+                                       ma_sound_is_playing(&s->sound) != MA_FALSE);
+            break;
+        }
+        s->looping = c->flag != 0;
+        for (ma_uint32 i = 0; i < s->voice_count; ++i)
+            ma_sound_set_looping(&s->voices[i].sound, c->flag ? MA_TRUE : MA_FALSE);
+        break;
+    case CMD_FADE:
+        ma_sound_set_fade_in_milliseconds(&s->sound, c->f0, c->f1, c->u);
+        s->fade_end = c->flag >> 1;
+        if (c->flag & CMD_FADE_START) bgm_start(a, s, 0);
+        live_add(a, s);
+        break;
+    case CMD_CROSSFADE_IN:
+        s->fade_end = ENG_FADE_CONTINUE;
+        live_add(a, s);
+        ma_sound_seek_to_pcm_frame(&s->sound, 0);
+        ma_sound_set_fade_in_milliseconds(&s->sound, 0.0f, 1.0f, c->u);
+        bgm_start(a, s, 0);
+        break;
+    case CMD_MASTER_VOLUME:
+        ma_engine_set_volume(&a->engine, c->f0);
+        break;
+    case CMD_CULL:
+        a->cull_gain   = c->f0;
+        a->cull_frames = c->u;
+        break;
+    case CMD_BUS_VOLUME:
+        a->bus_volume[c->flag] = c->f0;
+        if (!a->bus_muted[c->flag]) ma_sound_group_set_volume(&a->buses[c->flag], c->f0);
+        break;
+    case CMD_BUS_PAN:
+        ma_sound_group_set_pan(&a->buses[c->flag], c->f0);
+        break;
+    case CMD_BUS_FADE:
+        ma_sound_group_set_fade_in_milliseconds(&a->buses[c->flag], c->f0, c->f1, c->u);
+        break;
+    case CMD_BUS_MUTE:
+        a->bus_muted[c->flag] = c->u != 0;
+        ma_sound_group_set_volume(&a->buses[c->flag], c->u ? 0.0f : a->bus_volume[c->flag]);
+        break;
+    case CMD_LOOP_POINTS: {
+        BgmTrack* t      = bgm_cur(&s->stream);
+        ma_uint64 cursor = ma_atomic_load_64(&s->stream.cursor);
+        ma_uint64 end    = c->u & 0xFFFFFFFFu;
+        bool      stale;
+        if (bgm_track_set_loop(t, c->u >> 32, end == 0xFFFFFFFFu ? ~(ma_uint64)0 : end, cursor, &stale)
+            && stale && !ma_sound_is_playing(&s->sound))
+            bgm_track_refill(t, cursor);
+        break;
+    }
+    case CMD_PRIORITY:
+        s->priority = (int)c->flag;
+        break;
+    case CMD_SPATIAL:
+        spatial_set(s, c->flag, c->f0);
+        se_pitch_update(a, s);
+        break;
+    case CMD_EMITTER:
+        spatial_set_vec(s, c->flag, cmd_vec(c));
+        break;
+    case CMD_LISTENER: {
+        ma_vec3f v = cmd_vec(c);
+        switch (c->flag) {
+        case CMD_VEC_POSITION:  ma_engine_listener_set_position(&a->engine, 0, v.x, v.y, v.z); break;
+        case CMD_VEC_VELOCITY:  ma_engine_listener_set_velocity(&a->engine, 0, v.x, v.y, v.z); break;
+        case CMD_VEC_DIRECTION: ma_engine_listener_set_direction(&a->engine, 0, v.x, v.y, v.z); break;
+        case CMD_VEC_UP:        ma_engine_listener_set_world_up(&a->engine, 0, v.x, v.y, v.z); break;
+        }
+        break;
+    }
+    case CMD_SPATIAL_LOD:
+        a->lod_distance = c->f0;
+        break;
+    }
+}
+
+static bool cmd_try_lock(ENG_Audio* a) {
+    return ma_atomic_exchange_explicit_32(&a->cmd_lock, 1, ma_atomic_memory_order_acquire) == 0;
+}
+static void cmd_unlock(ENG_Audio* a) {
+    ma_atomic_store_explicit_32(&a->cmd_lock, 0, ma_atomic_memory_order_release);
+}
+
+/* 公開済みのコマンドを全て適用する。cmd_lock を持っていること。 */
+static void cmd_drain(ENG_Audio* a) {
+    ma_uint32 r = ma_atomic_load_explicit_32(&a->cmd_read,  ma_atomic_memory_order_relaxed);
+    ma_uint32 w = ma_atomic_load_explicit_32(&a->cmd_write, ma_atomic_memory_order_acquire);
+    while (r != w) {
+        cmd_apply(a, &a->cmds[r & a->cmd_mask]);
+        ++r;
+    }
+    ma_atomic_store_explicit_32(&a->cmd_read, r, ma_atomic_memory_order_release);
+}
+
+/* オーディオスレッド: ブロック境界で呼ぶ。他方が消費中なら待たずに次のブロックへ回す。 */
+static void cmd_service(ENG_Audio* a) {
+    if (!cmd_try_lock(a)) return;
+    cmd_drain(a);
+    live_service(a);
+    cmd_unlock(a);
+}
+
+static void cmd_publish(ENG_Audio* a) {
+    ma_atomic_store_explicit_32(&a->cmd_write, a->cmd_pending, ma_atomic_memory_order_release);
+}
+
+/*
+ * スクリプトスレッド: 消費側を奪い、積まれたコマンドを適用し終えた状態で返る。
+ * engine_unlock までオーディオスレッドはスロットに触れないので、解放や再確保に使う。
+ */
+static void engine_lock(ENG_Audio* a) {
+    cmd_publish(a);
+    while (!cmd_try_lock(a)) ma_yield();
+    cmd_drain(a);
+}
+static void engine_unlock(ENG_Audio* a) {
+    cmd_unlock(a);
+}
+
+static void cmd_push(ENG_Audio* a, const EngCmd* c) {
+    ma_uint32 w    = a->cmd_pending;
+    ma_uint32 used = w - ma_atomic_load_explicit_32(&a->cmd_read, ma_atomic_memory_order_acquire);
+    if (used > a->cmd_mask) {
+        /* 満杯: 待たずに自分で吐き出す (バッチ中でもここで公開される) */
+        a->cmd_overflows++;
+        engine_lock(a);
+        engine_unlock(a);
+        used = 0;
+    }
+    a->cmds[w & a->cmd_mask] = *c;
+    a->cmd_pending = w + 1;
+    if (used + 1 > a->cmd_high_water) a->cmd_high_water = used + 1;
+    if (a->batch_depth == 0) cmd_publish(a);
+}
+
+static void cmd_send(ENG_Audio* a, CmdOp op, SoundSlot* s, float f0, float f1, ma_uint64 u, ma_uint32 flag) {
+    EngCmd c;
+    c.op   = (ma_uint32)op;
+    c.flag = flag;
+    c.slot = s;
+    c.f0   = f0;
+    c.f1   = f1;
+    c.u    = u;
+    cmd_push(a, &c);
+}
+static void cmd_send_vec(ENG_Audio* a, CmdOp op, SoundSlot* s, ma_uint32 which, float x, float y, float z) {
+    ma_uint32 bits;
+    memcpy(&bits, &z, sizeof(bits));
+    cmd_send(a, op, s, x, y, bits, which);
+}
+
+/* ヘッドレス時: 溜まった読込・ストリーミングのジョブを呼び出し側スレッドで全て処理する。 */
+static void rm_pump(ENG_Audio* a) {
+    while (ma_resource_manager_process_next_job(&a->rm) == MA_SUCCESS) {}
+}
+
+/* エンジンを ENG_MIX_SLICE ずつミックスする。予約時刻をフレーム単位で守るため。 */
+static ma_uint64 mix_read(ENG_Audio* a, float* out, ma_uint64 frames) {
+    ma_uint32 ch   = ma_engine_get_channels(&a->engine);
+    ma_uint64 done = 0;
+    while (done < frames) {
+        ma_uint64 n = frames - done;
+        if (n > ENG_MIX_SLICE) n = ENG_MIX_SLICE;
+        ma_uint64 got = 0;
+        ma_engine_read_pcm_frames(&a->engine, out + done * ch, n, &got);
+        if (got == 0) break;
+        done += got;
+    }
+    master_taps_run(a, out, done);
+    return done;
+}
+
+/* ── 計測 (オーディオスレッド) ─────────────────────────*/
+static ma_uint64 stats_now(EngStats* st) {
+    return (ma_uint64)(ma_timer_get_time_in_seconds(&st->timer) * 1e9);
+}
+
+/* ヒストグラムの区間: 0 = 1us 未満、以降は 2^10ns から 1 オクターブを 4 分割。 */
+static ma_uint32 stats_bucket(ma_uint64 ns) {
+    if (ns < 1024) return 0;
+    ma_uint32 msb = 10;
+    while (msb < 63 && (ns >> (msb + 1)) != 0) ++msb;
+    ma_uint32 b = (msb - 10) * 4 + (ma_uint32)((ns >> (msb - 2)) & 3) + 1;
+    return b < ENG_STATS_BUCKETS ? b : ENG_STATS_BUCKETS - 1;
+}
+
+/* 区間 b の上端 (ns)。 */
+static ma_uint64 stats_bucket_upper(ma_uint32 b) {
+    if (b == 0) return 1024;
+    ma_uint32 msb = 10 + (b - 1) / 4;
+    return (ma_uint64)(4 + (b - 1) % 4 + 1) << (msb - 2);
+}
+
+static void stats_clear(EngStats* st) {
+    for (ma_uint32 i = 0; i < ENG_STATS_BUCKETS; ++i) ma_atomic_store_32(&st->hist[i], 0);
+    ma_atomic_store_64(&st->blocks, 0);
+    ma_atomic_store_64(&st->mix_ns, 0);
+    ma_atomic_store_64(&st->min_ns, ~(ma_uint64)0);
+    ma_atomic_store_64(&st->max_ns, 0);
+    ma_atomic_store_32(&st->load_ppm, 0);
+    ma_atomic_store_32(&st->load_peak_ppm, 0);
+    ma_atomic_store_64(&st->xruns, 0);
+    ma_atomic_store_64(&st->stalls, 0);
+    ma_atomic_store_64(&st->culled, 0);
+    ma_atomic_store_32(&st->voices_peak, 0);
+    st->last_start = 0;
+}
+
+/*
+ * t0 から始めたミックス 1 回分を記録する。realtime (デバイスのコールバック) では
+ * ミックスが出力の長さより長くかかったか、前回の開始から 2 回分以上空いたら xrun と数える。
+ */
+static void stats_block(ENG_Audio* a, ma_uint64 t0, ma_uint64 frames, bool realtime) {
+    EngStats* st  = &a->stats;
+    ma_uint64 mix = stats_now(st) - t0;
+    ma_uint64 out = frames * 1000000000u / ma_engine_get_sample_rate(&a->engine);
+    if (ma_atomic_exchange_32(&st->reset, 0)) stats_clear(st);
+
+    ma_uint32* h = &st->hist[stats_bucket(mix)];
+    ma_atomic_store_explicit_32(h, ma_atomic_load_explicit_32(h, ma_atomic_memory_order_relaxed) + 1,
+                                ma_atomic_memory_order_relaxed);
+    stat_add64(&st->blocks, 1);
+    stat_add64(&st->mix_ns, mix);
+    if (mix < ma_atomic_load_explicit_64(&st->min_ns, ma_atomic_memory_order_relaxed))
+        ma_atomic_store_explicit_64(&st->min_ns, mix, ma_atomic_memory_order_relaxed);
+    if (mix > ma_atomic_load_explicit_64(&st->max_ns, ma_atomic_memory_order_relaxed))
+        ma_atomic_store_explicit_64(&st->max_ns, mix, ma_atomic_memory_order_relaxed);
+
+    if (out > 0) {
+        ma_uint64 ppm  = mix * 1000000u / out;
+        ma_uint32 load = ma_atomic_load_explicit_32(&st->load_ppm, ma_atomic_memory_order_relaxed);
+        load = (ma_uint32)((load * 7ull + (ppm > 0xFFFFFFFFu ? 0xFFFFFFFFu : ppm)) / 8);
+        ma_atomic_store_explicit_32(&st->load_ppm, load, ma_atomic_memory_order_relaxed);
+        if (load > ma_atomic_load_explicit_32(&st->load_peak_ppm, ma_atomic_memory_order_relaxed))
+            ma_atomic_store_explicit_32(&st->load_peak_ppm, load, ma_atomic_memory_order_relaxed);
+    }
+    if (realtime) {
+        ma_uint64 span = out > st->last_out ? out : st->last_out;
+        if (mix > out || (st->last_start != 0 && t0 - st->last_start > 2 * span)) stat_add64(&st->xruns, 1);
+        st->last_start = t0;
+        st->last_out   = out;
+    }
+}
+
+/* 再生デバイスのデータコールバック (オーディオスレッド)。 */
+static void eng_device_data(ma_device* d, void* out, const void* in, ma_uint32 frames) {
+    ENG_Audio* a  = (ENG_Audio*)d->pUserData;
+    ma_uint64  t0 = stats_now(&a->stats);
+    (void)in;
+    cmd_service(a);
+    mix_read(a, (float*)out, frames);
+    stats_block(a, t0, frames, true);
+}
+
+/* 英数字のみを大小文字無視で比較する ("coreaudio" と "Core Audio" を同一視)。 */
+static bool backend_name_eq(const char* a, const char* b) {
+    for (;;) {
+        while (*a && !isalnum((unsigned char)*a)) ++a;
+        while (*b && !isalnum((unsigned char)*b)) ++b;
+        if (!*a || !*b) return *a == *b;
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) return false;
+        ++a; ++b;
+    }
+}
+
+static bool backend_from_name(const char* name, ma_backend* out) {
+    for (int b = 0; b <= (int)ma_backend_null; ++b) {
+        if (backend_name_eq(name, ma_get_backend_name((ma_backend)b))) {
+            *out = (ma_backend)b;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* 再生デバイスの通知 (miniaudio のスレッド)。自分で止めたのでなければ見張りに開き直させる。 */
+static void eng_device_notify(const ma_device_notification* n) {
+    ENG_Audio* a = (ENG_Audio*)n->pDevice->pUserData;
+    switch (n->type) {
+    case ma_device_notification_type_stopped:
+        if (ma_atomic_load_32(&a->device_closing)) break;
+        ma_atomic_store_32(&a->device_state, ENG_DEVICE_LOST);
+        ma_atomic_store_32(&a->device_lost, 1);
+        ma_event_signal(&a->device_wake);
+        break;
+    case ma_device_notification_type_rerouted:
+        ma_atomic_fetch_add_32(&a->device_reroutes, 1); /* バックエンドが既定のデバイスに付け替えた */
+        break;
+    default:
+        break;
+    }
+}
+
+/* 設定から再生デバイスの開き方を決める (まだ何も開かない)。 */
+static void device_setup(ENG_Audio* a, const ENG_AudioConfig* c) {
+    if (c->backend && c->backend[0]) {
+        if (backend_from_name(c->backend, &a->device_backend)) {
+            a->device_backend_count = 1;
+        } else {
+            fprintf(stderr, "[eng_audio] 不明なバックエンド '%s' (自動選択)\n", c->backend);
+        }
+    }
+    ma_device_config dc = ma_device_config_init(ma_device_type_playback);
+    dc.playback.format          = ma_format_f32;
+    dc.playback.channels        = c->channels;
+    dc.playback.shareMode       = c->exclusive ? ma_share_mode_exclusive : ma_share_mode_shared;
+    dc.sampleRate               = c->sample_rate;
+    dc.periodSizeInFrames       = c->period_frames;
+    dc.periodSizeInMilliseconds = c->period_ms;
+    dc.periods                  = c->periods;
+    dc.performanceProfile       = ma_performance_profile_low_latency;
+    dc.noPreSilencedOutputBuffer = MA_TRUE; /* エンジンが全フレームを書き込む */
+    dc.dataCallback             = eng_device_data;
+    dc.notificationCallback     = eng_device_notify;
+    dc.pUserData                = a;
+    a->device_config = dc;
+}
+
+/*
+ * コンテキストと再生デバイスを開く (まだ開始しない)。
+ * 指定バックエンドや排他モードが使えない場合は既定/共有モードに戻して再試行する。
+ * コンテキストは一度開いたら使い続ける (バックエンドの列挙は最初の 1 回だけ)。
+ */
+static bool device_open(ENG_Audio* a) {
+    ma_result r;
+    if (!a->context_ready) {
+        ma_backend* backends = a->device_backend_count ? &a->device_backend : NULL;
+        r = ma_context_init(backends, a->device_backend_count, NULL, &a->context);
+        if (r != MA_SUCCESS && backends) {
+            fprintf(stderr, "[eng_audio] バックエンド '%s' 初期化失敗 (自動選択)\n",
+                    ma_get_backend_name(a->device_backend));
+            r = ma_context_init(NULL, 0, NULL, &a->context);
+        }
+        if (r != MA_SUCCESS) {
+            fprintf(stderr, "[eng_audio] ma_context_init 失敗: %s\n", ma_result_description(r));
+            return false;
+        }
+        a->context_ready = true;
+    }
+    ma_device_config dc = a->device_config;
+    r = ma_device_init(&a->context, &dc, &a->device);
+    if (r != MA_SUCCESS && dc.playback.shareMode == ma_share_mode_exclusive) {
+        fprintf(stderr, "[eng_audio] 排他モード不可: %s (共有モードで再試行)\n", ma_result_description(r));
+        dc.playback.shareMode = ma_share_mode_shared;
+        r = ma_device_init(&a->context, &dc, &a->device);
+    }
+    if (r != MA_SUCCESS) {
+        fprintf(stderr, "[eng_audio] ma_device_init 失敗: %s\n", ma_result_description(r));
+        return false;
+    }
+    a->device_ready = true;
+    return true;
+}
+
+/* 再生デバイスを閉じる。device_lock を持って呼ぶ。 */
+static void device_close(ENG_Audio* a) {
+    if (!a->device_ready) return;
+    ma_atomic_store_32(&a->device_closing, 1);
+    /* 止まった通知は stopping のうちに届く。止まり切る前に閉じると停止を待つ側が起きなくなる */
+    while (ma_device_get_state(&a->device) == ma_device_state_stopping) ma_sleep(1);
+    ma_device_uninit(&a->device); /* コールバックが終わるまで待つ */
+    ma_atomic_store_32(&a->device_closing, 0);
+    a->device_ready = false;
+}
+
+/* 今のデバイスを閉じ、既定のデバイスを開いて始める (見張りスレッド)。 */
+static bool device_restart(ENG_Audio* a) {
+    ma_mutex_lock(&a->device_lock);
+    bool reopen = a->device_ready || ma_atomic_load_32(&a->device_state) == ENG_DEVICE_LOST;
+    device_close(a);
+    ma_atomic_store_32(&a->device_state, ENG_DEVICE_OPENING);
+    bool ok = device_open(a);
+    if (ok) {
+        ma_result r = ma_device_start(&a->device);
+        if (r != MA_SUCCESS) {
+            fprintf(stderr, "[eng_audio] ma_device_start 失敗: %s\n", ma_result_description(r));
+            device_close(a);
+            ok = false;
+        }
+    }
+    if (ok && reopen) {
+        a->device_reopens++;
+        fprintf(stderr, "[eng_audio] 再生デバイスを開き直した (%s)\n", a->device.playback.name);
+    }
+    ma_atomic_store_32(&a->device_state, ok ? ENG_DEVICE_RUNNING : ENG_DEVICE_LOST);
+    ma_mutex_unlock(&a->device_lock);
+    return ok;
+}
+
+/*
+ * 見張りスレッド。デバイスが再生中でなければ開き、開けなければ ENG_DEVICE_RETRY_MS おきに
+ * やり直す。再生中は通知 (失った・開き直しの依頼・終了) を待つ。
+ */
+static ma_thread_result MA_THREADCALL device_thread(void* data) {
+    ENG_Audio* a = (ENG_Audio*)data;
+    while (!ma_atomic_load_32(&a->device_quit)) {
+        bool lost = ma_atomic_exchange_32(&a->device_lost, 0) != 0;
+        if (lost || ma_atomic_load_32(&a->device_state) != ENG_DEVICE_RUNNING) {
+            if (!device_restart(a)) {
+                for (ma_uint32 t = 0; t < ENG_DEVICE_RETRY_MS && !ma_atomic_load_32(&a->device_quit); t += 10)
+                    ma_sleep(10);
+                continue;
+            }
+        }
+        ma_event_wait(&a->device_wake);
+    }
+    return (ma_thread_result)0;
+}
+
+/* 見張りを始める。async=true なら最初のデバイスもこのスレッドが開く。 */
+static bool device_watch_start(ENG_Audio* a) {
+    if (ma_event_init(&a->device_wake) != MA_SUCCESS) return false;
+    if (ma_thread_create(&a->device_thread, ma_thread_priority_default, 0, device_thread, a, NULL) != MA_SUCCESS) {
+        ma_event_uninit(&a->device_wake);
+        return false;
+    }
+    a->device_threaded = true;
+    return true;
+}
+
+/* 見張りを止めてデバイスとコンテキストを閉じる。 */
+static void device_shutdown(ENG_Audio* a) {
+    if (a->device_threaded) {
+        ma_atomic_store_32(&a->device_quit, 1);
+        ma_event_signal(&a->device_wake);
+        ma_thread_wait(&a->device_thread);
+        ma_event_uninit(&a->device_wake);
+        a->device_threaded = false;
+    }
+    ma_mutex_lock(&a->device_lock);
+    device_close(a);
+    if (a->context_ready) ma_context_uninit(&a->context);
+    a->context_ready = false;
+    ma_atomic_store_32(&a->device_state, ENG_DEVICE_NONE);
+    ma_mutex_unlock(&a->device_lock);
+}
+
+/* ── デコードキャッシュ ─────────────────────────────────*/
+/* ノードが resource manager 側で確保しているデコード済みデータのバイト数。 */
+static ma_uint64 cache_node_bytes(const ma_resource_manager_data_buffer_node* n) {
+    if (!n->isDataOwnedByResourceManager) return 0; /* バンクのマップをそのまま指している */
+    const ma_resource_manager_data_supply* d = &n->data;
+    switch ((ma_resource_manager_data_supply_type)ma_atomic_load_i32(&d->type)) {
+    case ma_resource_manager_data_supply_type_encoded:
+        return d->backend.encoded.sizeInBytes;
+    case ma_resource_manager_data_supply_type_decoded:
+        return d->backend.decoded.totalFrameCount
+             * ma_get_bytes_per_frame(d->backend.decoded.format, d->backend.decoded.channels);
+    case ma_resource_manager_data_supply_type_decoded_paged:
+        return d->backend.decodedPaged.decodedFrameCount
+             * ma_get_bytes_per_frame(d->backend.decodedPaged.data.format, d->backend.decodedPaged.data.channels);
+    default:
+        return 0;
+    }
+}
+
+static ma_result cache_node_result(const CacheEntry* e) {
+    if (e->enc) return MA_SUCCESS; /* 圧縮 SE は作った時点で読み終えている */
+    return (ma_result)ma_atomic_load_i32(&e->hold.backend.buffer.pNode->result);
+}
+
+static void lru_unlink(ENG_Audio* a, CacheEntry* e) {
+    if (e->lru_prev) e->lru_prev->lru_next = e->lru_next; else a->lru_head = e->lru_next;
+    if (e->lru_next) e->lru_next->lru_prev = e->lru_prev; else a->lru_tail = e->lru_prev;
+    e->lru_prev = e->lru_next = NULL;
+    a->cache_unused -= e->bytes;
+}
+
+static void lru_push(ENG_Audio* a, CacheEntry* e) {
+    e->lru_prev = a->lru_tail;
+    e->lru_next = NULL;
+    if (a->lru_tail) a->lru_tail->lru_next = e; else a->lru_head = e;
+    a->lru_tail = e;
+    a->cache_unused += e->bytes;
+}
+
+/* デコードが終わっていればサイズを確定する。 */
+static void cache_size(ENG_Audio* a, CacheEntry* e) {
+    if (e->sized) return;
+    ma_result r = cache_node_result(e);
+    if (r == MA_BUSY) return;
+    e->bytes = r == MA_SUCCESS ? cache_node_bytes(e->hold.backend.buffer.pNode) : 0;
+    e->sized = true;
+    a->cache_bytes += e->bytes;
+    if (e->refs == 0) a->cache_unused += e->bytes;
+}
+
+/* enc = 圧縮 SE のエントリを探す */
+static CacheEntry* cache_find(ENG_Audio* a, const char* key, ma_uint32 hash, bool enc) {
+    if (!a->cache_buckets) return NULL;
+    for (CacheEntry* e = a->cache_buckets[hash & (a->cache_bucket_count - 1)]; e; e = e->next)
+        if (e->hash == hash && (e->enc != NULL) == enc && strcmp(e->key, key) == 0) return e;
+    return NULL;
+}
+
+/* エントリ数がバケツ数を超えたら倍にする。 */
+static bool cache_grow(ENG_Audio* a) {
+    if (a->cache_count < a->cache_bucket_count) return true;
+    ma_uint32 n = a->cache_bucket_count ? a->cache_bucket_count * 2 : 64;
+    CacheEntry** b = calloc(n, sizeof(CacheEntry*));
+    if (!b) return false;
+    for (ma_uint32 i = 0; i < a->cache_bucket_count; ++i) {
+        for (CacheEntry* e = a->cache_buckets[i], *next; e; e = next) {
+            next = e->next;
+            e->next = b[e->hash & (n - 1)];
+            b[e->hash & (n - 1)] = e;
+        }
+    }
+    free(a->cache_buckets);
+    a->cache_buckets      = b;
+    a->cache_bucket_count = n;
+    return true;
+}
+
+static void cache_entry_free(CacheEntry* e) {
+    if (e->enc) {
+        enc_asset_free(e->enc);
+    } else {
+        source_wait_jobs(&e->hold);
+        ma_resource_manager_data_source_uninit(&e->hold);
+    }
+    free(e->key);
+    free(e);
+}
+
+/* 未使用のエントリを捨てる。データを使う SE が残っていなければノードも解放される。 */
+static void cache_evict(ENG_Audio* a, CacheEntry* e) {
+    CacheEntry** p = &a->cache_buckets[e->hash & (a->cache_bucket_count - 1)];
+    while (*p != e) p = &(*p)->next;
+    *p = e->next;
+    lru_unlink(a, e);
+    a->cache_bytes -= e->bytes;
+    if (e->enc && e->enc->owned) a->cache_encoded -= e->enc->size;
+    a->cache_count--;
+    cache_entry_free(e);
+}
+
+/* 未使用分が上限に収まるまで古い順に捨てる。デコード中のものは終わるまで残す。 */
+static void cache_trim(ENG_Audio* a) {
+    for (CacheEntry* e = a->lru_head, *next; e && a->cache_unused > a->cache_budget; e = next) {
+        next = e->lru_next;
+        cache_size(a, e);
+        if (!e->sized) continue;
+        cache_evict(a, e);
+        a->cache_evictions++;
+    }
+}
+
+/*
+ * key の元データを参照する。無ければ作ってデコードを始める (async なら読込ジョブに任せる)。
+ * 失敗時は NULL を返し、理由を *result に入れる。
+ */
+static CacheEntry* cache_acquire(ENG_Audio* a, const char* key, bool async, ma_result* result) {
+    ma_uint32   hash = eng_bank_hash(key);
+    CacheEntry* e    = cache_find(a, key, hash, false);
+    if (e && e->refs == 0 && e->sized && cache_node_result(e) != MA_SUCCESS) {
+        /* 前回失敗したものは作り直す */
+        cache_evict(a, e);
+        e = NULL;
+    }
+    if (e) {
+        if (e->refs++ == 0) lru_unlink(a, e);
+        a->cache_hits++;
+        *result = MA_SUCCESS;
+        return e;
+    }
+    *result = MA_OUT_OF_MEMORY;
+    if (!cache_grow(a)) return NULL;
+    e = calloc(1, sizeof(CacheEntry));
+    if (!e) return NULL;
+    e->key = malloc(strlen(key) + 1);
+    if (!e->key) { free(e); return NULL; }
+    strcpy(e->key, key);
+    ma_uint32 flags = MA_RESOURCE_MANAGER_DATA_SOURCE_FLAG_DECODE;
+    if (async) flags |= MA_RESOURCE_MANAGER_DATA_SOURCE_FLAG_ASYNC | MA_RESOURCE_MANAGER_DATA_SOURCE_FLAG_WAIT_INIT;
+    *result = ma_resource_manager_data_source_init(&a->rm, key, flags, NULL, &e->hold);
+    if (*result != MA_SUCCESS) {
+        free(e->key);
+        free(e);
+        return NULL;
+    }
+    e->hash = hash;
+    e->refs = 1;
+    e->next = a->cache_buckets[hash & (a->cache_bucket_count - 1)];
+    a->cache_buckets[hash & (a->cache_bucket_count - 1)] = e;
+    a->cache_count++;
+    a->cache_misses++;
+    cache_size(a, e);
+    return e;
+}
+
+/*
+ * key の圧縮 SE の元データを参照する。無ければその場で作る (data=NULL ならファイルから読む)。
+ * 失敗時は NULL を返し、理由を *result に入れる。
+ */
+static CacheEntry* cache_acquire_enc(ENG_Audio* a, const char* key, const void* data, size_t size,
+                                     ma_uint32 ahead_ms, ma_result* result) {
+    ma_uint32   hash = eng_bank_hash(key);
+    CacheEntry* e    = cache_find(a, key, hash, true);
+    if (e) {
+        if (e->refs++ == 0) lru_unlink(a, e);
+        a->cache_hits++;
+        *result = MA_SUCCESS;
+        return e;
+    }
+    *result = MA_OUT_OF_MEMORY;
+    if (!cache_grow(a)) return NULL;
+    e = calloc(1, sizeof(CacheEntry));
+    if (!e) return NULL;
+    e->key = malloc(strlen(key) + 1);
+    if (!e->key) { free(e); return NULL; }
+    strcpy(e->key, key);
+    e->enc = enc_asset_open(a->rm.config.pVFS, key, data, size, ahead_ms, result);
+    if (!e->enc) {
+        free(e->key);
+        free(e);
+        return NULL;
+    }
+    e->hash  = hash;
+    e->refs  = 1;
+    e->bytes = enc_asset_bytes(e->enc);
+    e->sized = true;
+    e->next  = a->cache_buckets[hash & (a->cache_bucket_count - 1)];
+    a->cache_buckets[hash & (a->cache_bucket_count - 1)] = e;
+    a->cache_count++;
+    a->cache_misses++;
+    a->cache_bytes += e->bytes;
+    if (e->enc->owned) a->cache_encoded += e->enc->size;
+    return e;
+}
+
+/* SE 1 つ分の参照を外す。未使用になったら LRU の末尾に並べ、上限を超えた分を捨てる。 */
+static void cache_release(ENG_Audio* a, CacheEntry* e) {
+    if (--e->refs == 0) lru_push(a, e);
+    cache_trim(a);
+}
+
+/* key のエントリ (圧縮 SE の分も) が未使用なら捨てる (バンクを閉じる前に呼ぶ)。 */
+static void cache_drop(ENG_Audio* a, const char* key) {
+    for (int enc = 0; enc < 2; ++enc) {
+        CacheEntry* e = cache_find(a, key, eng_bank_hash(key), enc != 0);
+        if (e && e->refs == 0) cache_evict(a, e);
+    }
+}
+
+static void cache_free(ENG_Audio* a) {
+    for (ma_uint32 i = 0; i < a->cache_bucket_count; ++i) {
+        for (CacheEntry* e = a->cache_buckets[i], *next; e; e = next) {
+            next = e->next;
+            cache_entry_free(e);
+        }
+    }
+    free(a->cache_buckets);
+    a->cache_buckets      = NULL;
+    a->cache_bucket_count = 0;
+    a->cache_count        = 0;
+}
+
+/* ── バンク ─────────────────────────────────────────────*/
+/* 登録済みのエントリを resource manager から外し、マップを解除する。 */
+static void bank_close(ENG_Audio* a, BankSlot* b) {
+    for (uint32_t i = 0; i < b->map.header->entry_count; ++i) {
+        if (!b->keys[i]) continue;
+        cache_drop(a, b->keys[i]); /* マップ解除後に参照が残らないように */
+        ma_resource_manager_unregister_data(&a->rm, b->keys[i]);
+        free(b->keys[i]);
+    }
+    free(b->keys);
+    eng_bank_unmap(&b->map);
+    memset(b, 0, sizeof(*b));
+}
+
+/* エントリをマップ上のデータのまま (コピーせずに) resource manager へ登録し、その名前を返す。 */
+static const char* bank_register(ENG_Audio* a, BankSlot* b, const ENG_BankEntry* e) {
+    ma_uint32 idx = (ma_uint32)(e - b->map.entries);
+    if (b->keys[idx]) return b->keys[idx];
+    const char* name = eng_bank_name(&b->map, e);
+    size_t      len  = strlen(name) + 32;
+    char*       key  = malloc(len);
+    if (!key) return NULL;
+    /* ファイルパスと衝突しない名前にする */
+    snprintf(key, len, "<bank%u>%s", (unsigned)(b - a->banks) + 1, name);
+    const void* data = eng_bank_data(&b->map, e);
+    ma_result   r;
+    if (e->format == ENG_BANK_ENCODED) {
+        r = ma_resource_manager_register_encoded_data(&a->rm, key, data, (size_t)e->data_size);
+    } else {
+        ma_format fmt = e->format == ENG_BANK_PCM_F32 ? ma_format_f32 : ma_format_s16;
+        r = ma_resource_manager_register_decoded_data(&a->rm, key, data, e->frame_count,
+                                                      fmt, e->channels, e->sample_rate);
+    }
+    if (r != MA_SUCCESS) {
+        fprintf(stderr, "[eng_audio] バンクのエントリ登録失敗 '%s': %s\n", name, ma_result_description(r));
+        free(key);
+        return NULL;
+    }
+    b->keys[idx] = key;
+    return key;
+}
+
+/*
+ * path がバンクにあれば登録名を返し、*entry にそのエントリを入れる (後から読んだバンクを優先)。
+ * 無ければ path のまま (*entry = NULL)。
+ */
+static const char* bank_resolve(ENG_Audio* a, const char* path, ma_uint32* bank, const ENG_BankEntry** entry) {
+    *bank  = 0;
+    *entry = NULL;
+    for (ma_uint32 i = a->bank_count; i-- > 0;) {
+        BankSlot* b = &a->banks[i];
+        if (!b->used) continue;
+        const ENG_BankEntry* e = eng_bank_find(&b->map, path);
+        if (!e) continue;
+        const char* key = bank_register(a, b, e);
+        if (!key) break;
+        *bank  = i + 1;
+        *entry = e;
+        return key;
+    }
+    return path;
+}
+
+/* ── ライフサイクル ─────────────────────────────────────*/
+ENG_AudioConfig eng_audio_config_default(void) {
+    ENG_AudioConfig c;
+    memset(&c, 0, sizeof(c));
+    return c;
+}
+
+ENG_Audio* eng_audio_create_ex(const ENG_AudioConfig* cfg) {
+    ENG_AudioConfig c = cfg ? *cfg : eng_audio_config_default();
+    ENG_Audio* a = calloc(1, sizeof(ENG_Audio));
+    if (!a) return NULL;
+
+    ma_uint32 qcap = ENG_CMD_QUEUE_DEFAULT;
+    if (c.command_queue_size > 0) {
+        qcap = 1;
+        while (qcap < c.command_queue_size && qcap < 0x40000000u) qcap <<= 1;
+    }
+    a->cmds = malloc(sizeof(EngCmd) * qcap);
+    if (!a->cmds) { free(a); return NULL; }
+    a->cmd_mask = qcap - 1;
+    a->cache_budget = c.cache_budget;
+    if (c.max_voices > 0) {
+        a->voice_heap = malloc(sizeof(VoiceRank) * c.max_voices);
+        if (!a->voice_heap) { free(a->cmds); free(a); return NULL; }
+        a->voice_budget = c.max_voices;
+    }
+    ma_timer_init(&a->stats.timer);
+    stats_clear(&a->stats);
+
+    ma_engine_config ec = ma_engine_config_init();
+    ec.sampleRate = c.sample_rate;
+    ec.channels   = c.channels;
+    ec.noDevice   = MA_TRUE;
+    if (!c.no_device) {
+        if (ma_mutex_init(&a->device_lock) != MA_SUCCESS) { free(a->voice_heap); free(a->cmds); free(a); return NULL; }
+        device_setup(a, &c);
+        if (c.async_device) {
+            /* デバイスは見張りスレッドが開く。エンジンは指定 (または既定) の形式で先に組む */
+            if (ec.sampleRate == 0) ec.sampleRate = ENG_HEADLESS_RATE;
+            if (ec.channels   == 0) ec.channels   = ENG_HEADLESS_CHANNELS;
+            ma_atomic_store_32(&a->device_state, ENG_DEVICE_OPENING);
+        } else {
+            /* デバイスを先に開き、実際に決まったレート/チャンネル数でエンジンを組む */
+            if (!device_open(a)) goto fail_device;
+            ec.sampleRate = a->device.sampleRate;
+            ec.channels   = a->device.playback.channels;
+        }
+        /* 開き直したデバイスでもエンジンの形式のまま引き出す (違いは miniaudio が変換する) */
+        a->device_config.sampleRate        = ec.sampleRate;
+        a->device_config.playback.channels = ec.channels;
+    } else {
+        if (ec.sampleRate == 0) ec.sampleRate = ENG_HEADLESS_RATE;
+        if (ec.channels   == 0) ec.channels   = ENG_HEADLESS_CHANNELS;
+        a->headless = true;
+    }
+
+    /* 読込ジョブスレッド数を指定するため、リソースマネージャは自前で持つ */
+    ma_resource_manager_config rc = ma_resource_manager_config_init();
+    rc.decodedFormat     = ma_format_f32;
+    rc.decodedSampleRate = ec.sampleRate;
+    /* SE は読込時に一度だけ変換し、ミックスではピッチとドップラーの分だけリサンプルする */
+    rc.resampling.linear.lpfOrder      = resample_order(c.load_resample, rc.resampling.linear.lpfOrder);
+    ec.pitchResampling.linear.lpfOrder = resample_order(c.pitch_resample, ec.pitchResampling.linear.lpfOrder);
+    if (a->headless) {
+        /*
+         * ジョブスレッドを持たない。
+         * 読込・ストリーミングは render 内で同期的に進むため、出力は実行ごとに一致する。
+         */
+        rc.jobThreadCount = 0;
+        rc.flags          = MA_RESOURCE_MANAGER_FLAG_NO_THREADING;
+    } else {
+        rc.jobThreadCount = c.loader_threads ? c.loader_threads : ENG_LOADER_THREADS_DEFAULT;
+    }
+    ma_result r = ma_resource_manager_init(&rc, &a->rm);
+    if (r != MA_SUCCESS) {
+        fprintf(stderr, "[eng_audio] ma_resource_manager_init 失敗: %s\n", ma_result_description(r));
+        goto fail_device;
+    }
+    ec.pResourceManager = &a->rm;
+
+    r = ma_fence_init(&a->loads);
+    if (r != MA_SUCCESS) {
+        fprintf(stderr, "[eng_audio] ma_fence_init 失敗: %s\n", ma_result_description(r));
+        goto fail_rm;
+    }
+
+    r = ma_engine_init(&ec, &a->engine);
+    if (r != MA_SUCCESS) {
+        fprintf(stderr, "[eng_audio] ma_engine_init 失敗: %s\n", ma_result_description(r));
+        goto fail_fence;
+    }
+    ma_uint32 nbus = 0;
+    for (; nbus < ENG_BUS_COUNT; ++nbus) {
+        r = ma_sound_group_init(&a->engine, MA_SOUND_FLAG_NO_SPATIALIZATION, NULL, &a->buses[nbus]);
+        if (r != MA_SUCCESS) {
+            fprintf(stderr, "[eng_audio] バス作成失敗: %s\n", ma_result_description(r));
+            goto fail_buses;
+        }
+        a->bus_volume[nbus] = a->bus_volume_shadow[nbus] = 1.0f;
+    }
+    a->master_shadow = 1.0f;
+    ma_uint32 cull_ms = c.cull_ms ? c.cull_ms : ENG_CULL_MS_DEFAULT;
+    a->cull_gain    = c.cull_gain;
+    a->cull_frames  = (ma_uint64)cull_ms * ma_engine_get_sample_rate(&a->engine) / 1000;
+    a->lod_distance = c.spatial_lod_distance;
+    a->decode_ahead_ms = c.decode_ahead_ms ? c.decode_ahead_ms : ENG_DECODE_AHEAD_MS_DEFAULT;
+    if (!a->headless) {
+        if (!c.async_device) {
+            r = ma_device_start(&a->device);
+            if (r != MA_SUCCESS) {
+                fprintf(stderr, "[eng_audio] ma_device_start 失敗: %s\n", ma_result_description(r));
+                goto fail_buses;
+            }
+            ma_atomic_store_32(&a->device_state, ENG_DEVICE_RUNNING);
+        }
+        if (!device_watch_start(a)) {
+            if (c.async_device) {
+                fprintf(stderr, "[eng_audio] デバイスを開くスレッドを作れない\n");
+                goto fail_buses;
+            }
+            fprintf(stderr, "[eng_audio] デバイスの見張りスレッドを作れない (失っても開き直さない)\n");
+        }
+    }
+    return a;
+
+fail_buses:
+    while (nbus > 0) ma_sound_group_uninit(&a->buses[--nbus]);
+    ma_engine_uninit(&a->engine);
+fail_fence:
+    ma_fence_uninit(&a->loads);
+fail_rm:
+    ma_resource_manager_uninit(&a->rm);
+fail_device:
+    if (!a->headless) {
+        device_shutdown(a);
+        ma_mutex_uninit(&a->device_lock);
+    }
+    free(a->voice_heap);
+    free(a->cmds);
+    free(a);
+    return NULL;
+}
+
+ENG_Audio* eng_audio_create(void) {
+    return eng_audio_create_ex(NULL);
+}
+
+void eng_audio_destroy(ENG_Audio* a) {
+    if (!a) return;
+    if (ma_atomic_load_ptr(&a->recorder)) eng_audio_record_stop(a);
+    if (!a->headless) device_shutdown(a); /* 先にコールバックを止める */
+    for (ma_uint32 i = 0; i < a->bgm.count; ++i) {
+        SoundSlot* s = slot_at(&a->bgm, i);
+        if (s->used) bgm_release(s);
+    }
+    for (ma_uint32 i = 0; i < a->se.count; ++i) {
+        SoundSlot* s = slot_at(&a->se, i);
+        if (!s->used) continue;
+        if (s->state == ENG_LOAD_PENDING) sound_wait_jobs(&s->sound);
+        se_voices_release(s);
+        ma_sound_uninit(&s->sound);
+        enc_stream_close(s->enc);
+    }
+    slot_table_free(&a->bgm);
+    slot_table_free(&a->se);
+    cache_free(a);
+    for (ma_uint32 i = 0; i < a->bank_count; ++i)
+        if (a->banks[i].used) bank_close(a, &a->banks[i]);
+    free(a->banks);
+    for (ma_uint32 i = 0; i < a->fx_count; ++i) {
+        FxNode* n = a->fx[i].node;
+        if (!a->fx[i].used) continue;
+        ma_node_uninit(&n->base, NULL);
+        fx_node_free(n);
+    }
+    free(a->fx);
+    for (ma_uint32 i = 0; i < ENG_BUS_COUNT; ++i) ma_sound_group_uninit(&a->buses[i]);
+    ma_engine_uninit(&a->engine);
+    ma_resource_manager_uninit(&a->rm);
+    ma_fence_uninit(&a->loads);
+    if (!a->headless) ma_mutex_uninit(&a->device_lock);
+    free(a->voice_heap);
+    free(a->cmds);
+    free(a);
+}
+
+uint64_t eng_audio_render(ENG_Audio* a, float* out, uint64_t frames) {
+    if (!a || !a->headless || !out) return 0;
+    ma_uint32 ch   = ma_engine_get_channels(&a->engine);
+    uint64_t  done = 0;
+    while (done < frames) {
+        rm_pump(a);
+        ma_uint64 t0 = stats_now(&a->stats);
+        cmd_service(a);
+        rm_pump(a); /* コマンドが出したジョブ (ループ区間のシークなど) もこのチャンクに間に合わせる */
+        ma_uint64 n = frames - done;
+        if (n > ENG_RENDER_CHUNK) n = ENG_RENDER_CHUNK;
+        ma_uint64 got = mix_read(a, out + done * ch, n);
+        if (got == 0) break;
+        stats_block(a, t0, got, false);
+        EngRecorder* r = (EngRecorder*)ma_atomic_load_ptr(&a->recorder);
+        if (r) record_drain(r); /* 書き出しスレッドを持たない */
+        done += got;
+    }
+    return done;
+}
+
+uint32_t eng_audio_sample_rate(ENG_Audio* a) {
+    return a ? ma_engine_get_sample_rate(&a->engine) : 0;
+}
+uint32_t eng_audio_channels(ENG_Audio* a) {
+    return a ? ma_engine_get_channels(&a->engine) : 0;
+}
+
+uint64_t eng_audio_time_frames(ENG_Audio* a) {
+    return a ? ma_engine_get_time_in_pcm_frames(&a->engine) : 0;
+}
+
+bool eng_audio_get_device_info(ENG_Audio* a, ENG_AudioDeviceInfo* out) {
+    if (!a || !out || a->headless) return false;
+    ma_mutex_lock(&a->device_lock);
+    bool ok = a->device_ready && ma_atomic_load_32(&a->device_state) == ENG_DEVICE_RUNNING;
+    if (ok) {
+        const ma_device* d = &a->device;
+        memset(out, 0, sizeof(*out));
+        out->backend       = ma_get_backend_name(a->context.backend);
+        out->sample_rate   = d->playback.internalSampleRate;
+        out->channels      = d->playback.internalChannels;
+        out->period_frames = d->playback.internalPeriodSizeInFrames;
+        out->periods       = d->playback.internalPeriods;
+        out->exclusive     = d->playback.shareMode == ma_share_mode_exclusive;
+        out->reopens       = a->device_reopens;
+        out->reroutes      = ma_atomic_load_32(&a->device_reroutes);
+        if (out->sample_rate > 0)
+            out->latency_ms = 1000.0f * (float)out->period_frames * (float)out->periods
+                            / (float)out->sample_rate;
+    }
+    ma_mutex_unlock(&a->device_lock);
+    return ok;
+}
+
+ENG_DeviceState eng_audio_device_state(ENG_Audio* a) {
+    return a ? (ENG_DeviceState)ma_atomic_load_32(&a->device_state) : ENG_DEVICE_NONE;
+}
+
+bool eng_audio_wait_device(ENG_Audio* a, uint32_t timeout_ms) {
+    if (!a || a->headless) return false;
+    for (uint32_t t = 0; eng_audio_device_state(a) != ENG_DEVICE_RUNNING; t += 5) {
+        if (t >= timeout_ms) return false;
+        ma_sleep(5);
+    }
+    return true;
+}
+
+bool eng_audio_reopen_device(ENG_Audio* a) {
+    if (!a || a->headless || !a->device_threaded) return false;
+    ma_atomic_store_32(&a->device_lost, 1);
+    ma_event_signal(&a->device_wake);
+    return true;
+}
+
+float eng_audio_latency_ms(ENG_Audio* a) {
+    ENG_AudioDeviceInfo info;
+    return eng_audio_get_device_info(a, &info) ? info.latency_ms : 0.0f;
+}
+
+/* ── コマンドキュー ─────────────────────────────────────*/
+void eng_audio_batch_begin(ENG_Audio* a) {
+    if (a) a->batch_depth++;
+}
+void eng_audio_batch_end(ENG_Audio* a) {
+    if (!a || a->batch_depth == 0) return;
+    if (--a->batch_depth == 0) cmd_publish(a);
+}
+
+void eng_audio_get_queue_stats(ENG_Audio* a, ENG_QueueStats* out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!a) return;
+    out->capacity   = a->cmd_mask + 1;
+    out->pending    = a->cmd_pending - ma_atomic_load_explicit_32(&a->cmd_read, ma_atomic_memory_order_acquire);
+    out->high_water = a->cmd_high_water;
+    out->overflows  = a->cmd_overflows;
+}
+
+/* ── 計測 ───────────────────────────────────────────────*/
+void eng_audio_get_stats(ENG_Audio* a, ENG_AudioStats* out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!a) return;
+    EngStats* st = &a->stats;
+    ma_uint32 hist[ENG_STATS_BUCKETS];
+    ma_uint64 total = 0;
+    for (ma_uint32 i = 0; i < ENG_STATS_BUCKETS; ++i) total += hist[i] = ma_atomic_load_32(&st->hist[i]);
+    ma_uint64 blocks = ma_atomic_load_64(&st->blocks);
+    ma_uint64 min_ns = ma_atomic_load_64(&st->min_ns);
+    ma_uint64 max_ns = ma_atomic_load_64(&st->max_ns);
+    out->callbacks = blocks;
+    if (blocks > 0) {
+        out->mix_min_us = (float)min_ns / 1000.0f;
+        out->mix_avg_us = (float)((double)ma_atomic_load_64(&st->mix_ns) / (double)blocks / 1000.0);
+        out->mix_max_us = (float)max_ns / 1000.0f;
+    }
+    /* 99% 目が入っている区間の上端。最大値は超えない */
+    ma_uint64 seen = 0;
+    for (ma_uint32 i = 0; i < ENG_STATS_BUCKETS && total > 0; ++i) {
+        seen += hist[i];
+        if (seen * 100 >= total * 99) {
+            ma_uint64 p = stats_bucket_upper(i);
+            out->mix_p99_us = (float)(p < max_ns ? p : max_ns) / 1000.0f;
+            break;
+        }
+    }
+    out->load           = (float)ma_atomic_load_32(&st->load_ppm) / 1e6f;
+    out->load_peak      = (float)ma_atomic_load_32(&st->load_peak_ppm) / 1e6f;
+    out->xruns          = ma_atomic_load_64(&st->xruns);
+    out->voices         = ma_atomic_load_32(&st->voices);
+    out->voices_peak    = ma_atomic_load_32(&st->voices_peak);
+    out->voices_virtual = ma_atomic_load_32(&st->virtual_voices);
+    out->voices_culled  = ma_atomic_load_64(&st->culled);
+    out->stream_stalls  = ma_atomic_load_64(&st->stalls);
+    out->jobs_pending   = ma_atomic_load_32(&a->rm.jobQueue.allocator.count);
+}
+
+void eng_audio_reset_stats(ENG_Audio* a) {
+    if (a) ma_atomic_store_32(&a->stats.reset, 1);
+}
+
+/* ── 録音 ───────────────────────────────────────────────*/
+bool eng_audio_record_start(ENG_Audio* a, const char* path) {
+    return eng_audio_record_start_ex(a, path, NULL);
+}
 
-/* ── 定数 ───────────────────────────────────────────────*/
-#define ENG_MAX_BGM  16
-#define ENG_MAX_SE   64
+bool eng_audio_record_start_ex(ENG_Audio* a, const char* path, const ENG_RecordParams* p) {
+    if (!a || !path) return false;
+    if (ma_atomic_load_ptr(&a->recorder)) {
+        fprintf(stderr, "[eng_audio] 既に録音中\n");
+        return false;
+    }
+    if (ma_path_extension_equal(path, "flac")) {
+        /* miniaudio のエンコーダは WAV のみ */
+        fprintf(stderr, "[eng_audio] FLAC の録音には対応していない (.wav を指定する): %s\n", path);
+        return false;
+    }
+    ma_uint32 rate = ma_engine_get_sample_rate(&a->engine);
+    ma_uint32 ch   = ma_engine_get_channels(&a->engine);
+    ma_uint32 ms   = p && p->buffer_ms ? p->buffer_ms : ENG_RECORD_BUFFER_MS_DEFAULT;
+    /* ヘッドレス時は render の 1 チャンクごとに書くので、それより短くはしない */
+    ma_uint32 frames = (ma_uint32)ma_max((ma_uint64)ms * rate / 1000, ENG_RENDER_CHUNK);
 
-/* ── サウンドスロット ────────────────────────────────────*/
-typedef struct {
-    ma_sound sound;
-    bool     used;
-    bool     streaming; /* BGM=true, SE=false */
-} SoundSlot;
+    EngRecorder* r = calloc(1, sizeof(EngRecorder));
+    if (!r) return false;
+    r->owner    = a;
+    r->channels = ch;
+    if (ma_pcm_rb_init(ma_format_f32, ch, frames, NULL, NULL, &r->ring) != MA_SUCCESS) {
+        free(r);
+        return false;
+    }
+    r->file_buf = malloc(ENG_RECORD_WRITE_BYTES);
+    if (p && p->pcm16) r->s16 = malloc(sizeof(ma_int16) * ENG_RECORD_CHUNK * ch);
+    r->file = fopen(path, "wb");
+    if (!r->file_buf || (p && p->pcm16 && !r->s16) || !r->file) {
+        fprintf(stderr, "[eng_audio] 録音ファイルを作れない: %s\n", path);
+        if (r->file) fclose(r->file);
+        goto fail;
+    }
+    setvbuf(r->file, r->file_buf, _IOFBF, ENG_RECORD_WRITE_BYTES);
+    ma_encoder_config ec = ma_encoder_config_init(ma_encoding_format_wav,
+                                                  r->s16 ? ma_format_s16 : ma_format_f32, ch, rate);
+    if (ma_encoder_init(record_file_write, record_file_seek, r, &ec, &r->enc) != MA_SUCCESS) {
+        fprintf(stderr, "[eng_audio] 録音のエンコーダを作れない: %s\n", path);
+        fclose(r->file);
+        goto fail;
+    }
+    ma_atomic_store_64(&a->rec_written, 0);
+    ma_atomic_store_64(&a->rec_dropped, 0);
+    ma_atomic_store_32(&a->rec_peak, 0);
+    a->rec_frames = frames;
+    if (!a->headless) {
+        if (ma_thread_create(&r->thread, ma_thread_priority_default, 0, record_thread, r, NULL) != MA_SUCCESS) {
+            fprintf(stderr, "[eng_audio] 録音の書き出しスレッドを作れない\n");
+            ma_encoder_uninit(&r->enc);
+            fclose(r->file);
+            goto fail;
+        }
+        r->threaded = true;
+    }
+    ma_atomic_store_ptr(&a->recorder, r);
+    return true;
 
-/* ── エンジン本体 ────────────────────────────────────────*/
-struct ENG_Audio {
-    ma_engine  engine;
-    SoundSlot  bgm[ENG_MAX_BGM];
-    SoundSlot  se[ENG_MAX_SE];
-};
+fail:
+    ma_pcm_rb_uninit(&r->ring);
+    free(r->file_buf);
+    free(r->s16);
+    free(r);
+    return false;
+}
 
-/* helpers */
-static SoundSlot* bgm_slot(ENG_Audio* a, ENG_SoundID id) {
-    if (!a || id == 0 || id > ENG_MAX_BGM) return NULL;
-    SoundSlot* s = &a->bgm[id - 1];
-    return s->used ? s : NULL;
+bool eng_audio_record_stop(ENG_Audio* a) {
+    EngRecorder* r = a ? (EngRecorder*)ma_atomic_load_ptr(&a->recorder) : NULL;
+    if (!r) return false;
+    ma_atomic_store_ptr(&a->recorder, NULL);
+    while (ma_atomic_load_32(&a->master_busy)) ma_yield(); /* 最後の書き込みを終えるまで */
+    if (r->threaded) {
+        ma_atomic_store_32(&r->stop, 1);
+        ma_thread_wait(&r->thread);
+    } else {
+        record_drain(r);
+    }
+    bool ok = record_close(r);
+    if (!ok) fprintf(stderr, "[eng_audio] 録音ファイルを最後まで書けなかった\n");
+    ma_uint64 dropped = ma_atomic_load_64(&a->rec_dropped);
+    if (dropped > 0)
+        fprintf(stderr, "[eng_audio] 録音: 書き込みが追いつかず %llu フレームを捨てた\n",
+                (unsigned long long)dropped);
+    return ok;
 }
-static SoundSlot* se_slot(ENG_Audio* a, ENG_SoundID id) {
-    if (!a || id == 0 || id > ENG_MAX_SE) return NULL;
-    SoundSlot* s = &a->se[id - 1];
-    return s->used ? s : NULL;
+
+void eng_audio_get_record_stats(ENG_Audio* a, ENG_RecordStats* out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!a) return;
+    out->recording      = ma_atomic_load_ptr(&a->recorder) != NULL;
+    out->buffer_frames  = a->rec_frames;
+    out->buffer_peak    = ma_atomic_load_32(&a->rec_peak);
+    out->frames_written = ma_atomic_load_64(&a->rec_written);
+    out->frames_dropped = ma_atomic_load_64(&a->rec_dropped);
 }
 
-/* ── ライフサイクル ─────────────────────────────────────*/
-ENG_Audio* eng_audio_create(void) {
-    ENG_Audio* a = calloc(1, sizeof(ENG_Audio));
-    if (!a) return NULL;
-    ma_result r = ma_engine_init(NULL, &a->engine);
+/* ── 読込 ───────────────────────────────────────────────*/
+/*
+ * path を読み込んで snd を初期化する。done_fence があればデコード完了まで acquire される。
+ * ASYNC でもヘッダの解析までは呼び出し側で行われる (miniaudio が WAIT_INIT を強制する)。
+ */
+static ma_result sound_init_file(ENG_Audio* a, const char* path, ma_uint32 flags,
+                                 ma_sound_group* group, ma_fence* done_fence, ma_sound* snd) {
+    ma_sound_config sc = ma_sound_config_init_2(&a->engine);
+    sc.pFilePath          = path;
+    sc.flags              = flags;
+    sc.pInitialAttachment = group;
+    sc.initNotifications.done.pFence = done_fence;
+    return ma_sound_init_ex(&a->engine, &sc, snd);
+}
+
+/* リソースマネージャ上の読込状態。progress にはデコード済みの割合を返す。 */
+static ENG_LoadState source_load_state(const ma_resource_manager_data_source* ds, float* progress) {
+    ma_result r;
+    float     p = 0.0f;
+    if (!ds) {
+        r = MA_SUCCESS;
+    } else if (ds->flags & MA_RESOURCE_MANAGER_DATA_SOURCE_FLAG_STREAM) {
+        r = ma_resource_manager_data_stream_result(&ds->backend.stream);
+    } else {
+        /* データバッファ自体は先に使える状態になるので、共有ノードのデコード完了を見る */
+        ma_resource_manager_data_buffer_node* node = ds->backend.buffer.pNode;
+        r = (ma_result)ma_atomic_load_i32(&node->result);
+        if (r == MA_BUSY && ma_atomic_load_i32(&node->data.type) == ma_resource_manager_data_supply_type_decoded) {
+            ma_uint64 total = node->data.backend.decoded.totalFrameCount;
+            if (total > 0) p = (float)node->data.backend.decoded.decodedFrameCount / (float)total;
+        }
+    }
+    if (r == MA_SUCCESS) p = 1.0f;
+    if (progress) *progress = p;
+    if (r == MA_BUSY)    return ENG_LOAD_PENDING;
+    if (r == MA_SUCCESS) return ENG_LOAD_READY;
+    return ENG_LOAD_FAILED;
+}
+
+/* スロットの読込状態。BGM は今の曲を見る (予約中の曲は含めない)。 */
+static ENG_LoadState sound_load_state(SoundSlot* s, float* progress) {
+    return source_load_state(s->streaming ? &bgm_cur(&s->stream)->src : s->sound.pResourceManagerDataSource,
+                             progress);
+}
+
+/* 読込中の SE がデコードを終えていればボイスを確保して READY にする (スクリプトスレッド)。 */
+static ENG_LoadState se_load_poll(ENG_Audio* a, SoundSlot* s) {
+    if (s->state != ENG_LOAD_PENDING) return s->state;
+    ENG_LoadState st = sound_load_state(s, NULL);
+    if (st == ENG_LOAD_PENDING) return st;
+    cache_size(a, s->cache);
+    if (st == ENG_LOAD_FAILED) {
+        fprintf(stderr, "[eng_audio] SE非同期読込失敗 (id=%u)\n", (unsigned)slot_id(s));
+    } else {
+        engine_lock(a);
+        if (!se_voices_alloc(a, s, s->voice_want)) st = ENG_LOAD_FAILED;
+        engine_unlock(a);
+    }
+    s->state = st;
+    return st;
+}
+
+/* フェード完了で解放を要求された BGM を破棄してスロットを空ける。 */
+static void bgm_reap(ENG_Audio* a) {
+    if (!ma_atomic_exchange_32(&a->bgm_released, 0)) return;
+    engine_lock(a);
+    for (ma_uint32 i = 0; i < a->bgm.count; ++i) {
+        SoundSlot* s = slot_at(&a->bgm, i);
+        if (!s->used || !ma_atomic_load_32(&s->released)) continue;
+        live_remove(a, s);
+        fx_clear(a, s);
+        bgm_release(s);
+        slot_release(&a->bgm, s);
+    }
+    engine_unlock(a);
+}
+
+/* 読込引数を検証する (params=NULL なら既定のバスで同期読込)。 */
+static bool load_params(const ENG_LoadParams* params, ENG_Bus def, ma_uint32* bus, bool* async) {
+    *bus   = params ? (ma_uint32)params->bus : (ma_uint32)def;
+    *async = params && (params->flags & ENG_LOAD_FLAG_ASYNC);
+    if (*bus >= ENG_BUS_COUNT) {
+        fprintf(stderr, "[eng_audio] 不明なバス %u\n", (unsigned)*bus);
+        return false;
+    }
+    return true;
+}
+
+static ENG_SoundID bgm_load(ENG_Audio* a, const char* path, ma_uint32 bus, bool track) {
+    if (!a || !path) return 0;
+    bgm_reap(a);
+    SoundSlot* s = slot_alloc(&a->bgm);
+    if (!s) {
+        fprintf(stderr, "[eng_audio] BGMスロット確保失敗\n");
+        return 0;
+    }
+    ma_result r;
+    BgmTrack* t = bgm_track_open(a, path, true, track ? &a->loads : NULL, &r);
+    if (t) {
+        /* ma_sound は曲を直接読まず、曲の切り替えを受け持つ BgmStream を読む */
+        ma_data_source_config dsc = ma_data_source_config_init();
+        dsc.vtable = &g_bgm_stream_vtable;
+        r = ma_data_source_init(&dsc, &s->stream.base);
+        ma_atomic_store_ptr(&s->stream.cur, t);
+        ma_atomic_store_64(&s->stream.cursor, 0);
+        s->stream.stats = &a->stats;
+        if (r == MA_SUCCESS) {
+            ma_sound_config sc = ma_sound_config_init_2(&a->engine);
+            sc.pDataSource        = &s->stream;
+            sc.pInitialAttachment = &a->buses[bus];
+            sc.flags              = MA_SOUND_FLAG_NO_SPATIALIZATION; /* 位置を設定するまでは 2D */
+            r = ma_sound_init_ex(&a->engine, &sc, &s->sound);
+            if (r != MA_SUCCESS) ma_data_source_uninit(&s->stream.base);
+        }
+        if (r != MA_SUCCESS) {
+            ma_atomic_store_ptr(&s->stream.cur, NULL);
+            bgm_track_close(t);
+        }
+    }
     if (r != MA_SUCCESS) {
-        fprintf(stderr, "[eng_audio] ma_engine_init 失敗: %s\n", ma_result_description(r));
-        free(a);
-        return NULL;
+        fprintf(stderr, "[eng_audio] BGM読込失敗 '%s': %s\n", path, ma_result_description(r));
+        slot_release(&a->bgm, s);
+        return 0;
     }
-    return a;
+    ma_sound_set_looping(&s->sound, MA_TRUE);
+    spatial_init(s);
+    s->bus       = bus;
+    s->used      = true;
+    s->streaming = true;
+    return slot_id(s);
 }
 
-void eng_audio_destroy(ENG_Audio* a) {
-    if (!a) return;
-    for (int i = 0; i < ENG_MAX_BGM; ++i)
-        if (a->bgm[i].used) { ma_sound_uninit(&a->bgm[i].sound); a->bgm[i].used = false; }
-    for (int i = 0; i < ENG_MAX_SE; ++i)
-        if (a->se[i].used) { ma_sound_uninit(&a->se[i].sound); a->se[i].used = false; }
-    ma_engine_uninit(&a->engine);
-    free(a);
+/* 圧縮 SE の元データから、ボイスの雛形になる sound を作る (グラフには接続しない)。 */
+static ma_result se_init_enc(ENG_Audio* a, SoundSlot* s, EncAsset* as) {
+    s->enc = enc_stream_open(a, as);
+    if (!s->enc) return MA_OUT_OF_MEMORY;
+    ma_result r = ma_sound_init_from_data_source(&a->engine, s->enc,
+                                                 MA_SOUND_FLAG_NO_DEFAULT_ATTACHMENT | MA_SOUND_FLAG_NO_SPATIALIZATION,
+                                                 NULL, &s->sound);
+    if (r != MA_SUCCESS) {
+        enc_stream_close(s->enc);
+        s->enc = NULL;
+    }
+    return r;
 }
 
-/* ── BGM ────────────────────────────────────────────────*/
-ENG_SoundID eng_bgm_load(ENG_Audio* a, const char* path) {
+/* ahead_ms > 0 なら圧縮 SE として読む (ENG_LOAD_FLAG_COMPRESSED)。 */
+static ENG_SoundID se_load(ENG_Audio* a, const char* path, ma_uint32 bus, bool async, ma_uint32 ahead_ms) {
     if (!a || !path) return 0;
-    for (int i = 0; i < ENG_MAX_BGM; ++i) {
-        if (!a->bgm[i].used) {
-            ma_result r = ma_sound_init_from_file(
-                &a->engine, path,
-                MA_SOUND_FLAG_STREAM | MA_SOUND_FLAG_ASYNC,
-                NULL, NULL, &a->bgm[i].sound);
-            if (r != MA_SUCCESS) {
-                fprintf(stderr, "[eng_audio] BGM読込失敗 '%s': %s\n", path, ma_result_description(r));
-                return 0;
-            }
-            ma_sound_set_looping(&a->bgm[i].sound, MA_TRUE);
-            a->bgm[i].used      = true;
-            a->bgm[i].streaming = true;
-            return (ENG_SoundID)(i + 1);
+    SoundSlot* s = slot_alloc(&a->se);
+    if (!s) {
+        fprintf(stderr, "[eng_audio] SEスロット確保失敗\n");
+        return 0;
+    }
+    ma_uint32            bank;
+    const ENG_BankEntry* be;
+    const char*          src = bank_resolve(a, path, &bank, &be);
+    ma_result            r;
+    CacheEntry*          e;
+    /* バンクの PCM はもともとコピーもデコードもしないので、そのまま使う */
+    if (ahead_ms && be && be->format != ENG_BANK_ENCODED) ahead_ms = 0;
+    if (ahead_ms) {
+        /* ファイルを読んで先頭をデコードするだけなので、非同期は指定されても使わない */
+        async = false;
+        e = cache_acquire_enc(a, src, be ? eng_bank_data(&a->banks[bank - 1].map, be) : NULL,
+                              be ? (size_t)be->data_size : 0, ahead_ms, &r);
+        if (e) {
+            r = se_init_enc(a, s, e->enc);
+            if (r != MA_SUCCESS) cache_release(a, e);
+        }
+    } else if ((e = cache_acquire(a, src, async, &r)) != NULL) {
+        /* 元データは一度だけデコードし、グラフには接続しない (各ボイスが共有する) */
+        ma_uint32 flags = MA_SOUND_FLAG_DECODE | MA_SOUND_FLAG_NO_DEFAULT_ATTACHMENT | MA_SOUND_FLAG_NO_SPATIALIZATION;
+        if (async) flags |= MA_SOUND_FLAG_ASYNC;
+        /* 同じパスの非同期読込がデコード中なら、同期読込はその完了を待つ */
+        if (!async)
+            while (cache_node_result(e) == MA_BUSY) ma_yield();
+        /* ノードは e が先に作っているので、ここではデコードし直さずに共有する */
+        r = sound_init_file(a, src, flags, NULL, async ? &a->loads : NULL, &s->sound);
+        if (r != MA_SUCCESS) cache_release(a, e);
+    }
+    if (r != MA_SUCCESS) {
+        fprintf(stderr, "[eng_audio] SE読込失敗 '%s': %s\n", path, ma_result_description(r));
+        slot_release(&a->se, s);
+        return 0;
+    }
+    s->bank  = bank;
+    s->cache = e;
+    s->bus   = bus;
+    if (bank) a->banks[bank - 1].refs++;
+    s->steal      = ENG_STEAL_OLDEST;
+    s->volume     = 1.0f;
+    s->pitch      = 1.0f;
+    s->pan        = 0.0f;
+    s->looping    = false;
+    s->resample   = ENG_RESAMPLE_DEFAULT;
+    s->voice_want = ENG_SE_DEFAULT_VOICES;
+    spatial_init(s);
+    s->state      = ENG_LOAD_PENDING;
+    s->used       = true;
+    s->streaming  = false;
+    if (!async) {
+        /* 同期読込はここで完了しているので、ボイスも今すぐ確保する */
+        if (se_load_poll(a, s) != ENG_LOAD_READY) {
+            if (s->bank) a->banks[s->bank - 1].refs--;
+            ma_sound_uninit(&s->sound);
+            enc_stream_close(s->enc);
+            cache_release(a, e);
+            slot_release(&a->se, s);
+            return 0;
         }
     }
-    fprintf(stderr, "[eng_audio] BGMスロット満杯 (max=%d)\n", ENG_MAX_BGM);
-    return 0;
+    return slot_id(s);
+}
+
+uint32_t eng_audio_loads_pending(ENG_Audio* a) {
+    if (!a) return 0;
+    uint32_t n = 0;
+    for (ma_uint32 i = 0; i < a->bgm.count; ++i) {
+        SoundSlot* s = slot_at(&a->bgm, i);
+        if (s->used && sound_load_state(s, NULL) == ENG_LOAD_PENDING) ++n;
+    }
+    for (ma_uint32 i = 0; i < a->se.count; ++i) {
+        SoundSlot* s = slot_at(&a->se, i);
+        if (s->used && se_load_poll(a, s) == ENG_LOAD_PENDING) ++n;
+    }
+    return n;
+}
+
+float eng_audio_load_progress(ENG_Audio* a) {
+    if (!a) return 1.0f;
+    float    sum = 0.0f;
+    uint32_t n   = 0;
+    float    p;
+    for (ma_uint32 i = 0; i < a->bgm.count; ++i) {
+        SoundSlot* s = slot_at(&a->bgm, i);
+        if (!s->used) continue;
+        sound_load_state(s, &p);
+        sum += p;
+        ++n;
+    }
+    for (ma_uint32 i = 0; i < a->se.count; ++i) {
+        SoundSlot* s = slot_at(&a->se, i);
+        if (!s->used) continue;
+        if (se_load_poll(a, s) == ENG_LOAD_PENDING) sound_load_state(s, &p);
+        else                                      p = 1.0f;
+        sum += p;
+        ++n;
+    }
+    return n ? sum / (float)n : 1.0f;
+}
+
+void eng_audio_wait_loads(ENG_Audio* a) {
+    if (!a) return;
+    if (a->headless) rm_pump(a);
+    ma_fence_wait(&a->loads);
+    for (ma_uint32 i = 0; i < a->se.count; ++i) {
+        SoundSlot* s = slot_at(&a->se, i);
+        if (s->used) se_load_poll(a, s);
+    }
+}
+
+/* ── デコードキャッシュ ─────────────────────────────────*/
+void eng_audio_set_cache_budget(ENG_Audio* a, uint64_t bytes) {
+    if (!a) return;
+    a->cache_budget = bytes;
+    cache_trim(a);
+}
+
+void eng_audio_get_cache_stats(ENG_Audio* a, ENG_CacheStats* out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!a) return;
+    /* デコード中だったものを確定させ、未使用になっていれば上限を適用する */
+    for (ma_uint32 i = 0; i < a->cache_bucket_count; ++i)
+        for (CacheEntry* e = a->cache_buckets[i]; e; e = e->next) cache_size(a, e);
+    cache_trim(a);
+    out->hits           = a->cache_hits;
+    out->misses         = a->cache_misses;
+    out->evictions      = a->cache_evictions;
+    out->resident_bytes = a->cache_bytes;
+    out->unused_bytes   = a->cache_unused;
+    out->entries        = a->cache_count;
+    out->budget         = a->cache_budget;
+    out->encoded_bytes  = a->cache_encoded;
+    out->voice_bytes    = ma_atomic_load_64(&a->enc_voice_bytes);
+}
+
+/* ── サウンドバンク ─────────────────────────────────────*/
+ENG_BankID eng_bank_load(ENG_Audio* a, const char* path) {
+    if (!a || !path) return 0;
+    ma_uint32 idx = 0;
+    while (idx < a->bank_count && a->banks[idx].used) ++idx;
+    if (idx == a->bank_count) {
+        BankSlot* banks = realloc(a->banks, sizeof(BankSlot) * (a->bank_count + 1));
+        if (!banks) return 0;
+        a->banks = banks;
+        memset(&a->banks[a->bank_count++], 0, sizeof(BankSlot));
+    }
+    BankSlot* b = &a->banks[idx];
+    if (!eng_bank_map(&b->map, path)) return 0;
+    b->keys = calloc(b->map.header->entry_count ? b->map.header->entry_count : 1, sizeof(char*));
+    if (!b->keys) {
+        eng_bank_unmap(&b->map);
+        return 0;
+    }
+    b->used = true;
+    b->refs = 0;
+    return (ENG_BankID)(idx + 1);
+}
+
+bool eng_bank_unload(ENG_Audio* a, ENG_BankID id) {
+    if (!a || id == 0 || id > a->bank_count || !a->banks[id - 1].used) return false;
+    BankSlot* b = &a->banks[id - 1];
+    if (b->refs > 0) {
+        fprintf(stderr, "[eng_audio] バンク解放不可: 使用中の SE が %u 個\n", (unsigned)b->refs);
+        return false;
+    }
+    bank_close(a, b);
+    return true;
+}
+
+/* ── BGM ────────────────────────────────────────────────*/
+ENG_SoundID eng_bgm_load(ENG_Audio* a, const char* path) {
+    return bgm_load(a, path, ENG_BUS_BGM, false);
+}
+ENG_SoundID eng_bgm_load_async(ENG_Audio* a, const char* path) {
+    return bgm_load(a, path, ENG_BUS_BGM, true);
+}
+ENG_SoundID eng_bgm_load_ex(ENG_Audio* a, const char* path, const ENG_LoadParams* params) {
+    ma_uint32 bus;
+    bool      async;
+    if (!load_params(params, ENG_BUS_BGM, &bus, &async)) return 0;
+    return bgm_load(a, path, bus, async);
+}
+ENG_LoadState eng_bgm_load_state(ENG_Audio* a, ENG_SoundID id, float* progress) {
+    SoundSlot* s = bgm_slot(a, id);
+    if (progress) *progress = 0.0f;
+    return s ? sound_load_state(s, progress) : ENG_LOAD_NONE;
 }
 
 void eng_bgm_play(ENG_Audio* a, ENG_SoundID id) {
     SoundSlot* s = bgm_slot(a, id);
-    if (s) ma_sound_start(&s->sound);
+    if (s) cmd_send(a, CMD_PLAY, s, 0.0f, 0.0f, 0, 0);
+}
+void eng_bgm_play_at(ENG_Audio* a, ENG_SoundID id, uint64_t frame) {
+    SoundSlot* s = bgm_slot(a, id);
+    if (s) cmd_send(a, CMD_PLAY, s, 0.0f, 0.0f, frame, 0);
+}
+void eng_bgm_stop_at(ENG_Audio* a, ENG_SoundID id, uint64_t frame) {
+    SoundSlot* s = bgm_slot(a, id);
+    if (s) cmd_send(a, CMD_STOP_AT, s, 0.0f, 0.0f, frame, 0);
 }
 void eng_bgm_stop(ENG_Audio* a, ENG_SoundID id) {
     SoundSlot* s = bgm_slot(a, id);
-    if (s) { ma_sound_stop(&s->sound); ma_sound_seek_to_pcm_frame(&s->sound, 0); }
+    if (s) cmd_send(a, CMD_STOP, s, 0.0f, 0.0f, 0, 0);
 }
 void eng_bgm_pause(ENG_Audio* a, ENG_SoundID id) {
     SoundSlot* s = bgm_slot(a, id);
-    if (s) ma_sound_stop(&s->sound);
+    if (s) cmd_send(a, CMD_PAUSE, s, 0.0f, 0.0f, 0, 0);
 }
 void eng_bgm_resume(ENG_Audio* a, ENG_SoundID id) {
     SoundSlot* s = bgm_slot(a, id);
-    if (s) ma_sound_start(&s->sound);
+    if (s) cmd_send(a, CMD_PLAY, s, 0.0f, 0.0f, 0, 0);
 }
 void eng_bgm_set_loop(ENG_Audio* a, ENG_SoundID id, bool loop) {
     SoundSlot* s = bgm_slot(a, id);
-    if (s) ma_sound_set_looping(&s->sound, loop ? MA_TRUE : MA_FALSE);
+    if (s) cmd_send(a, CMD_LOOP, s, 0.0f, 0.0f, 0, loop ? 1 : 0);
+}
+bool eng_bgm_set_loop_points(ENG_Audio* a, ENG_SoundID id, uint64_t start, uint64_t end) {
+    SoundSlot* s = bgm_slot(a, id);
+    if (!s) return false;
+    BgmTrack* t   = bgm_cur(&s->stream);
+    ma_uint64 beg = bgm_track_frames(a, t, start);
+    ma_uint64 fin = end ? bgm_track_frames(a, t, end) : ~(ma_uint64)0;
+    ma_uint64 len = 0;
+    ma_resource_manager_data_source_get_length_in_pcm_frames(&t->src, &len);
+    if ((end && end <= start) || (len && end && fin > len) || !bgm_loop_check(t, beg, &fin)) {
+        fprintf(stderr, "[eng_audio] ループ区間が不正 (%llu〜%llu。範囲外か 1 ページ未満)\n",
+                (unsigned long long)start, (unsigned long long)end);
+        return false;
+    }
+    /* コマンドには 32 ビットずつ詰める (0xFFFFFFFF=曲末) */
+    cmd_send(a, CMD_LOOP_POINTS, s, 0.0f, 0.0f, beg << 32 | (fin & 0xFFFFFFFFu), 0);
+    return true;
+}
+bool eng_bgm_queue(ENG_Audio* a, ENG_SoundID id, const char* path, bool loop) {
+    SoundSlot* s = bgm_slot(a, id);
+    if (!s || !path) return false;
+    bgm_retire(s);
+    if (ma_atomic_load_ptr(&s->stream.queued)) {
+        fprintf(stderr, "[eng_audio] BGM予約失敗 '%s': 既に次の曲が予約されている\n", path);
+        return false;
+    }
+    ma_result r;
+    BgmTrack* t = bgm_track_open(a, path, loop, NULL, &r);
+    if (!t) {
+        fprintf(stderr, "[eng_audio] BGM予約失敗 '%s': %s\n", path, ma_result_description(r));
+        return false;
+    }
+    ma_uint32 ch_cur = 0, ch_next = 0;
+    ma_resource_manager_data_source_get_data_format(&bgm_cur(&s->stream)->src, NULL, &ch_cur, NULL, NULL, 0);
+    ma_resource_manager_data_source_get_data_format(&t->src, NULL, &ch_next, NULL, NULL, 0);
+    if (ch_cur != ch_next) {
+        fprintf(stderr, "[eng_audio] BGM予約失敗 '%s': チャンネル数が違う (%u → %u)\n",
+                path, (unsigned)ch_cur, (unsigned)ch_next);
+        bgm_track_close(t);
+        return false;
+    }
+    /* 空なのは確認済み。ここから先はオーディオスレッドが取り出す */
+    ma_atomic_store_ptr(&s->stream.queued, t);
+    return true;
+}
+bool eng_bgm_is_queued(ENG_Audio* a, ENG_SoundID id) {
+    SoundSlot* s = bgm_slot(a, id);
+    if (!s) return false;
+    bgm_retire(s);
+    return ma_atomic_load_ptr(&s->stream.queued) != NULL;
 }
 void eng_bgm_set_volume(ENG_Audio* a, ENG_SoundID id, float vol) {
     SoundSlot* s = bgm_slot(a, id);
-    if (s) ma_sound_set_volume(&s->sound, vol);
+    if (s) cmd_send(a, CMD_VOLUME, s, vol, 0.0f, 0, 0);
 }
 void eng_bgm_seek(ENG_Audio* a, ENG_SoundID id, float seconds) {
     SoundSlot* s = bgm_slot(a, id);
     if (!s) return;
     ma_uint32 sr = ma_engine_get_sample_rate(&a->engine);
-    ma_sound_seek_to_pcm_frame(&s->sound, (ma_uint64)(seconds * sr));
+    cmd_send(a, CMD_SEEK, s, 0.0f, 0.0f, (ma_uint64)(seconds * sr), 0);
 }
 float eng_bgm_position(ENG_Audio* a, ENG_SoundID id) {
     SoundSlot* s = bgm_slot(a, id);
@@ -132,75 +3653,424 @@ bool eng_bgm_is_playing(ENG_Audio* a, ENG_SoundID id) {
 }
 void eng_bgm_free(ENG_Audio* a, ENG_SoundID id) {
     SoundSlot* s = bgm_slot(a, id);
-    if (s) { ma_sound_uninit(&s->sound); memset(s, 0, sizeof(*s)); }
+    if (!s) return;
+    engine_lock(a);
+    live_remove(a, s);
+    fx_clear(a, s);
+    bgm_release(s);
+    slot_release(&a->bgm, s);
+    engine_unlock(a);
 }
 
 /* ── SE ─────────────────────────────────────────────────*/
 ENG_SoundID eng_se_load(ENG_Audio* a, const char* path) {
-    if (!a || !path) return 0;
-    for (int i = 0; i < ENG_MAX_SE; ++i) {
-        if (!a->se[i].used) {
-            ma_result r = ma_sound_init_from_file(
-                &a->engine, path, 0, NULL, NULL, &a->se[i].sound);
-            if (r != MA_SUCCESS) {
-                fprintf(stderr, "[eng_audio] SE読込失敗 '%s': %s\n", path, ma_result_description(r));
-                return 0;
-            }
-            a->se[i].used      = true;
-            a->se[i].streaming = false;
-            return (ENG_SoundID)(i + 1);
-        }
-    }
-    fprintf(stderr, "[eng_audio] SEスロット満杯 (max=%d)\n", ENG_MAX_SE);
-    return 0;
+    return se_load(a, path, ENG_BUS_SE, false, 0);
+}
+ENG_SoundID eng_se_load_async(ENG_Audio* a, const char* path) {
+    return se_load(a, path, ENG_BUS_SE, true, 0);
+}
+ENG_SoundID eng_se_load_ex(ENG_Audio* a, const char* path, const ENG_LoadParams* params) {
+    ma_uint32 bus;
+    bool      async;
+    if (!a || !load_params(params, ENG_BUS_SE, &bus, &async)) return 0;
+    ma_uint32 ahead = 0;
+    if (params && (params->flags & ENG_LOAD_FLAG_COMPRESSED))
+        ahead = params->decode_ahead_ms ? params->decode_ahead_ms : a->decode_ahead_ms;
+    return se_load(a, path, bus, async, ahead);
+}
+ENG_LoadState eng_se_load_state(ENG_Audio* a, ENG_SoundID id, float* progress) {
+    SoundSlot* s = se_slot(a, id);
+    if (progress) *progress = 0.0f;
+    if (!s) return ENG_LOAD_NONE;
+    ENG_LoadState st = se_load_poll(a, s);
+    if (st == ENG_LOAD_PENDING) sound_load_state(s, progress);
+    else if (progress)          *progress = st == ENG_LOAD_READY ? 1.0f : 0.0f;
+    return st;
 }
 
-void eng_se_play(ENG_Audio* a, ENG_SoundID id) {
+/* 発音できる SE を返す。読込中ならここで完了を確かめる。 */
+static SoundSlot* se_playable(ENG_Audio* a, ENG_SoundID id) {
     SoundSlot* s = se_slot(a, id);
-    if (!s) return;
-    ma_sound_seek_to_pcm_frame(&s->sound, 0);
-    ma_sound_start(&s->sound);
+    return s && se_load_poll(a, s) == ENG_LOAD_READY ? s : NULL;
+}
+
+void eng_se_play(ENG_Audio* a, ENG_SoundID id) {
+    SoundSlot* s = se_playable(a, id);
+    if (s) cmd_send(a, CMD_PLAY, s, 0.0f, 0.0f, 0, 0);
 }
 void eng_se_play_vol(ENG_Audio* a, ENG_SoundID id, float vol) {
-    SoundSlot* s = se_slot(a, id);
-    if (!s) return;
-    ma_sound_set_volume(&s->sound, vol);
-    ma_sound_seek_to_pcm_frame(&s->sound, 0);
-    ma_sound_start(&s->sound);
+    SoundSlot* s = se_playable(a, id);
+    if (s) cmd_send(a, CMD_PLAY, s, vol, 0.0f, 0, 1);
+}
+void eng_se_play_at(ENG_Audio* a, ENG_SoundID id, uint64_t frame) {
+    SoundSlot* s = se_playable(a, id);
+    if (s) cmd_send(a, CMD_PLAY, s, 0.0f, 0.0f, frame, 0);
 }
 void eng_se_stop(ENG_Audio* a, ENG_SoundID id) {
     SoundSlot* s = se_slot(a, id);
-    if (s) { ma_sound_stop(&s->sound); ma_sound_seek_to_pcm_frame(&s->sound, 0); }
+    if (s) cmd_send(a, CMD_STOP, s, 0.0f, 0.0f, 0, 0);
 }
 void eng_se_set_volume(ENG_Audio* a, ENG_SoundID id, float vol) {
     SoundSlot* s = se_slot(a, id);
-    if (s) ma_sound_set_volume(&s->sound, vol);
+    if (s) cmd_send(a, CMD_VOLUME, s, vol, 0.0f, 0, 0);
 }
 void eng_se_set_pitch(ENG_Audio* a, ENG_SoundID id, float pitch) {
     SoundSlot* s = se_slot(a, id);
-    if (s) ma_sound_set_pitch(&s->sound, pitch);
+    if (s) cmd_send(a, CMD_PITCH, s, pitch, 0.0f, 0, 0);
 }
 void eng_se_set_loop(ENG_Audio* a, ENG_SoundID id, bool loop) {
     SoundSlot* s = se_slot(a, id);
-    if (s) ma_sound_set_looping(&s->sound, loop ? MA_TRUE : MA_FALSE);
+    if (s) cmd_send(a, CMD_LOOP, s, 0.0f, 0.0f, 0, loop ? 1 : 0);
 }
 bool eng_se_is_playing(ENG_Audio* a, ENG_SoundID id) {
     SoundSlot* s = se_slot(a, id);
-    return s && ma_sound_is_playing(&s->sound);
+    if (!s) return false;
+    for (ma_uint32 i = 0; i < s->voice_count; ++i)
+        if (ma_sound_is_playing(&s->voices[i].sound) || ma_atomic_load_32(&s->voices[i].virt)) return true;
+    return false;
 }
 void eng_se_free(ENG_Audio* a, ENG_SoundID id) {
     SoundSlot* s = se_slot(a, id);
-    if (s) { ma_sound_uninit(&s->sound); memset(s, 0, sizeof(*s)); }
+    if (!s) return;
+    if (s->state == ENG_LOAD_PENDING) sound_wait_jobs(&s->sound);
+    engine_lock(a);
+    live_remove(a, s);
+    fx_clear(a, s);
+    se_voices_release(s);
+    ma_sound_uninit(&s->sound);
+    enc_stream_close(s->enc);
+    if (s->bank) a->banks[s->bank - 1].refs--;
+    CacheEntry* e = s->cache;
+    slot_release(&a->se, s);
+    engine_unlock(a);
+    cache_release(a, e);
+}
+
+/* ボイスプールを作り直す (engine_lock 中)。確保は発音時ではなくここで行い、失敗時は旧プールを維持する。 */
+static bool se_voices_rebuild(ENG_Audio* a, SoundSlot* s, ma_uint32 count) {
+    if (s->state != ENG_LOAD_READY) return true; /* 読込完了時に voice_want で確保される */
+    SEVoice*  old_voices = s->voices;
+    ma_uint32 old_count  = s->voice_count;
+    if (!se_voices_alloc(a, s, count)) return false;
+    for (ma_uint32 i = 0; i < old_count; ++i)
+        se_voice_uninit(&old_voices[i]);
+    free(old_voices);
+    return true;
+}
+
+bool eng_se_set_voices(ENG_Audio* a, ENG_SoundID id, uint32_t max_voices, ENG_StealMode mode) {
+    SoundSlot* s = se_slot(a, id);
+    if (!s || max_voices == 0 || (uint32_t)mode > ENG_STEAL_NONE) return false;
+    engine_lock(a);
+    s->steal      = mode;
+    s->voice_want = max_voices;
+    bool ok = max_voices == s->voice_count || se_voices_rebuild(a, s, max_voices);
+    engine_unlock(a);
+    return ok;
+}
+
+bool eng_se_set_resample(ENG_Audio* a, ENG_SoundID id, uint32_t quality) {
+    SoundSlot* s = se_slot(a, id);
+    if (!s || quality > ENG_RESAMPLE_HIGH) return false;
+    engine_lock(a);
+    ma_uint32 old = s->resample;
+    s->resample = quality;
+    bool ok = quality == old || se_voices_rebuild(a, s, s->voice_count);
+    if (!ok) s->resample = old;
+    engine_unlock(a);
+    return ok;
+}
+
+void eng_se_set_priority(ENG_Audio* a, ENG_SoundID id, int priority) {
+    SoundSlot* s = se_slot(a, id);
+    if (s) cmd_send(a, CMD_PRIORITY, s, 0.0f, 0.0f, 0, (ma_uint32)priority);
+}
+
+bool eng_se_get_memory(ENG_Audio* a, ENG_SoundID id, ENG_SoundMemory* out) {
+    SoundSlot* s = se_slot(a, id);
+    if (!out) return false;
+    memset(out, 0, sizeof(*out));
+    if (!s) return false;
+    ma_uint32 rate = ma_engine_get_sample_rate(&a->engine);
+    if (s->enc) {
+        const EncAsset* as  = s->enc->asset;
+        ma_uint32       bpf = enc_frame_bytes(as);
+        out->compressed    = true;
+        out->encoded_bytes = as->size;
+        out->decoded_bytes = as->head_frames * bpf;
+        out->full_bytes    = ma_calculate_frame_count_after_resampling(rate, as->sample_rate, as->length) * bpf;
+        for (ma_uint32 i = 0; i < s->voice_count; ++i)
+            if (ma_atomic_load_32(&s->voices[i].enc->ring_state) == ENC_RING_READY)
+                out->voice_bytes += (ma_uint64)as->ring_frames * bpf;
+        return true;
+    }
+    /* 読込時にエンジンのレートへ変換してある (バンクの PCM はそのまま) */
+    ma_format fmt = ma_format_f32;
+    ma_uint32 ch  = 0;
+    ma_uint64 len = 0;
+    ma_sound_get_data_format(&s->sound, &fmt, &ch, NULL, NULL, 0);
+    ma_sound_get_length_in_pcm_frames(&s->sound, &len);
+    out->decoded_bytes = len * ma_get_bytes_per_frame(fmt, ch);
+    out->full_bytes    = out->decoded_bytes;
+    return true;
 }
 
 /* ── グローバル ─────────────────────────────────────────*/
 void eng_audio_set_master_volume(ENG_Audio* a, float vol) {
-    if (a) ma_engine_set_volume(&a->engine, vol);
+    if (!a) return;
+    a->master_shadow = vol;
+    cmd_send(a, CMD_MASTER_VOLUME, NULL, vol, 0.0f, 0, 0);
+}
+bool eng_audio_set_voice_budget(ENG_Audio* a, uint32_t max_voices) {
+    if (!a) return false;
+    VoiceRank* heap = NULL;
+    if (max_voices > 0 && !(heap = malloc(sizeof(VoiceRank) * max_voices))) return false;
+    /* 作業領域ごと差し替える。仮想化中のボイスは次のブロックで振り分け直される */
+    engine_lock(a);
+    VoiceRank* old = a->voice_heap;
+    a->voice_heap   = heap;
+    a->voice_budget = max_voices;
+    engine_unlock(a);
+    free(old);
+    return true;
+}
+uint32_t eng_audio_get_voice_budget(ENG_Audio* a) {
+    return a ? a->voice_budget : 0;
+}
+void eng_audio_set_cull(ENG_Audio* a, float gain, uint32_t ms) {
+    if (!a) return;
+    if (ms == 0) ms = ENG_CULL_MS_DEFAULT;
+    ma_uint64 frames = (ma_uint64)ms * ma_engine_get_sample_rate(&a->engine) / 1000;
+    cmd_send(a, CMD_CULL, NULL, gain, 0.0f, frames, 0);
 }
+
 float eng_audio_get_master_volume(ENG_Audio* a) {
-    /* miniaudio に getter がないため内部値を保持しない — 0を返す */
-    (void)a;
-    return 1.0f;
+    return a ? a->master_shadow : 0.0f;
+}
+
+/* ── ミキサーバス ───────────────────────────────────────*/
+void eng_bus_set_volume(ENG_Audio* a, ENG_Bus bus, float vol) {
+    if (!a || (ma_uint32)bus >= ENG_BUS_COUNT) return;
+    a->bus_volume_shadow[bus] = vol;
+    cmd_send(a, CMD_BUS_VOLUME, NULL, vol, 0.0f, 0, (ma_uint32)bus);
+}
+float eng_bus_get_volume(ENG_Audio* a, ENG_Bus bus) {
+    return a && (ma_uint32)bus < ENG_BUS_COUNT ? a->bus_volume_shadow[bus] : 0.0f;
+}
+
+void eng_bus_set_pan(ENG_Audio* a, ENG_Bus bus, float pan) {
+    if (a && (ma_uint32)bus < ENG_BUS_COUNT)
+        cmd_send(a, CMD_BUS_PAN, NULL, pan, 0.0f, 0, (ma_uint32)bus);
+}
+
+void eng_bus_fade(ENG_Audio* a, ENG_Bus bus, float target, float duration) {
+    if (!a || (ma_uint32)bus >= ENG_BUS_COUNT) return;
+    ma_uint64 ms = (ma_uint64)(duration * 1000.0f);
+    cmd_send(a, CMD_BUS_FADE, NULL, -1.0f, target, ms, (ma_uint32)bus);
+}
+
+void eng_bus_set_mute(ENG_Audio* a, ENG_Bus bus, bool mute) {
+    if (!a || (ma_uint32)bus >= ENG_BUS_COUNT) return;
+    a->bus_muted_shadow[bus] = mute;
+    cmd_send(a, CMD_BUS_MUTE, NULL, 0.0f, 0.0f, mute ? 1 : 0, (ma_uint32)bus);
+}
+bool eng_bus_is_muted(ENG_Audio* a, ENG_Bus bus) {
+    return a && (ma_uint32)bus < ENG_BUS_COUNT && a->bus_muted_shadow[bus];
+}
+
+/* ── インサートエフェクト ───────────────────────────────*/
+static void fx_node_process(ma_node* node, const float** in, ma_uint32* in_count,
+                            float** out, ma_uint32* out_count) {
+    ma_uint32 frames = *in_count < *out_count ? *in_count : *out_count;
+    fx_node_run((FxNode*)node, in[0], out[0], frames);
+    *in_count  = frames;
+    *out_count = frames;
+}
+
+static ma_node_vtable g_fx_vtable = { fx_node_process, NULL, 1, 1, 0 };
+/* リバーブは入力が止まっても残響を出し切る。解析は止まったあとの無音も測る (ピークが下がる) */
+static ma_node_vtable g_fx_tail_vtable = { fx_node_process, NULL, 1, 1, MA_NODE_FLAG_CONTINUOUS_PROCESSING };
+
+/* スクリプトスレッド: 表の面を押さえる。meter_release まで、オーディオスレッドはその面に書かない。 */
+static const MeterSnap* meter_claim(FxNode* n) {
+    for (;;) {
+        ma_uint32 f = ma_atomic_load_32(&n->front);
+        ma_atomic_store_32(&n->reading, f);
+        if (ma_atomic_load_32(&n->front) == f) return &n->snap[f];
+    }
+}
+static void meter_release(FxNode* n) {
+    ma_atomic_store_32(&n->reading, METER_SNAP_IDLE);
+}
+
+static FxSlot* fx_get(ENG_Audio* a, ENG_FxID id) {
+    return a && id != 0 && id <= a->fx_count && a->fx[id - 1].used ? &a->fx[id - 1] : NULL;
+}
+
+ENG_FxID eng_fx_create(ENG_Audio* a, ENG_FxType type) {
+    if (!a) return 0;
+    if ((ma_uint32)type >= ENG_FX_TYPE_COUNT) {
+        fprintf(stderr, "[eng_audio] 不明なエフェクト %u\n", (unsigned)type);
+        return 0;
+    }
+    ma_uint32 idx = 0;
+    while (idx < a->fx_count && a->fx[idx].used) ++idx;
+    if (idx == a->fx_count) {
+        FxSlot* fx = realloc(a->fx, sizeof(FxSlot) * (a->fx_count + 1));
+        if (!fx) return 0;
+        a->fx = fx;
+        memset(&a->fx[a->fx_count++], 0, sizeof(FxSlot));
+    }
+    ma_uint32 ch = ma_engine_get_channels(&a->engine);
+    FxNode*   n  = calloc(1, sizeof(FxNode));
+    if (n && type == ENG_FX_METER) n->snap = calloc(2, sizeof(MeterSnap));
+    if (!n || (type == ENG_FX_METER && !n->snap)
+        || !eng_dsp_init(&n->dsp, type, ch, ma_engine_get_sample_rate(&a->engine))) {
+        fprintf(stderr, "[eng_audio] エフェクト作成失敗: メモリ不足\n");
+        if (n) fx_node_free(n);
+        return 0;
+    }
+    for (ma_uint32 i = 0; i < ENG_FX_PARAM_COUNT; ++i)
+        ma_atomic_store_f32(&n->param[i], n->dsp.target[i]);
+    if (n->snap) {
+        /* 最初の公開までは無音の値を見せる */
+        eng_dsp_meter_levels(&n->dsp, &n->snap[0].levels);
+        n->snap[1].levels = n->snap[0].levels;
+        ma_atomic_store_32(&n->reading, METER_SNAP_IDLE);
+    }
+    ma_node_config nc = ma_node_config_init();
+    nc.vtable          = type == ENG_FX_REVERB || type == ENG_FX_METER ? &g_fx_tail_vtable : &g_fx_vtable;
+    nc.pInputChannels  = &ch;
+    nc.pOutputChannels = &ch;
+    ma_result r = ma_node_init(ma_engine_get_node_graph(&a->engine), &nc, NULL, &n->base);
+    if (r != MA_SUCCESS) {
+        fprintf(stderr, "[eng_audio] エフェクト作成失敗: %s\n", ma_result_description(r));
+        fx_node_free(n);
+        return 0;
+    }
+    FxSlot* f = &a->fx[idx];
+    memset(f, 0, sizeof(*f));
+    f->node = n;
+    f->used = true;
+    return (ENG_FxID)(idx + 1);
+}
+
+void eng_fx_free(ENG_Audio* a, ENG_FxID id) {
+    FxSlot* f = fx_get(a, id);
+    if (!f) return;
+    fx_unlink(a, id);
+    ma_node_uninit(&f->node->base, NULL); /* オーディオスレッドが読み終えるまで待つ */
+    fx_node_free(f->node);
+    memset(f, 0, sizeof(*f));
+}
+
+bool eng_fx_set_param(ENG_Audio* a, ENG_FxID id, ENG_FxParam param, float value) {
+    FxSlot* f = fx_get(a, id);
+    if (!f || (ma_uint32)param >= ENG_FX_PARAM_COUNT) return false;
+    ma_atomic_store_f32(&f->node->param[param], value);
+    ma_atomic_store_32(&f->node->dirty, 1);
+    return true;
+}
+
+/* 今の接続先から外し、target へ付け替える。 */
+static bool fx_attach(ENG_Audio* a, ENG_FxID id, FxTarget target, ma_uint32 bus, SoundSlot* s) {
+    FxSlot* f = fx_get(a, id);
+    if (!f) return false;
+    fx_unlink(a, id);
+    f->target = target;
+    f->bus    = bus;
+    f->sound  = s;
+    fx_link(a, id);
+    return true;
+}
+
+bool eng_fx_attach_bus(ENG_Audio* a, ENG_FxID id, ENG_Bus bus) {
+    if ((ma_uint32)bus >= ENG_BUS_COUNT) return false;
+    return fx_attach(a, id, FX_TARGET_BUS, bus, NULL);
+}
+bool eng_fx_attach_bgm(ENG_Audio* a, ENG_FxID id, ENG_SoundID snd) {
+    SoundSlot* s = bgm_slot(a, snd);
+    return s && fx_attach(a, id, FX_TARGET_BGM, 0, s);
+}
+bool eng_fx_attach_se(ENG_Audio* a, ENG_FxID id, ENG_SoundID snd) {
+    SoundSlot* s = se_slot(a, snd);
+    return s && fx_attach(a, id, FX_TARGET_SE, 0, s);
+}
+
+bool eng_fx_attach_master(ENG_Audio* a, ENG_FxID id) {
+    FxSlot* f = fx_get(a, id);
+    if (!f) return false;
+    if (!f->node->snap) {
+        fprintf(stderr, "[eng_audio] マスターに挿せるのは解析だけ\n");
+        return false;
+    }
+    /* master_meters の空き位置 (付け替えなら自分の位置も空きとみなす) */
+    ma_uint32 taken = 0, pos = 0;
+    for (ma_uint32 i = a->master_fx; i; i = fx_at(a, i)->next)
+        if (i != id) taken |= 1u << fx_at(a, i)->bus;
+    while (pos < ENG_MASTER_METERS && (taken >> pos) & 1u) ++pos;
+    if (pos == ENG_MASTER_METERS) {
+        fprintf(stderr, "[eng_audio] マスターの解析は %d 個まで\n", ENG_MASTER_METERS);
+        return false;
+    }
+    return fx_attach(a, id, FX_TARGET_MASTER, pos, NULL);
+}
+
+void eng_fx_detach(ENG_Audio* a, ENG_FxID id) {
+    if (fx_get(a, id)) fx_unlink(a, id);
+}
+
+static FxNode* meter_get(ENG_Audio* a, ENG_FxID id) {
+    FxSlot* f = fx_get(a, id);
+    return f && f->node->snap ? f->node : NULL;
+}
+
+static float meter_power_db(float power) {
+    float db = power > 0.0f ? 10.0f * log10f(power) : ENG_METER_FLOOR_DB;
+    return db > ENG_METER_FLOOR_DB ? db : ENG_METER_FLOOR_DB;
+}
+
+bool eng_fx_get_meter(ENG_Audio* a, ENG_FxID id, ENG_MeterLevels* out) {
+    FxNode* n = meter_get(a, id);
+    if (!n || !out) return false;
+    *out = meter_claim(n)->levels;
+    meter_release(n);
+    return true;
+}
+
+uint32_t eng_fx_get_spectrum(ENG_Audio* a, ENG_FxID id, float* out, uint32_t bands) {
+    FxNode* n = meter_get(a, id);
+    if (!n || !out || bands == 0) return 0;
+    const float* power = meter_claim(n)->power;
+    if (bands >= ENG_METER_BINS) {
+        bands = ENG_METER_BINS;
+        for (ma_uint32 k = 0; k < bands; ++k) out[k] = meter_power_db(power[k]);
+    } else {
+        /* 20Hz からナイキスト (= ENG_METER_BINS 番目) までを対数で等分する。単位はビン */
+        float lo   = 20.0f * (float)ENG_METER_FFT_SIZE / (float)n->dsp.sample_rate;
+        float step = powf((float)ENG_METER_BINS / lo, 1.0f / (float)bands);
+        for (ma_uint32 b = 0; b < bands; ++b) {
+            float     e0 = lo * powf(step, (float)b), e1 = e0 * step;
+            ma_uint32 k0 = (ma_uint32)(e0 + 0.5f), k1 = (ma_uint32)(e1 + 0.5f);
+            if (k1 > ENG_METER_BINS) k1 = ENG_METER_BINS;
+            if (k0 >= k1) {
+                /* ビンより狭い帯域は中心に近いビンで代表する */
+                k0 = (ma_uint32)((e0 + e1) * 0.5f + 0.5f);
+                if (k0 >= ENG_METER_BINS) k0 = ENG_METER_BINS - 1;
+                k1 = k0 + 1;
+            }
+            float p = 0.0f;
+            for (ma_uint32 k = k0; k < k1; ++k) if (power[k] > p) p = power[k];
+            out[b] = meter_power_db(p);
+        }
+    }
+    meter_release(n);
+    return bands;
+}
+
+void eng_fx_reset_meter(ENG_Audio* a, ENG_FxID id) {
+    FxNode* n = meter_get(a, id);
+    if (n) ma_atomic_store_32(&n->reset, 1);
 }
 
 /* ── フェード ────────────────────────────────────────────*/
@@ -208,42 +4078,131 @@ void eng_bgm_fade_in(ENG_Audio* a, ENG_SoundID id, float duration) {
     SoundSlot* s = bgm_slot(a, id);
     if (!s) return;
     ma_uint64 ms = (ma_uint64)(duration * 1000.0f);
-    ma_sound_set_fade_in_milliseconds(&s->sound, 0.0f, 1.0f, ms);
-    ma_sound_start(&s->sound);
+    cmd_send(a, CMD_FADE, s, 0.0f, 1.0f, ms, CMD_FADE_START);
 }
 
 void eng_bgm_fade_out(ENG_Audio* a, ENG_SoundID id, float duration) {
+    eng_bgm_fade_out_ex(a, id, duration, ENG_FADE_CONTINUE);
+}
+
+void eng_bgm_fade_out_ex(ENG_Audio* a, ENG_SoundID id, float duration, ENG_FadeEnd end) {
     SoundSlot* s = bgm_slot(a, id);
     if (!s) return;
     ma_uint64 ms = (ma_uint64)(duration * 1000.0f);
     /* -1 は「現在の音量から」を意味する */
-    ma_sound_set_fade_in_milliseconds(&s->sound, -1.0f, 0.0f, ms);
+    if ((ma_uint32)end > ENG_FADE_FREE) end = ENG_FADE_CONTINUE;
+    cmd_send(a, CMD_FADE, s, -1.0f, 0.0f, ms, (ma_uint32)end << 1);
 }
 
 void eng_bgm_crossfade(ENG_Audio* a, ENG_SoundID from_id, ENG_SoundID to_id, float duration) {
+    eng_bgm_crossfade_ex(a, from_id, to_id, duration, ENG_FADE_CONTINUE);
+}
+
+void eng_bgm_crossfade_ex(ENG_Audio* a, ENG_SoundID from_id, ENG_SoundID to_id, float duration,
+                          ENG_FadeEnd end) {
     SoundSlot* from = bgm_slot(a, from_id);
     SoundSlot* to   = bgm_slot(a, to_id);
     ma_uint64 ms    = (ma_uint64)(duration * 1000.0f);
-    if (from) {
-        ma_sound_set_fade_in_milliseconds(&from->sound, -1.0f, 0.0f, ms);
-    }
-    if (to) {
-        ma_sound_seek_to_pcm_frame(&to->sound, 0);
-        ma_sound_set_volume(&to->sound, 0.0f);
-        ma_sound_set_fade_in_milliseconds(&to->sound, 0.0f, 1.0f, ms);
-        ma_sound_start(&to->sound);
-    }
+    if (!a) return;
+    if ((ma_uint32)end > ENG_FADE_FREE) end = ENG_FADE_CONTINUE;
+    /* 両側が同じブロックで切り替わるようにまとめて公開する */
+    eng_audio_batch_begin(a);
+    if (from) cmd_send(a, CMD_FADE, from, -1.0f, 0.0f, ms, (ma_uint32)end << 1);
+    if (to)   cmd_send(a, CMD_CROSSFADE_IN, to, 0.0f, 0.0f, ms, 0);
+    eng_audio_batch_end(a);
 }
 
 /* ── パン ────────────────────────────────────────────────*/
 void eng_bgm_set_pan(ENG_Audio* a, ENG_SoundID id, float pan) {
     SoundSlot* s = bgm_slot(a, id);
-    if (s) ma_sound_set_pan(&s->sound, pan);
+    if (s) cmd_send(a, CMD_PAN, s, pan, 0.0f, 0, 0);
 }
 
 void eng_se_set_pan(ENG_Audio* a, ENG_SoundID id, float pan) {
     SoundSlot* s = se_slot(a, id);
-    if (s) ma_sound_set_pan(&s->sound, pan);
+    if (s) cmd_send(a, CMD_PAN, s, pan, 0.0f, 0, 0);
+}
+
+/* ── 3D 定位 ────────────────────────────────────────────*/
+void eng_audio_set_listener_position(ENG_Audio* a, float x, float y, float z) {
+    if (a) cmd_send_vec(a, CMD_LISTENER, NULL, CMD_VEC_POSITION, x, y, z);
+}
+void eng_audio_set_listener_direction(ENG_Audio* a, float x, float y, float z) {
+    if (a) cmd_send_vec(a, CMD_LISTENER, NULL, CMD_VEC_DIRECTION, x, y, z);
+}
+void eng_audio_set_listener_up(ENG_Audio* a, float x, float y, float z) {
+    if (a) cmd_send_vec(a, CMD_LISTENER, NULL, CMD_VEC_UP, x, y, z);
+}
+void eng_audio_set_listener_velocity(ENG_Audio* a, float x, float y, float z) {
+    if (a) cmd_send_vec(a, CMD_LISTENER, NULL, CMD_VEC_VELOCITY, x, y, z);
+}
+void eng_audio_set_spatial_lod(ENG_Audio* a, float distance) {
+    if (a) cmd_send(a, CMD_SPATIAL_LOD, NULL, distance > 0.0f ? distance : 0.0f, 0.0f, 0, 0);
+}
+
+/* 位置を書き、まだ 2D なら 3D にする。 */
+static void emitter_set(ENG_Audio* a, SoundSlot* s, float x, float y, float z) {
+    emitter_store(s, x, y, z);
+    if (!s->spatial_shadow) {
+        s->spatial_shadow = true;
+        cmd_send(a, CMD_SPATIAL, s, 1.0f, 0.0f, 0, ENG_SPATIAL_ENABLED);
+    }
+}
+
+static bool spatial_param_valid(ENG_SpatialParam p, float v) {
+    switch (p) {
+    case ENG_SPATIAL_ENABLED:         return true;
+    case ENG_SPATIAL_MODEL:           return v == 0.0f || v == 1.0f || v == 2.0f || v == 3.0f;
+    case ENG_SPATIAL_CONE_INNER:
+    case ENG_SPATIAL_CONE_OUTER:      return v >= 0.0f && v <= 360.0f;
+    case ENG_SPATIAL_CONE_OUTER_GAIN: return v >= 0.0f && v <= 1.0f;
+    default:                          return (ma_uint32)p < ENG_SPATIAL_PARAM_COUNT && v >= 0.0f;
+    }
+}
+static bool spatial_param_send(ENG_Audio* a, SoundSlot* s, ENG_SpatialParam p, float v) {
+    if (!s || !spatial_param_valid(p, v)) return false;
+    if (p == ENG_SPATIAL_ENABLED) {
+        v = v != 0.0f ? 1.0f : 0.0f;
+        s->spatial_shadow = v != 0.0f;
+    }
+    cmd_send(a, CMD_SPATIAL, s, v, 0.0f, 0, (ma_uint32)p);
+    return true;
+}
+
+void eng_se_set_position(ENG_Audio* a, ENG_SoundID id, float x, float y, float z) {
+    SoundSlot* s = se_slot(a, id);
+    if (s) emitter_set(a, s, x, y, z);
+}
+void eng_se_set_positions(ENG_Audio* a, const ENG_SoundID* ids, const float* x, const float* y,
+                          const float* z, uint32_t count) {
+    if (!a || !ids || !x || !y || !z) return;
+    for (uint32_t i = 0; i < count; ++i) {
+        SoundSlot* s = se_slot(a, ids[i]);
+        if (s) emitter_set(a, s, x[i], y[i], z[i]);
+    }
+}
+void eng_se_set_velocity(ENG_Audio* a, ENG_SoundID id, float x, float y, float z) {
+    SoundSlot* s = se_slot(a, id);
+    if (s) cmd_send_vec(a, CMD_EMITTER, s, CMD_VEC_VELOCITY, x, y, z);
+}
+void eng_se_set_direction(ENG_Audio* a, ENG_SoundID id, float x, float y, float z) {
+    SoundSlot* s = se_slot(a, id);
+    if (s) cmd_send_vec(a, CMD_EMITTER, s, CMD_VEC_DIRECTION, x, y, z);
+}
+bool eng_se_set_spatial(ENG_Audio* a, ENG_SoundID id, ENG_SpatialParam param, float value) {
+    return spatial_param_send(a, se_slot(a, id), param, value);
+}
+
+void eng_bgm_set_position(ENG_Audio* a, ENG_SoundID id, float x, float y, float z) {
+    SoundSlot* s = bgm_slot(a, id);
+    if (s) emitter_set(a, s, x, y, z);
+}
+void eng_bgm_set_velocity(ENG_Audio* a, ENG_SoundID id, float x, float y, float z) {
+    SoundSlot* s = bgm_slot(a, id);
+    if (s) cmd_send_vec(a, CMD_EMITTER, s, CMD_VEC_VELOCITY, x, y, z);
+}
+bool eng_bgm_set_spatial(ENG_Audio* a, ENG_SoundID id, ENG_SpatialParam param, float value) {
+    return spatial_param_send(a, bgm_slot(a, id), param, value);
 }
 
 /* ── BGM 長さ ────────────────────────────────────────────*/
@@ -267,5 +4226,5 @@ float eng_se_duration(ENG_Audio* a, ENG_SoundID id) {
 /* ── BGM ピッチ ──────────────────────────────────────────*/
 void eng_bgm_set_pitch(ENG_Audio* a, ENG_SoundID id, float pitch) {
     SoundSlot* s = bgm_slot(a, id);
-    if (s) ma_sound_set_pitch(&s->sound, pitch);
+    if (s) cmd_send(a, CMD_PITCH, s, pitch, 0.0f, 0, 0);
 }
@@ -0,0 +1,151 @@
+/**
+ * src/eng_bank.c — サウンドバンクの mmap と名前引き
+ *
+ * Copyright (c) 2026 Reo Shiozawa — MIT License
+ */
+#include "eng_bank.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+/* ── マップ ─────────────────────────────────────────────*/
+#ifdef _WIN32
+static bool map_file(EngBank* b, const char* path) {
+    HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(f, &size) || size.QuadPart == 0) { CloseHandle(f); return false; }
+    HANDLE m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!m) { CloseHandle(f); return false; }
+    void* p = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (!p) { CloseHandle(m); CloseHandle(f); return false; }
+    b->base    = (const unsigned char*)p;
+    b->size    = (size_t)size.QuadPart;
+    b->file    = f;
+    b->mapping = m;
+    return true;
+}
+static void unmap_file(EngBank* b) {
+    UnmapViewOfFile((void*)b->base);
+    CloseHandle((HANDLE)b->mapping);
+    CloseHandle((HANDLE)b->file);
+}
+#else
+static bool map_file(EngBank* b, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) { close(fd); return false; }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); /* マップは fd を閉じても残る */
+    if (p == MAP_FAILED) return false;
+    b->base = (const unsigned char*)p;
+    b->size = (size_t)st.st_size;
+    return true;
+}
+static void unmap_file(EngBank* b) {
+    munmap((void*)b->base, b->size);
+}
+#endif
+
+/* [off, off+len) がファイル内に収まるか (オーバーフローも弾く)。 */
+static bool in_file(const EngBank* b, uint64_t off, uint64_t len) {
+    return off <= b->size && len <= b->size - off;
+}
+
+/* PCM エントリのサイズと整列がフレーム数・形式と一致するか。 */
+static bool pcm_size_ok(const ENG_BankEntry* e) {
+    if (e->format == ENG_BANK_ENCODED) return true;
+    if (e->channels == 0 || e->channels > ENG_BANK_MAX_CHANNELS || e->sample_rate == 0) return false;
+    uint64_t bytes = e->format == ENG_BANK_PCM_F32 ? 4 : 2;
+    if (e->data_offset % bytes) return false; /* サンプル境界に整列していること */
+    uint64_t frame = e->channels * bytes;     /* 上限で抑えてあるので溢れない */
+    if (e->frame_count > UINT64_MAX / frame) return false;
+    return e->frame_count * frame == e->data_size;
+}
+
+/* ヘッダとエントリ表を検証する。データ本体のページには触れない。 */
+static bool validate(EngBank* b, const char* path) {
+    const ENG_BankHeader* h = (const ENG_BankHeader*)b->base;
+    const char* why = NULL;
+    if (b->size < sizeof(*h))                                 why = "ヘッダが短い";
+    else if (h->magic != ENG_BANK_MAGIC)                      why = "バンクではない";
+    else if (h->version != ENG_BANK_VERSION)                  why = "未対応のバージョン";
+    else if (h->file_size != b->size)                         why = "サイズ不一致";
+    else if (h->bucket_count == 0 || (h->bucket_count & (h->bucket_count - 1)) != 0
+             || h->bucket_count < h->entry_count)             why = "ハッシュ表が不正";
+    else if (!in_file(b, h->entries_offset, (uint64_t)h->entry_count * sizeof(ENG_BankEntry))
+             || (h->entries_offset % sizeof(uint64_t)) != 0)  why = "エントリ表が範囲外";
+    else if (!in_file(b, h->buckets_offset, (uint64_t)h->bucket_count * sizeof(uint32_t))
+             || (h->buckets_offset % sizeof(uint32_t)) != 0)  why = "ハッシュ表が範囲外";
+    else if (!in_file(b, h->names_offset, h->names_size) || h->names_size == 0
+             || b->base[h->names_offset + h->names_size - 1] != '\0') why = "名前表が不正";
+    if (why) {
+        fprintf(stderr, "[eng_audio] バンク読込失敗 '%s': %s\n", path, why);
+        return false;
+    }
+    b->header     = h;
+    b->entries    = (const ENG_BankEntry*)(b->base + h->entries_offset);
+    b->buckets    = (const uint32_t*)(b->base + h->buckets_offset);
+    b->names      = (const char*)(b->base + h->names_offset);
+    b->names_size = h->names_size;
+    for (uint32_t i = 0; i < h->entry_count; ++i) {
+        const ENG_BankEntry* e = &b->entries[i];
+        if (e->name_offset >= h->names_size
+            || !in_file(b, e->data_offset, e->data_size)
+            || e->format > ENG_BANK_ENCODED
+            || !pcm_size_ok(e)) {
+            fprintf(stderr, "[eng_audio] バンク読込失敗 '%s': エントリ %u が不正\n", path, i);
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < h->bucket_count; ++i) {
+        if (b->buckets[i] > h->entry_count) {
+            fprintf(stderr, "[eng_audio] バンク読込失敗 '%s': ハッシュ表が不正\n", path);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool eng_bank_map(EngBank* b, const char* path) {
+    memset(b, 0, sizeof(*b));
+    if (!path || !map_file(b, path)) {
+        fprintf(stderr, "[eng_audio] バンクを開けない '%s'\n", path ? path : "(null)");
+        return false;
+    }
+    if (!validate(b, path)) {
+        eng_bank_unmap(b);
+        return false;
+    }
+    return true;
+}
+
+void eng_bank_unmap(EngBank* b) {
+    if (b->base) unmap_file(b);
+    memset(b, 0, sizeof(*b));
+}
+
+const ENG_BankEntry* eng_bank_find(const EngBank* b, const char* name) {
+    if (!b->header || !name) return NULL;
+    uint32_t mask = b->header->bucket_count - 1;
+    uint32_t h    = eng_bank_hash(name);
+    /* 空バケツに当たるまで線形探査。表は半分以下しか埋めないので通常 1〜2 回で終わる */
+    for (uint32_t i = h & mask, n = 0; n <= mask; i = (i + 1) & mask, ++n) {
+        uint32_t slot = b->buckets[i];
+        if (slot == 0) return NULL;
+        const ENG_BankEntry* e = &b->entries[slot - 1];
+        if (e->name_hash == h && strcmp(eng_bank_name(b, e), name) == 0) return e;
+    }
+    return NULL;
+}
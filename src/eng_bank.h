@@ -0,0 +1,45 @@
+/**
+ * src/eng_bank.h — サウンドバンクの読み取り (内部用)
+ *
+ * バンクファイルを読み取り専用で mmap し、名前からエントリを引く。
+ * データはマップしたページをそのまま指すので、unmap するまで有効。
+ *
+ * Copyright (c) 2026 Reo Shiozawa — MIT License
+ */
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include "eng_bank_format.h"
+
+typedef struct {
+    const unsigned char*  base;
+    size_t                size;
+    const ENG_BankHeader* header;
+    const ENG_BankEntry*  entries;
+    const uint32_t*       buckets;
+    const char*           names;
+    size_t                names_size;
+#ifdef _WIN32
+    void*                 file;
+    void*                 mapping;
+#endif
+} EngBank;
+
+/** バンクを mmap して検証する。失敗時は false (b は未使用状態)。 */
+bool eng_bank_map(EngBank* b, const char* path);
+
+/** マップを解除する。 */
+void eng_bank_unmap(EngBank* b);
+
+/** 名前でエントリを引く。無ければ NULL。 */
+const ENG_BankEntry* eng_bank_find(const EngBank* b, const char* name);
+
+/** エントリのデータ先頭。 */
+static inline const void* eng_bank_data(const EngBank* b, const ENG_BankEntry* e) {
+    return b->base + e->data_offset;
+}
+
+/** エントリの名前。 */
+static inline const char* eng_bank_name(const EngBank* b, const ENG_BankEntry* e) {
+    return b->names + e->name_offset;
+}
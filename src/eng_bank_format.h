@@ -0,0 +1,63 @@
+/**
+ * src/eng_bank_format.h — サウンドバンク (.bank) のファイル形式
+ *
+ * tools/eng_bank_build.c が書き出し、src/eng_bank.c が mmap して読む。
+ * 全フィールドはリトルエンディアン。ランタイムはコピーせずにそのまま参照する。
+ *
+ *   ENG_BankHeader
+ *   ENG_BankEntry[entry_count]
+ *   uint32_t      buckets[bucket_count]   名前ハッシュの開番地法テーブル (entry index + 1, 0=空)
+ *   char          names[]                 NUL 終端の名前を連結したもの
+ *   (ENG_BANK_ALIGN 境界) 各エントリのデータ
+ *
+ * Copyright (c) 2026 Reo Shiozawa — MIT License
+ */
+#pragma once
+#include <stdint.h>
+
+#define ENG_BANK_MAGIC   0x42414A48u /* "HJAB" */
+#define ENG_BANK_VERSION 1u
+#define ENG_BANK_ALIGN   64u         /* データ先頭の整列 (SIMD / キャッシュライン) */
+#define ENG_BANK_MAX_CHANNELS 254u   /* PCM エントリのチャンネル数の上限 (miniaudio の MA_MAX_CHANNELS) */
+
+/** エントリのデータ形式。 */
+typedef enum {
+    ENG_BANK_PCM_F32 = 0, /* デコード済み f32 インターリーブ */
+    ENG_BANK_PCM_S16 = 1, /* デコード済み s16 インターリーブ (メモリ半分) */
+    ENG_BANK_ENCODED = 2, /* 元ファイルのまま (wav/flac/mp3)。読込時にデコード */
+} ENG_BankDataFormat;
+
+typedef struct {
+    uint32_t magic;          /* ENG_BANK_MAGIC */
+    uint32_t version;        /* ENG_BANK_VERSION */
+    uint32_t sample_rate;    /* ビルド時に揃えたサンプルレート (0 = 各エントリの元のまま) */
+    uint32_t entry_count;
+    uint32_t bucket_count;   /* 2 の累乗 */
+    uint32_t names_size;     /* names のバイト数 (NUL 含む) */
+    uint64_t entries_offset; /* ファイル先頭からのバイト位置 */
+    uint64_t buckets_offset;
+    uint64_t names_offset;
+    uint64_t file_size;      /* 切り詰められたファイルの検出用 */
+} ENG_BankHeader;
+
+typedef struct {
+    uint32_t name_hash;      /* eng_bank_hash(name) */
+    uint32_t name_offset;    /* names 先頭からのバイト位置 */
+    uint32_t format;         /* ENG_BankDataFormat */
+    uint32_t channels;       /* PCM のみ */
+    uint32_t sample_rate;    /* PCM のみ */
+    uint32_t reserved;
+    uint64_t frame_count;    /* PCM のみ */
+    uint64_t data_offset;    /* ファイル先頭からのバイト位置 (ENG_BANK_ALIGN 境界) */
+    uint64_t data_size;      /* バイト数 */
+} ENG_BankEntry;
+
+/** 名前のハッシュ (FNV-1a 32bit)。 */
+static inline uint32_t eng_bank_hash(const char* name) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; ++p) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
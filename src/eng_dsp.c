@@ -0,0 +1,818 @@
+/**
+ * src/eng_dsp.c — インサートエフェクトの DSP カーネル
+ *
+ * Copyright (c) 2026 Reo Shiozawa — MIT License
+ */
+#include "eng_dsp.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ── SIMD ───────────────────────────────────────────────*/
+/*
+ * v4 = 4 レーン、v8 = 8 レーン。AVX2 がなければ v8 は v4 2 本で組む。
+ * どれもなければスカラーの配列で同じ処理をする。
+ */
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define ENG_DSP_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define ENG_DSP_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#  define ENG_DSP_NEON 1
+#endif
+
+#if defined(ENG_DSP_SSE2)
+typedef __m128 v4;
+static inline v4   v4_set1(float x)                { return _mm_set1_ps(x); }
+static inline v4   v4_setr(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+static inline v4   v4_load(const float* p)         { return _mm_loadu_ps(p); }
+static inline void v4_store(float* p, v4 x)        { _mm_storeu_ps(p, x); }
+static inline v4   v4_load2(const float* p)        { return _mm_castpd_ps(_mm_load_sd((const double*)(const void*)p)); }
+static inline void v4_store2(float* p, v4 x)       { _mm_store_sd((double*)(void*)p, _mm_castps_pd(x)); }
+static inline v4   v4_add(v4 a, v4 b)              { return _mm_add_ps(a, b); }
+static inline v4   v4_sub(v4 a, v4 b)              { return _mm_sub_ps(a, b); }
+static inline v4   v4_mul(v4 a, v4 b)              { return _mm_mul_ps(a, b); }
+static inline v4   v4_max(v4 a, v4 b)              { return _mm_max_ps(a, b); }
+static inline v4   v4_abs(v4 a)                    { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline v4   v4_rev(v4 a)                    { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 1, 2, 3)); }
+static inline float v4_hmax(v4 a) {
+    a = _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+    a = _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(a);
+}
+#elif defined(ENG_DSP_NEON)
+typedef float32x4_t v4;
+static inline v4   v4_set1(float x)                { return vdupq_n_f32(x); }
+static inline v4   v4_setr(float a, float b, float c, float d) {
+    const float t[4] = {a, b, c, d};
+    return vld1q_f32(t);
+}
+static inline v4   v4_load(const float* p)         { return vld1q_f32(p); }
+static inline void v4_store(float* p, v4 x)        { vst1q_f32(p, x); }
+static inline v4   v4_load2(const float* p)        { return vcombine_f32(vld1_f32(p), vdup_n_f32(0.0f)); }
+static inline void v4_store2(float* p, v4 x)       { vst1_f32(p, vget_low_f32(x)); }
+static inline v4   v4_add(v4 a, v4 b)              { return vaddq_f32(a, b); }
+static inline v4   v4_sub(v4 a, v4 b)              { return vsubq_f32(a, b); }
+static inline v4   v4_mul(v4 a, v4 b)              { return vmulq_f32(a, b); }
+static inline v4   v4_max(v4 a, v4 b)              { return vmaxq_f32(a, b); }
+static inline v4   v4_abs(v4 a)                    { return vabsq_f32(a); }
+static inline v4   v4_rev(v4 a) {
+    float32x4_t r = vrev64q_f32(a);
+    return vcombine_f32(vget_high_f32(r), vget_low_f32(r));
+}
+static inline float v4_hmax(v4 a) {
+    float32x2_t m = vpmax_f32(vget_low_f32(a), vget_high_f32(a));
+    m = vpmax_f32(m, m);
+    return vget_lane_f32(m, 0);
+}
+#else
+typedef struct { float f[4]; } v4;
+static inline v4 v4_set1(float x) { v4 r = {{x, x, x, x}}; return r; }
+static inline v4 v4_setr(float a, float b, float c, float d) { v4 r = {{a, b, c, d}}; return r; }
+static inline v4 v4_load(const float* p) { v4 r; memcpy(r.f, p, sizeof(r.f)); return r; }
+static inline void v4_store(float* p, v4 x) { memcpy(p, x.f, sizeof(x.f)); }
+static inline v4 v4_load2(const float* p) { v4 r = {{p[0], p[1], 0.0f, 0.0f}}; return r; }
+static inline void v4_store2(float* p, v4 x) { p[0] = x.f[0]; p[1] = x.f[1]; }
+#define ENG_V4_OP(name, expr) \
+    static inline v4 name(v4 a, v4 b) { v4 r; for (int i = 0; i < 4; ++i) r.f[i] = (expr); return r; }
+ENG_V4_OP(v4_add, a.f[i] + b.f[i])
+ENG_V4_OP(v4_sub, a.f[i] - b.f[i])
+ENG_V4_OP(v4_mul, a.f[i] * b.f[i])
+ENG_V4_OP(v4_max, a.f[i] > b.f[i] ? a.f[i] : b.f[i])
+#undef ENG_V4_OP
+static inline v4 v4_abs(v4 a) { for (int i = 0; i < 4; ++i) a.f[i] = fabsf(a.f[i]); return a; }
+static inline v4 v4_rev(v4 a) { v4 r = {{a.f[3], a.f[2], a.f[1], a.f[0]}}; return r; }
+static inline float v4_hmax(v4 a) {
+    float m = a.f[0];
+    for (int i = 1; i < 4; ++i) if (a.f[i] > m) m = a.f[i];
+    return m;
+}
+#endif
+
+#if defined(ENG_DSP_AVX2)
+typedef __m256 v8;
+static inline v8   v8_set1(float x)          { return _mm256_set1_ps(x); }
+static inline v8   v8_load(const float* p)   { return _mm256_loadu_ps(p); }
+static inline void v8_store(float* p, v8 x)  { _mm256_storeu_ps(p, x); }
+static inline v8   v8_add(v8 a, v8 b)        { return _mm256_add_ps(a, b); }
+static inline v8   v8_sub(v8 a, v8 b)        { return _mm256_sub_ps(a, b); }
+static inline v8   v8_mul(v8 a, v8 b)        { return _mm256_mul_ps(a, b); }
+#  if defined(__FMA__)
+static inline v8   v8_madd(v8 a, v8 b, v8 c) { return _mm256_fmadd_ps(a, b, c); }
+#  else
+static inline v8   v8_madd(v8 a, v8 b, v8 c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#  endif
+#else
+typedef struct { v4 lo, hi; } v8;
+static inline v8   v8_set1(float x)          { v8 r = {v4_set1(x), v4_set1(x)}; return r; }
+static inline v8   v8_load(const float* p)   { v8 r = {v4_load(p), v4_load(p + 4)}; return r; }
+static inline void v8_store(float* p, v8 x)  { v4_store(p, x.lo); v4_store(p + 4, x.hi); }
+static inline v8   v8_add(v8 a, v8 b)        { v8 r = {v4_add(a.lo, b.lo), v4_add(a.hi, b.hi)}; return r; }
+static inline v8   v8_sub(v8 a, v8 b)        { v8 r = {v4_sub(a.lo, b.lo), v4_sub(a.hi, b.hi)}; return r; }
+static inline v8   v8_mul(v8 a, v8 b)        { v8 r = {v4_mul(a.lo, b.lo), v4_mul(a.hi, b.hi)}; return r; }
+static inline v8   v8_madd(v8 a, v8 b, v8 c) { return v8_add(v8_mul(a, b), c); }
+#endif
+
+/* ── 定数 ───────────────────────────────────────────────*/
+#define ENG_DSP_SUBBLOCK   32      /* パラメータ追従と係数更新の単位 (フレーム) */
+#define ENG_DSP_DETECT     16      /* コンプレッサーがゲインを決める単位 (フレーム) */
+#define ENG_DSP_SMOOTH_SEC 0.02f   /* パラメータ追従の時定数 */
+#define ENG_DSP_PI         3.14159265358979f
+
+/* 遅延線の基本長 (ms)。互いに素に近い長さにして共振を散らす */
+static const float k_line_ms[ENG_DSP_REVERB_LINES] = {
+    29.7f, 37.1f, 41.1f, 43.7f, 53.3f, 59.9f, 67.7f, 73.3f,
+};
+
+/* 8x8 アダマール行列 (1/sqrt(8) で正規化)。エネルギーを保ったまま遅延線を混ぜる */
+#define P  0.35355339f
+#define N -0.35355339f
+static const float k_hadamard[ENG_DSP_REVERB_LINES][ENG_DSP_REVERB_LINES] = {
+    {P, P, P, P, P, P, P, P},
+    {P, N, P, N, P, N, P, N},
+    {P, P, N, N, P, P, N, N},
+    {P, N, N, P, P, N, N, P},
+    {P, P, P, P, N, N, N, N},
+    {P, N, P, N, N, P, N, P},
+    {P, P, N, N, N, N, P, P},
+    {P, N, N, P, N, P, P, N},
+};
+#undef P
+#undef N
+
+/* ── パラメータ ─────────────────────────────────────────*/
+float eng_dsp_default(ENG_FxType type, ENG_FxParam param) {
+    switch (param) {
+    case ENG_FX_FREQ:         return type == ENG_FX_HIGHPASS ? 200.0f : 1000.0f;
+    case ENG_FX_Q:            return type == ENG_FX_PEAK ? 1.0f : 0.7071f;
+    case ENG_FX_GAIN_DB:      return 0.0f;
+    case ENG_FX_THRESHOLD_DB: return type == ENG_FX_LIMITER ? -1.0f : -18.0f;
+    case ENG_FX_RATIO:        return 4.0f;
+    case ENG_FX_ATTACK_MS:    return 10.0f;
+    case ENG_FX_RELEASE_MS:   return type == ENG_FX_LIMITER ? 50.0f : 100.0f;
+    case ENG_FX_DECAY:        return 1.5f;
+    case ENG_FX_DAMPING:      return 0.5f;
+    case ENG_FX_WET:          return 0.3f;
+    case ENG_FX_DRY:          return 1.0f;
+    default:                  return 0.0f;
+    }
+}
+
+void eng_dsp_set(EngDsp* d, ENG_FxParam param, float value) {
+    if ((uint32_t)param >= ENG_FX_PARAM_COUNT || !isfinite(value)) return;
+    if (d->target[param] == value) return;
+    d->target[param] = value;
+    d->settled       = false;
+}
+
+/* cur を target へ 1 サブブロック分近づける。全て追いついたら settled。 */
+static void params_step(EngDsp* d) {
+    bool settled = true;
+    for (int i = 0; i < ENG_FX_PARAM_COUNT; ++i) {
+        float diff = d->target[i] - d->cur[i];
+        float tol  = 1e-4f * (fabsf(d->target[i]) > 1.0f ? fabsf(d->target[i]) : 1.0f);
+        if (fabsf(diff) <= tol) {
+            d->cur[i] = d->target[i];
+        } else {
+            d->cur[i] += diff * d->smooth;
+            settled = false;
+        }
+    }
+    d->settled = settled;
+}
+
+/* ── バイクアッド ───────────────────────────────────────*/
+/* RBJ Audio EQ Cookbook の係数を a0 で正規化して求める。 */
+static void biquad_coeffs(EngDsp* d) {
+    float nyq = 0.49f * (float)d->sample_rate;
+    float f   = d->cur[ENG_FX_FREQ];
+    float q   = d->cur[ENG_FX_Q];
+    if (f < 10.0f) f = 10.0f;
+    if (f > nyq)   f = nyq;
+    if (q < 0.1f)  q = 0.1f;
+    float w0    = 2.0f * ENG_DSP_PI * f / (float)d->sample_rate;
+    float cw    = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * q);
+    float b0, b1, b2, a0, a1, a2;
+    switch (d->type) {
+    case ENG_FX_HIGHPASS:
+        b0 = (1.0f + cw) * 0.5f; b1 = -(1.0f + cw); b2 = b0;
+        a0 = 1.0f + alpha;       a1 = -2.0f * cw;   a2 = 1.0f - alpha;
+        break;
+    case ENG_FX_PEAK: {
+        float A = powf(10.0f, d->cur[ENG_FX_GAIN_DB] / 40.0f);
+        b0 = 1.0f + alpha * A; b1 = -2.0f * cw; b2 = 1.0f - alpha * A;
+        a0 = 1.0f + alpha / A; a1 = -2.0f * cw; a2 = 1.0f - alpha / A;
+        break;
+    }
+    default: /* ENG_FX_LOWPASS */
+        b0 = (1.0f - cw) * 0.5f; b1 = 1.0f - cw;  b2 = b0;
+        a0 = 1.0f + alpha;       a1 = -2.0f * cw; a2 = 1.0f - alpha;
+        break;
+    }
+    d->b0 = b0 / a0; d->b1 = b1 / a0; d->b2 = b2 / a0;
+    d->a1 = a1 / a0; d->a2 = a2 / a0;
+}
+
+/*
+ * 時間方向は再帰なので、チャンネルをレーンに載せて並列に回す。
+ * ステレオは 1 フレーム = 2 レーン、4ch は 4 レーン。それ以外はスカラー。
+ */
+static void biquad_run(EngDsp* d, const float* in, float* out, uint32_t frames) {
+    uint32_t ch = d->channels;
+    if (ch == 2 || ch == 4) {
+        v4 b0 = v4_set1(d->b0), b1 = v4_set1(d->b1), b2 = v4_set1(d->b2);
+        v4 a1 = v4_set1(d->a1), a2 = v4_set1(d->a2);
+        float zs1[4] = {0}, zs2[4] = {0};
+        memcpy(zs1, d->z1, ch * sizeof(float));
+        memcpy(zs2, d->z2, ch * sizeof(float));
+        v4 z1 = v4_load(zs1), z2 = v4_load(zs2);
+        for (uint32_t i = 0; i < frames; ++i) {
+            v4 x = ch == 2 ? v4_load2(in + i * 2) : v4_load(in + i * 4);
+            v4 y = v4_add(v4_mul(b0, x), z1);
+            z1 = v4_add(v4_sub(v4_mul(b1, x), v4_mul(a1, y)), z2);
+            z2 = v4_sub(v4_mul(b2, x), v4_mul(a2, y));
+            if (ch == 2) v4_store2(out + i * 2, y); else v4_store(out + i * 4, y);
+        }
+        v4_store(zs1, z1);
+        v4_store(zs2, z2);
+        memcpy(d->z1, zs1, ch * sizeof(float));
+        memcpy(d->z2, zs2, ch * sizeof(float));
+        return;
+    }
+    for (uint32_t c = 0; c < ch; ++c) {
+        float z1 = d->z1[c], z2 = d->z2[c];
+        for (uint32_t i = 0; i < frames; ++i) {
+            float x = in[i * ch + c];
+            float y = d->b0 * x + z1;
+            z1 = d->b1 * x - d->a1 * y + z2;
+            z2 = d->b2 * x - d->a2 * y;
+            out[i * ch + c] = y;
+        }
+        d->z1[c] = z1;
+        d->z2[c] = z2;
+    }
+}
+
+/* ── ゲイン ─────────────────────────────────────────────*/
+/* n 個のサンプルの絶対値の最大。 */
+static float peak_abs(const float* x, uint32_t n) {
+    uint32_t i = 0;
+    float    m = 0.0f;
+    if (n >= 4) {
+        v4 vm = v4_set1(0.0f);
+        for (; i + 4 <= n; i += 4) vm = v4_max(vm, v4_abs(v4_load(x + i)));
+        m = v4_hmax(vm);
+    }
+    for (; i < n; ++i) if (fabsf(x[i]) > m) m = fabsf(x[i]);
+    return m;
+}
+
+/* g0 から g1 へフレーム単位で直線的に変わるゲインを掛ける。 */
+static void gain_ramp(const float* in, float* out, uint32_t frames, uint32_t ch, float g0, float g1) {
+    float    step = (g1 - g0) / (float)frames;
+    uint32_t i    = 0;
+    if (4 % ch == 0) {
+        /* 1 レジスタに 4/ch フレーム載る (1ch=4, 2ch=2, 4ch=1) */
+        uint32_t fpv = 4 / ch;
+        v4 g  = v4_setr(g0 + step * (float)(0 / ch), g0 + step * (float)(1 / ch),
+                        g0 + step * (float)(2 / ch), g0 + step * (float)(3 / ch));
+        v4 dg = v4_set1(step * (float)fpv);
+        for (; i + fpv <= frames; i += fpv) {
+            v4_store(out + i * ch, v4_mul(v4_load(in + i * ch), g));
+            g = v4_add(g, dg);
+        }
+    }
+    for (; i < frames; ++i) {
+        float g = g0 + step * (float)i;
+        for (uint32_t c = 0; c < ch; ++c) out[i * ch + c] = in[i * ch + c] * g;
+    }
+}
+
+/* ── コンプレッサー / リミッター ─────────────────────────*/
+/*
+ * ENG_DSP_DETECT フレームごとにピークを取り、包絡線からゲインを決めて
+ * 区間内で直線補間しながら掛ける。区間のピークを先に見るので、リミッターは
+ * 区間の頭から必要な分だけ下げる (先読み ENG_DSP_DETECT フレーム相当)。
+ */
+static void dynamics_run(EngDsp* d, const float* in, float* out, uint32_t frames) {
+    uint32_t ch      = d->channels;
+    bool     limiter = d->type == ENG_FX_LIMITER;
+    float    rate    = (float)d->sample_rate;
+    float    att_ms  = limiter ? 0.0f : d->cur[ENG_FX_ATTACK_MS];
+    float    att     = att_ms > 0.0f ? 1.0f - expf(-(float)ENG_DSP_DETECT / (att_ms * 0.001f * rate)) : 1.0f;
+    float    rel_ms  = d->cur[ENG_FX_RELEASE_MS] > 1.0f ? d->cur[ENG_FX_RELEASE_MS] : 1.0f;
+    float    rel     = 1.0f - expf(-(float)ENG_DSP_DETECT / (rel_ms * 0.001f * rate));
+    float    slope   = limiter ? 1.0f : 1.0f - 1.0f / (d->cur[ENG_FX_RATIO] > 1.0f ? d->cur[ENG_FX_RATIO] : 1.0f);
+    float    thr     = d->cur[ENG_FX_THRESHOLD_DB];
+    float    makeup  = d->cur[ENG_FX_GAIN_DB];
+    for (uint32_t i = 0; i < frames; i += ENG_DSP_DETECT) {
+        uint32_t n    = frames - i < ENG_DSP_DETECT ? frames - i : ENG_DSP_DETECT;
+        float    peak = peak_abs(in + i * ch, n * ch);
+        d->env += (peak - d->env) * (peak > d->env ? att : rel);
+        float level = 20.0f * log10f(d->env + 1e-9f);
+        float over  = level - thr;
+        float g     = powf(10.0f, (makeup - (over > 0.0f ? over * slope : 0.0f)) / 20.0f);
+        float g0    = d->gain;
+        if (limiter && g < g0) g0 = g; /* 下げるときは区間の頭から */
+        gain_ramp(in + i * ch, out + i * ch, n, ch, g0, g);
+        d->gain = g;
+    }
+}
+
+/* ── リバーブ ───────────────────────────────────────────*/
+static void reverb_feedback(EngDsp* d) {
+    float decay = d->cur[ENG_FX_DECAY] > 0.05f ? d->cur[ENG_FX_DECAY] : 0.05f;
+    for (int i = 0; i < ENG_DSP_REVERB_LINES; ++i)
+        /* 1 周 len サンプルで -60dB * len / (decay * rate) 減衰させる */
+        d->fb[i] = powf(10.0f, -3.0f * (float)d->len[i] / (decay * (float)d->sample_rate));
+}
+
+/*
+ * 8 本の遅延線を 1 レジスタ (v8) に載せ、減衰フィルタ・アダマール混合・
+ * フィードバックをレーン並列で計算する。遅延線の読み書きだけはスカラー。
+ * 入力は全チャンネルの平均、出力は偶数チャンネルに偶数番の線、奇数チャンネルに奇数番の線。
+ */
+static void reverb_run(EngDsp* d, const float* in, float* out, uint32_t frames) {
+    uint32_t ch   = d->channels;
+    float    inv  = 1.0f / (float)ch;
+    float    damp = d->cur[ENG_FX_DAMPING];
+    if (damp < 0.0f) damp = 0.0f;
+    if (damp > 1.0f) damp = 1.0f;
+    float wet = d->cur[ENG_FX_WET], dry = d->cur[ENG_FX_DRY];
+    v8    vc  = v8_set1(1.0f - 0.9f * damp);
+    v8    vfb = v8_load(d->fb);
+    v8    vlp = v8_load(d->lp);
+    v8    col[ENG_DSP_REVERB_LINES];
+    for (int i = 0; i < ENG_DSP_REVERB_LINES; ++i) col[i] = v8_load(k_hadamard[i]);
+    float* base[ENG_DSP_REVERB_LINES];
+    base[0] = d->lines;
+    for (int i = 1; i < ENG_DSP_REVERB_LINES; ++i) base[i] = base[i - 1] + d->len[i - 1];
+
+    float y[ENG_DSP_REVERB_LINES], lp[ENG_DSP_REVERB_LINES], w[ENG_DSP_REVERB_LINES];
+    for (uint32_t f = 0; f < frames; ++f) {
+        const float* x = in + f * ch;
+        float mono = 0.0f;
+        for (uint32_t c = 0; c < ch; ++c) mono += x[c];
+        mono *= inv;
+
+        for (int i = 0; i < ENG_DSP_REVERB_LINES; ++i) y[i] = base[i][d->pos[i]];
+        v8 vy = v8_load(y);
+        /* 高域減衰 (1 次ローパス)。微小値を足してデノーマルを避ける */
+        vlp = v8_madd(vc, v8_sub(vy, vlp), v8_add(vlp, v8_set1(1e-18f)));
+        v8_store(lp, vlp);
+        v8 mix = v8_mul(col[0], v8_set1(lp[0]));
+        for (int i = 1; i < ENG_DSP_REVERB_LINES; ++i) mix = v8_madd(col[i], v8_set1(lp[i]), mix);
+        v8_store(w, v8_madd(mix, vfb, v8_set1(mono)));
+        for (int i = 0; i < ENG_DSP_REVERB_LINES; ++i) {
+            base[i][d->pos[i]] = w[i];
+            if (++d->pos[i] == d->len[i]) d->pos[i] = 0;
+        }
+
+        float even = (y[0] + y[2] + y[4] + y[6]) * 0.25f;
+        float odd  = (y[1] + y[3] + y[5] + y[7]) * 0.25f;
+        float* o   = out + f * ch;
+        if (ch == 1) {
+            o[0] = x[0] * dry + (even + odd) * 0.5f * wet;
+        } else {
+            for (uint32_t c = 0; c < ch; ++c) o[c] = x[c] * dry + ((c & 1) ? odd : even) * wet;
+        }
+    }
+    v8_store(d->lp, vlp);
+}
+
+/* ── 解析 ───────────────────────────────────────────────*/
+#define ENG_DSP_FFT_HALF      ENG_METER_BINS  /* 実数 FFT を解く複素 FFT の長さ */
+#define ENG_DSP_PEAK_FALL_SEC 1.7f            /* ピーク表示が 20dB 下がるまで */
+#define ENG_DSP_RMS_SEC       0.3f
+
+/*
+ * K 特性 (ITU-R BS.1770-4) の係数をレートに合わせて求める。
+ * 高域シェルフとハイパスを双一次変換で作り、48kHz で規格の表と同じ値になる
+ * (ハイパスの分子は規格どおり 1, -2, 1)。
+ */
+static void meter_kweight(EngMeter* m, uint32_t rate) {
+    const double pi = 3.14159265358979323846;
+    double q  = 0.7071752369554196;
+    double k  = tan(pi * 1681.974450955533 / (double)rate);
+    double vh = pow(10.0, 3.999843853973347 / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    m->kb[0][0] = (float)((vh + vb * k / q + k * k) / a0);
+    m->kb[0][1] = (float)(2.0 * (k * k - vh) / a0);
+    m->kb[0][2] = (float)((vh - vb * k / q + k * k) / a0);
+    m->ka[0][0] = (float)(2.0 * (k * k - 1.0) / a0);
+    m->ka[0][1] = (float)((1.0 - k / q + k * k) / a0);
+
+    q  = 0.5003270373238773;
+    k  = tan(pi * 38.13547087602444 / (double)rate);
+    a0 = 1.0 + k / q + k * k;
+    m->kb[1][0] = 1.0f;
+    m->kb[1][1] = -2.0f;
+    m->kb[1][2] = 1.0f;
+    m->ka[1][0] = (float)(2.0 * (k * k - 1.0) / a0);
+    m->ka[1][1] = (float)((1.0 - k / q + k * k) / a0);
+}
+
+/* チャンネルごとのピークと二乗和を足し込む。1/2/4ch は 1 レジスタに整数フレーム載るのでレーン並列。 */
+static void meter_levels_run(EngMeter* m, const float* in, uint32_t frames, uint32_t ch) {
+    uint32_t n = frames * ch, i = 0;
+    if (4 % ch == 0 && n >= 4) {
+        v4 vp = v4_set1(0.0f), vs = v4_set1(0.0f);
+        for (; i + 4 <= n; i += 4) {
+            v4 x = v4_load(in + i);
+            vp = v4_max(vp, v4_abs(x));
+            vs = v4_add(vs, v4_mul(x, x));
+        }
+        float pk[4], sq[4];
+        v4_store(pk, vp);
+        v4_store(sq, vs);
+        for (uint32_t l = 0; l < 4; ++l) {
+            uint32_t c = l % ch;
+            if (pk[l] > m->hop_peak[c]) m->hop_peak[c] = pk[l];
+            m->hop_sq[c] += sq[l];
+        }
+    }
+    for (uint32_t f = i / ch; f < frames; ++f)
+        for (uint32_t c = 0; c < ch; ++c) {
+            float x = in[f * ch + c];
+            if (fabsf(x) > m->hop_peak[c]) m->hop_peak[c] = fabsf(x);
+            m->hop_sq[c] += x * x;
+        }
+}
+
+/*
+ * K 特性を通した二乗の全チャンネル合計。biquad_run と同じく 2/4ch はチャンネルをレーンに載せる。
+ * 入力に符号を毎フレーム反転する微小値を足し、無音でも出力がデノーマルまで減衰しないようにする
+ * (直流だとハイパスで消えてしまう)。
+ */
+static double meter_kweight_run(EngMeter* m, const float* in, uint32_t frames, uint32_t ch) {
+    if (ch == 2 || ch == 4) {
+        /* 2 段の状態をそれぞれ 1 レジスタに置く */
+        float t[4][4] = {{0}};
+        memcpy(t[0], m->kz1[0], ch * sizeof(float));
+        memcpy(t[1], m->kz2[0], ch * sizeof(float));
+        memcpy(t[2], m->kz1[1], ch * sizeof(float));
+        memcpy(t[3], m->kz2[1], ch * sizeof(float));
+        v4 p1 = v4_load(t[0]), p2 = v4_load(t[1]), h1 = v4_load(t[2]), h2 = v4_load(t[3]);
+        v4 pb0 = v4_set1(m->kb[0][0]), pb1 = v4_set1(m->kb[0][1]), pb2 = v4_set1(m->kb[0][2]);
+        v4 pa1 = v4_set1(m->ka[0][0]), pa2 = v4_set1(m->ka[0][1]);
+        v4 ha1 = v4_set1(m->ka[1][0]), ha2 = v4_set1(m->ka[1][1]), two = v4_set1(2.0f);
+        v4 tiny = v4_set1(1e-15f), zero = v4_set1(0.0f), acc = zero;
+        for (uint32_t i = 0; i < frames; ++i) {
+            v4 x = v4_add(ch == 2 ? v4_load2(in + i * 2) : v4_load(in + i * 4), tiny);
+            tiny = v4_sub(zero, tiny);
+            v4 y = v4_add(v4_mul(pb0, x), p1);
+            p1 = v4_add(v4_sub(v4_mul(pb1, x), v4_mul(pa1, y)), p2);
+            p2 = v4_sub(v4_mul(pb2, x), v4_mul(pa2, y));
+            /* ハイパスの分子は 1, -2, 1 */
+            v4 z = v4_add(y, h1);
+            h1 = v4_add(v4_sub(v4_sub(zero, v4_mul(two, y)), v4_mul(ha1, z)), h2);
+            h2 = v4_sub(y, v4_mul(ha2, z));
+            acc = v4_add(acc, v4_mul(z, z));
+        }
+        v4_store(t[0], p1);
+        v4_store(t[1], p2);
+        v4_store(t[2], h1);
+        v4_store(t[3], h2);
+        memcpy(m->kz1[0], t[0], ch * sizeof(float));
+        memcpy(m->kz2[0], t[1], ch * sizeof(float));
+        memcpy(m->kz1[1], t[2], ch * sizeof(float));
+        memcpy(m->kz2[1], t[3], ch * sizeof(float));
+        float sq[4];
+        v4_store(sq, acc);
+        return (double)sq[0] + sq[1] + sq[2] + sq[3];
+    }
+    double sum = 0.0;
+    for (uint32_t c = 0; c < ch; ++c) {
+        float acc = 0.0f, tiny = 1e-15f;
+        for (uint32_t i = 0; i < frames; ++i) {
+            float x = in[i * ch + c] + tiny;
+            tiny = -tiny;
+            for (int s = 0; s < 2; ++s) {
+                float y = m->kb[s][0] * x + m->kz1[s][c];
+                m->kz1[s][c] = m->kb[s][1] * x - m->ka[s][0] * y + m->kz2[s][c];
+                m->kz2[s][c] = m->kb[s][2] * x - m->ka[s][1] * y;
+                x = y;
+            }
+            acc += x * x;
+        }
+        sum += acc;
+    }
+    return sum;
+}
+
+/* 全チャンネルの平均を FFT 用のリングに積む。 */
+static void meter_feed(EngMeter* m, const float* in, uint32_t frames, uint32_t ch) {
+    float inv = 1.0f / (float)ch;
+    for (uint32_t f = 0; f < frames; ++f) {
+        float sum = 0.0f;
+        for (uint32_t c = 0; c < ch; ++c) sum += in[f * ch + c];
+        m->ring[m->ring_pos] = sum * inv;
+        m->ring_pos = (m->ring_pos + 1) & (ENG_METER_FFT_SIZE - 1);
+    }
+}
+
+/*
+ * 複素 FFT (基数 2 の時間間引き)。入力はビット反転順に並べておく。
+ * 実部と虚部を別の配列に持ち、バタフライの半分が 4 以上の段は 4 本ずつレーン並列で回す。
+ */
+static void fft_run(EngMeter* m) {
+    float* re = m->re;
+    float* im = m->im;
+    for (uint32_t half = 1; half < ENG_DSP_FFT_HALF; half <<= 1) {
+        const float* wr = m->tw_re + half - 1;
+        const float* wi = m->tw_im + half - 1;
+        for (uint32_t s = 0; s < ENG_DSP_FFT_HALF; s += half * 2) {
+            float* ar = re + s;
+            float* ai = im + s;
+            float* br = ar + half;
+            float* bi = ai + half;
+            uint32_t j = 0;
+            for (; half >= 4 && j < half; j += 4) {
+                v4 xr = v4_load(br + j), xi = v4_load(bi + j);
+                v4 cr = v4_load(wr + j), ci = v4_load(wi + j);
+                v4 tr = v4_sub(v4_mul(xr, cr), v4_mul(xi, ci));
+                v4 ti = v4_add(v4_mul(xr, ci), v4_mul(xi, cr));
+                v4 ur = v4_load(ar + j), ui = v4_load(ai + j);
+                v4_store(br + j, v4_sub(ur, tr));
+                v4_store(bi + j, v4_sub(ui, ti));
+                v4_store(ar + j, v4_add(ur, tr));
+                v4_store(ai + j, v4_add(ui, ti));
+            }
+            for (; j < half; ++j) {
+                float tr = br[j] * wr[j] - bi[j] * wi[j];
+                float ti = br[j] * wi[j] + bi[j] * wr[j];
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+    }
+}
+
+static void window_mul(float* out, const float* x, const float* w, uint32_t n) {
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) v4_store(out + i, v4_mul(v4_load(x + i), v4_load(w + i)));
+    for (; i < n; ++i) out[i] = x[i] * w[i];
+}
+
+/*
+ * 直近 ENG_METER_FFT_SIZE フレームに窓を掛けて FFT し、power を更新する。
+ * 偶数番を実部・奇数番を虚部にした半分の長さの複素 FFT を解き、実数入力の結果に直す。
+ */
+static void meter_spectrum(EngMeter* m) {
+    const uint32_t N = ENG_METER_FFT_SIZE, M = ENG_DSP_FFT_HALF;
+    /* リングは ring_pos が最も古い。2 区間に分けて窓を掛ける */
+    uint32_t head = N - m->ring_pos;
+    window_mul(m->frame, m->ring + m->ring_pos, m->window, head);
+    window_mul(m->frame + head, m->ring, m->window + head, m->ring_pos);
+
+    for (uint32_t k = 0; k < M; ++k) {
+        m->re[m->bitrev[k]] = m->frame[2 * k];
+        m->im[m->bitrev[k]] = m->frame[2 * k + 1];
+    }
+    fft_run(m);
+
+    /*
+     * Z[k] と Z[M-k] の共役から偶数列・奇数列の成分を取り出して合わせる。M-k 側は逆順に読む。
+     * 振幅 1 の正弦波が 1 になるよう、ハン窓の和 (N/2) の半分で割った振幅の二乗にする。
+     */
+    const float scale = (4.0f / (float)N) * (4.0f / (float)N);
+    float dc = m->re[0] + m->im[0];
+    m->power[0] = dc * dc * scale;
+    uint32_t k = 1;
+    v4 half = v4_set1(0.5f), vs = v4_set1(scale);
+    for (; k + 4 <= M; k += 4) {
+        v4 zr = v4_load(m->re + k), zi = v4_load(m->im + k);
+        v4 cr = v4_rev(v4_load(m->re + M - k - 3)), ci = v4_rev(v4_load(m->im + M - k - 3));
+        v4 er  = v4_mul(half, v4_add(zr, cr)), ei = v4_mul(half, v4_sub(zi, ci));
+        v4 orr = v4_mul(half, v4_add(zi, ci)), oi = v4_mul(half, v4_sub(cr, zr));
+        v4 wr = v4_load(m->post_re + k), wi = v4_load(m->post_im + k);
+        v4 xr = v4_add(er, v4_sub(v4_mul(wr, orr), v4_mul(wi, oi)));
+        v4 xi = v4_add(ei, v4_add(v4_mul(wr, oi), v4_mul(wi, orr)));
+        v4_store(m->power + k, v4_mul(v4_add(v4_mul(xr, xr), v4_mul(xi, xi)), vs));
+    }
+    for (; k < M; ++k) {
+        float zr = m->re[k], zi = m->im[k];
+        float cr = m->re[M - k], ci = m->im[M - k];
+        float er = 0.5f * (zr + cr), ei = 0.5f * (zi - ci);
+        float orr = 0.5f * (zi + ci), oi = 0.5f * (cr - zr);
+        float wr = m->post_re[k], wi = m->post_im[k];
+        float xr = er + wr * orr - wi * oi;
+        float xi = ei + wr * oi + wi * orr;
+        m->power[k] = (xr * xr + xi * xi) * scale;
+    }
+}
+
+static void meter_slice(EngMeter* m) {
+    m->slices[m->slice_pos] = (float)(m->slice_sq / (double)m->slice_len);
+    m->slice_pos  = (m->slice_pos + 1) % ENG_DSP_LOUD_SLICES;
+    m->slice_sq   = 0.0;
+    m->slice_left = m->slice_len;
+}
+
+static void meter_hop(EngMeter* m, uint32_t ch) {
+    for (uint32_t c = 0; c < ch; ++c) {
+        float p = m->hop_peak[c], fall = m->peak[c] * m->peak_fall;
+        m->peak[c] = p > fall ? p : fall;
+        if (p > m->peak_max[c]) m->peak_max[c] = p;
+        m->ms[c] += ((float)(m->hop_sq[c] / (double)ENG_METER_HOP) - m->ms[c]) * m->ms_coef;
+        m->hop_peak[c] = 0.0f;
+        m->hop_sq[c]   = 0.0;
+    }
+    meter_spectrum(m);
+    m->hop_left = ENG_METER_HOP;
+    m->updates++;
+}
+
+/* ホップとラウドネスの区切りで分けながら測る。 */
+static void meter_run(EngDsp* d, const float* in, uint32_t frames) {
+    EngMeter* m  = d->meter;
+    uint32_t  ch = d->channels;
+    m->frames += frames;
+    while (frames > 0) {
+        uint32_t n = frames;
+        if (n > m->hop_left)   n = m->hop_left;
+        if (n > m->slice_left) n = m->slice_left;
+        meter_levels_run(m, in, n, ch);
+        m->slice_sq += meter_kweight_run(m, in, n, ch);
+        meter_feed(m, in, n, ch);
+        if ((m->slice_left -= n) == 0) meter_slice(m);
+        if ((m->hop_left -= n) == 0)   meter_hop(m, ch);
+        in     += (size_t)n * ch;
+        frames -= n;
+    }
+}
+
+static bool meter_init(EngDsp* d) {
+    const uint32_t N = ENG_METER_FFT_SIZE, M = ENG_DSP_FFT_HALF;
+    EngMeter* m = calloc(1, sizeof(EngMeter));
+    if (!m) return false;
+    d->meter  = m;
+    m->block  = calloc((size_t)N * 3 + (size_t)M * 7, sizeof(float));
+    m->bitrev = malloc(sizeof(uint32_t) * M);
+    if (!m->block || !m->bitrev) return false;
+    m->ring    = m->block;
+    m->window  = m->ring + N;
+    m->frame   = m->window + N;
+    m->re      = m->frame + N;
+    m->im      = m->re + M;
+    m->tw_re   = m->im + M;
+    m->tw_im   = m->tw_re + M;
+    m->post_re = m->tw_im + M;
+    m->post_im = m->post_re + M;
+    m->power   = m->post_im + M;
+
+    const double pi = 3.14159265358979323846;
+    for (uint32_t i = 0; i < N; ++i)
+        m->window[i] = (float)(0.5 - 0.5 * cos(2.0 * pi * (double)i / (double)N));
+    for (uint32_t half = 1; half < M; half <<= 1)
+        for (uint32_t j = 0; j < half; ++j) {
+            m->tw_re[half - 1 + j] = (float)cos(pi * (double)j / (double)half);
+            m->tw_im[half - 1 + j] = (float)-sin(pi * (double)j / (double)half);
+        }
+    for (uint32_t k = 0; k < M; ++k) {
+        m->post_re[k] = (float)cos(2.0 * pi * (double)k / (double)N);
+        m->post_im[k] = (float)-sin(2.0 * pi * (double)k / (double)N);
+    }
+    uint32_t bits = 0;
+    while ((1u << bits) < M) ++bits;
+    for (uint32_t k = 0; k < M; ++k) {
+        uint32_t r = 0;
+        for (uint32_t b = 0; b < bits; ++b) r |= ((k >> b) & 1u) << (bits - 1 - b);
+        m->bitrev[k] = r;
+    }
+
+    float rate = (float)d->sample_rate;
+    meter_kweight(m, d->sample_rate);
+    m->peak_fall  = powf(10.0f, -(float)ENG_METER_HOP / (ENG_DSP_PEAK_FALL_SEC * rate));
+    m->ms_coef    = 1.0f - expf(-(float)ENG_METER_HOP / (ENG_DSP_RMS_SEC * rate));
+    m->hop_left   = ENG_METER_HOP;
+    m->slice_len  = d->sample_rate / 10 > 0 ? d->sample_rate / 10 : 1;
+    m->slice_left = m->slice_len;
+    return true;
+}
+
+/* パワーを dB に (ENG_METER_FLOOR_DB で下を切る)。 */
+static float meter_db(double power) {
+    float db = power > 0.0 ? (float)(10.0 * log10(power)) : ENG_METER_FLOOR_DB;
+    return db > ENG_METER_FLOOR_DB ? db : ENG_METER_FLOOR_DB;
+}
+
+/* 直近 count 区切りの平均から求めた LUFS。 */
+static float meter_lufs(const EngMeter* m, uint32_t count) {
+    double sum = 0.0;
+    for (uint32_t i = 1; i <= count; ++i)
+        sum += m->slices[(m->slice_pos + ENG_DSP_LOUD_SLICES - i) % ENG_DSP_LOUD_SLICES];
+    return meter_db(sum / (double)count * 0.852897); /* -0.691dB */
+}
+
+/* ── 公開関数 ───────────────────────────────────────────*/
+bool eng_dsp_init(EngDsp* d, ENG_FxType type, uint32_t channels, uint32_t sample_rate) {
+    memset(d, 0, sizeof(*d));
+    if ((uint32_t)type >= ENG_FX_TYPE_COUNT || channels == 0 || sample_rate == 0) return false;
+    d->type        = type;
+    d->channels    = channels;
+    d->sample_rate = sample_rate;
+    d->bypass      = channels > ENG_DSP_MAX_CHANNELS;
+    d->smooth      = 1.0f - expf(-(float)ENG_DSP_SUBBLOCK / (ENG_DSP_SMOOTH_SEC * (float)sample_rate));
+    d->gain        = 1.0f;
+    for (int i = 0; i < ENG_FX_PARAM_COUNT; ++i)
+        d->target[i] = d->cur[i] = eng_dsp_default(type, (ENG_FxParam)i);
+    d->settled = true;
+
+    if (type == ENG_FX_REVERB) {
+        size_t total = 0;
+        for (int i = 0; i < ENG_DSP_REVERB_LINES; ++i) {
+            d->len[i] = (uint32_t)(k_line_ms[i] * 0.001f * (float)sample_rate) | 1u;
+            total += d->len[i];
+        }
+        d->lines = calloc(total, sizeof(float));
+        if (!d->lines) return false;
+        reverb_feedback(d);
+    } else if (type == ENG_FX_METER) {
+        if (!meter_init(d)) return false;
+    } else if (type != ENG_FX_COMPRESSOR && type != ENG_FX_LIMITER) {
+        biquad_coeffs(d);
+    }
+    return true;
+}
+
+void eng_dsp_uninit(EngDsp* d) {
+    free(d->lines);
+    d->lines = NULL;
+    if (d->meter) {
+        free(d->meter->block);
+        free(d->meter->bitrev);
+        free(d->meter);
+        d->meter = NULL;
+    }
+}
+
+void eng_dsp_process(EngDsp* d, const float* in, float* out, uint32_t frames) {
+    if (d->bypass) {
+        if (in != out) memcpy(out, in, (size_t)frames * d->channels * sizeof(float));
+        return;
+    }
+    if (d->type == ENG_FX_METER) {
+        if (in != out) memcpy(out, in, (size_t)frames * d->channels * sizeof(float));
+        meter_run(d, in, frames);
+        return;
+    }
+    uint32_t ch = d->channels;
+    for (uint32_t i = 0; i < frames; i += ENG_DSP_SUBBLOCK) {
+        uint32_t n = frames - i < ENG_DSP_SUBBLOCK ? frames - i : ENG_DSP_SUBBLOCK;
+        if (!d->settled) {
+            params_step(d);
+            if (d->type == ENG_FX_REVERB) reverb_feedback(d);
+            else if (d->type <= ENG_FX_PEAK) biquad_coeffs(d);
+        }
+        const float* x = in + (size_t)i * ch;
+        float*       y = out + (size_t)i * ch;
+        switch (d->type) {
+        case ENG_FX_COMPRESSOR:
+        case ENG_FX_LIMITER: dynamics_run(d, x, y, n); break;
+        case ENG_FX_REVERB:  reverb_run(d, x, y, n);   break;
+        default:             biquad_run(d, x, y, n);   break;
+        }
+    }
+}
+
+uint32_t eng_dsp_meter_updates(const EngDsp* d) {
+    return d->meter ? d->meter->updates : 0;
+}
+
+void eng_dsp_meter_levels(const EngDsp* d, ENG_MeterLevels* out) {
+    memset(out, 0, sizeof(*out));
+    for (int c = 0; c < ENG_METER_MAX_CHANNELS; ++c)
+        out->peak_db[c] = out->peak_max_db[c] = out->rms_db[c] = ENG_METER_FLOOR_DB;
+    out->lufs_momentary = out->lufs_short = ENG_METER_FLOOR_DB;
+    const EngMeter* m = d->meter;
+    if (!m || d->bypass) return;
+    out->channels = d->channels;
+    for (uint32_t c = 0; c < d->channels; ++c) {
+        out->peak_db[c]     = meter_db((double)m->peak[c] * m->peak[c]);
+        out->peak_max_db[c] = meter_db((double)m->peak_max[c] * m->peak_max[c]);
+        out->rms_db[c]      = meter_db(m->ms[c]);
+    }
+    out->lufs_momentary = meter_lufs(m, 4);
+    out->lufs_short     = meter_lufs(m, ENG_DSP_LOUD_SLICES);
+    out->frames         = m->frames;
+}
+
+const float* eng_dsp_meter_power(const EngDsp* d) {
+    return d->meter ? d->meter->power : NULL;
+}
+
+void eng_dsp_meter_reset(EngDsp* d) {
+    EngMeter* m = d->meter;
+    if (!m) return;
+    memset(m->peak_max, 0, sizeof(m->peak_max));
+    memset(m->slices, 0, sizeof(m->slices));
+}
@@ -0,0 +1,116 @@
+/**
+ * src/eng_dsp.h — インサートエフェクトと解析の DSP カーネル (内部用)
+ *
+ * miniaudio には依存しない。eng_audio.c がノードグラフのノードとして包む。
+ * 入出力はインターリーブ f32。パラメータは目標値を渡すだけで、
+ * 32 フレームごとに約 20ms の時定数で追従する (ジッパーノイズ防止)。
+ *
+ * SIMD はコンパイル時に選ぶ: AVX2 (-mavx2) / SSE2 / NEON / スカラー。
+ *
+ * Copyright (c) 2026 Reo Shiozawa — MIT License
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "eng_audio.h"
+
+#define ENG_DSP_MAX_CHANNELS 8  /* これを超えるチャンネル数ではそのまま通す */
+#define ENG_DSP_REVERB_LINES 8  /* FDN の遅延線の数 (AVX2 の 1 レジスタ分) */
+#define ENG_DSP_LOUD_SLICES  30 /* ラウドネスの履歴 (100ms × 30 = 短期の 3 秒) */
+
+/* 解析 (ENG_FX_METER) の状態。オーディオスレッドだけが触る */
+typedef struct {
+    /* K 特性: 高域シェルフ → ハイパスの 2 段。状態は [段][ch] */
+    float kb[2][3], ka[2][2];
+    float kz1[2][ENG_DSP_MAX_CHANNELS];
+    float kz2[2][ENG_DSP_MAX_CHANNELS];
+
+    /* ピーク・RMS (ホップごとに更新) */
+    float  hop_peak[ENG_DSP_MAX_CHANNELS];
+    double hop_sq[ENG_DSP_MAX_CHANNELS];
+    float  peak[ENG_DSP_MAX_CHANNELS];
+    float  peak_max[ENG_DSP_MAX_CHANNELS];
+    float  ms[ENG_DSP_MAX_CHANNELS];  /* 二乗平均の指数平均 */
+    float  peak_fall;                 /* ホップごとにピークへ掛ける減衰 */
+    float  ms_coef;                   /* ホップごとの追従係数 */
+    uint32_t hop_left;
+
+    /* ラウドネス (100ms ごとの K 特性の二乗平均) */
+    double   slice_sq;
+    uint32_t slice_len;
+    uint32_t slice_left;
+    float    slices[ENG_DSP_LOUD_SLICES];
+    uint32_t slice_pos;
+
+    /* スペクトル。FFT は実数入力を半分の長さの複素 FFT で解く */
+    float*    block;      /* 以下の配列をまとめて確保した先頭 */
+    float*    ring;       /* 直近 ENG_METER_FFT_SIZE フレームのモノラル */
+    float*    window;
+    float*    frame;      /* 窓を掛けた直近のフレーム (ENG_METER_FFT_SIZE) */
+    float*    re;         /* 作業領域 (ENG_METER_BINS) */
+    float*    im;
+    float*    tw_re;      /* 段ごとのひねり係数を並べたもの */
+    float*    tw_im;
+    float*    post_re;    /* 実数化の係数 exp(-2πik/N) */
+    float*    post_im;
+    float*    power;      /* ビンごとのパワー (振幅 1 の正弦波で約 1) */
+    uint32_t* bitrev;
+    uint32_t  ring_pos;
+
+    uint64_t frames;
+    uint32_t updates;     /* ホップを終えるたびに進む */
+} EngMeter;
+
+typedef struct {
+    ENG_FxType type;
+    uint32_t   channels;
+    uint32_t   sample_rate;
+    float      target[ENG_FX_PARAM_COUNT];
+    float      cur[ENG_FX_PARAM_COUNT];
+    float      smooth;       /* サブブロックごとの追従係数 */
+    bool       settled;      /* cur が target に追いついている */
+    bool       bypass;       /* 対応外のチャンネル数 */
+
+    /* バイクアッド (TDF-II)。状態はチャンネルごと */
+    float b0, b1, b2, a1, a2;
+    float z1[ENG_DSP_MAX_CHANNELS];
+    float z2[ENG_DSP_MAX_CHANNELS];
+
+    /* コンプレッサー / リミッター */
+    float env;               /* ピークの包絡線 (リニア) */
+    float gain;              /* 直前に掛けたゲイン */
+
+    /* リバーブ (8 本の遅延線のフィードバック遅延ネットワーク) */
+    float*   lines;
+    uint32_t len[ENG_DSP_REVERB_LINES];
+    uint32_t pos[ENG_DSP_REVERB_LINES];
+    float    lp[ENG_DSP_REVERB_LINES];   /* 遅延線ごとの高域減衰フィルタの状態 */
+    float    fb[ENG_DSP_REVERB_LINES];   /* 残響時間から求めたフィードバック量 */
+
+    EngMeter* meter;                     /* ENG_FX_METER のみ */
+} EngDsp;
+
+/** 初期化。リバーブは遅延線、解析は FFT の作業領域を確保する。失敗時は false。 */
+bool  eng_dsp_init(EngDsp* d, ENG_FxType type, uint32_t channels, uint32_t sample_rate);
+void  eng_dsp_uninit(EngDsp* d);
+
+/** パラメータの既定値。 */
+float eng_dsp_default(ENG_FxType type, ENG_FxParam param);
+
+/** 目標値を設定する。値は次の process から滑らかに反映される。 */
+void  eng_dsp_set(EngDsp* d, ENG_FxParam param, float value);
+
+/** frames フレームを処理する。in と out は同じバッファでもよい。 */
+void  eng_dsp_process(EngDsp* d, const float* in, float* out, uint32_t frames);
+
+/** 解析: 結果が更新された回数。変わっていたら levels / power を読み直す。 */
+uint32_t eng_dsp_meter_updates(const EngDsp* d);
+
+/** 解析: 今の測定値。 */
+void  eng_dsp_meter_levels(const EngDsp* d, ENG_MeterLevels* out);
+
+/** 解析: 最新のスペクトルのパワー (ENG_METER_BINS 個)。 */
+const float* eng_dsp_meter_power(const EngDsp* d);
+
+/** 解析: 最大ピークとラウドネスの履歴を消す。 */
+void  eng_dsp_meter_reset(EngDsp* d);
@@ -5,6 +5,7 @@
  */
 #include "hajimu_plugin.h"
 #include "eng_audio.h"
+#include <string.h>
 
 static ENG_Audio* g_a = NULL;
 
@@ -12,19 +13,117 @@ static ENG_Audio* g_a = NULL;
 #define ARG_NUM(i) ((i) < argc && args[(i)].type == VALUE_NUMBER ? args[(i)].number : 0.0)
 #define ARG_STR(i) ((i) < argc && args[(i)].type == VALUE_STRING  ? args[(i)].string.data : "")
 #define ARG_INT(i) ((int)ARG_NUM(i))
+#define ARG_U64(i) ((uint64_t)(ARG_NUM(i) > 0.0 ? ARG_NUM(i) : 0.0))
 #define ARG_F(i)   ((float)ARG_NUM(i))
 #define ARG_B(i)   ((i) < argc && args[(i)].type == VALUE_BOOL ? args[(i)].boolean : false)
 #define NUM(v)     hajimu_number((double)(v))
 #define BVAL(v)    hajimu_bool((bool)(v))
 #define NUL        hajimu_null()
 
+/* 省略可能な読込先バス (0=BGM 1=SE 2=ボイス 3=UI) */
+static ENG_LoadParams load_params(int argc, Value* args, int i, ENG_Bus def, uint32_t flags) {
+    ENG_LoadParams p;
+    memset(&p, 0, sizeof(p));
+    p.bus   = i < argc ? (ENG_Bus)ARG_INT(i) : def;
+    p.flags = flags;
+    return p;
+}
+
 /* ── ライフサイクル ─────────────────────────────────────*/
+/*
+ * 音声初期化([サンプルレート, チャンネル数, 周期ミリ秒, 周期数, バックエンド, 排他, 読込スレッド数, 非同期])
+ * 省略または 0 の項目はデバイス既定。非同期=真 でデバイスを待たずに戻る (開くのは裏のスレッド)。
+ */
 static Value fn_音声初期化(int argc, Value* args) {
-    (void)argc; (void)args;
     if (g_a) { eng_audio_destroy(g_a); g_a = NULL; }
-    g_a = eng_audio_create();
+    ENG_AudioConfig cfg = eng_audio_config_default();
+    cfg.sample_rate = (uint32_t)ARG_INT(0);
+    cfg.channels    = (uint32_t)ARG_INT(1);
+    cfg.period_ms   = (uint32_t)ARG_INT(2);
+    cfg.periods     = (uint32_t)ARG_INT(3);
+    cfg.backend     = ARG_STR(4);
+    cfg.exclusive   = ARG_B(5);
+    cfg.loader_threads = (uint32_t)ARG_INT(6);
+    cfg.async_device   = ARG_B(7);
+    g_a = eng_audio_create_ex(&cfg);
     return NUM(g_a ? 0 : -1);
 }
+static Value fn_音声遅延取得(int argc, Value* args) {
+    (void)argc; (void)args;
+    return NUM(eng_audio_latency_ms(g_a));
+}
+static Value fn_音声時刻取得(int argc, Value* args) {
+    (void)argc; (void)args;
+    return NUM(eng_audio_time_frames(g_a));
+}
+static Value fn_音声サンプルレート取得(int argc, Value* args) {
+    (void)argc; (void)args;
+    return NUM(eng_audio_sample_rate(g_a));
+}
+static Value fn_読込進捗取得(int argc, Value* args) {
+    (void)argc; (void)args;
+    return NUM(eng_audio_load_progress(g_a));
+}
+static Value fn_読込待機(int argc, Value* args) { (void)argc; (void)args; eng_audio_wait_loads(g_a); return NUL; }
+static Value fn_音声一括開始(int argc, Value* args) { (void)argc; (void)args; eng_audio_batch_begin(g_a); return NUL; }
+static Value fn_音声一括終了(int argc, Value* args) { (void)argc; (void)args; eng_audio_batch_end(g_a); return NUL; }
+/*
+ * 音声統計取得(項目) — "回数" "最小" "平均" "p99" "最大" (ミックス時間、マイクロ秒)
+ * "負荷" "最大負荷" "xrun" "発音数" "最大発音数" "仮想発音数" "無音停止" "ストリーム停滞" "ジョブ"
+ */
+static Value fn_音声統計取得(int argc, Value* args) {
+    ENG_AudioStats st;
+    eng_audio_get_stats(g_a, &st);
+    const char* k = ARG_STR(0);
+    if (strcmp(k, "回数") == 0)           return NUM(st.callbacks);
+    if (strcmp(k, "最小") == 0)           return NUM(st.mix_min_us);
+    if (strcmp(k, "平均") == 0)           return NUM(st.mix_avg_us);
+    if (strcmp(k, "p99") == 0)            return NUM(st.mix_p99_us);
+    if (strcmp(k, "最大") == 0)           return NUM(st.mix_max_us);
+    if (strcmp(k, "負荷") == 0)           return NUM(st.load);
+    if (strcmp(k, "最大負荷") == 0)       return NUM(st.load_peak);
+    if (strcmp(k, "xrun") == 0)           return NUM(st.xruns);
+    if (strcmp(k, "発音数") == 0)         return NUM(st.voices);
+    if (strcmp(k, "最大発音数") == 0)     return NUM(st.voices_peak);
+    if (strcmp(k, "仮想発音数") == 0)     return NUM(st.voices_virtual);
+    if (strcmp(k, "無音停止") == 0)       return NUM(st.voices_culled);
+    if (strcmp(k, "ストリーム停滞") == 0) return NUM(st.stream_stalls);
+    if (strcmp(k, "ジョブ") == 0)         return NUM(st.jobs_pending);
+    return NUL;
+}
+static Value fn_音声統計リセット(int argc, Value* args) { (void)argc; (void)args; eng_audio_reset_stats(g_a); return NUL; }
+/* 録音開始(パス[, 16bit]) — 最終出力を WAV に書く。16bit=真 で 16bit 整数 (既定は 32bit float) */
+static Value fn_録音開始(int argc, Value* args) {
+    ENG_RecordParams p;
+    memset(&p, 0, sizeof(p));
+    p.pcm16 = ARG_B(1);
+    return BVAL(eng_audio_record_start_ex(g_a, ARG_STR(0), &p));
+}
+static Value fn_録音停止(int argc, Value* args) { (void)argc; (void)args; return BVAL(eng_audio_record_stop(g_a)); }
+/* 録音情報取得(項目) — "録音中" "書込" "欠落" (フレーム) "バッファ" "最大使用" (フレーム) */
+static Value fn_録音情報取得(int argc, Value* args) {
+    ENG_RecordStats st;
+    eng_audio_get_record_stats(g_a, &st);
+    const char* k = ARG_STR(0);
+    if (strcmp(k, "録音中") == 0)   return BVAL(st.recording);
+    if (strcmp(k, "書込") == 0)     return NUM(st.frames_written);
+    if (strcmp(k, "欠落") == 0)     return NUM(st.frames_dropped);
+    if (strcmp(k, "バッファ") == 0) return NUM(st.buffer_frames);
+    if (strcmp(k, "最大使用") == 0) return NUM(st.buffer_peak);
+    return NUL;
+}
+/* 音声デバイス状態取得() — 0: なし 1: 開いている途中 2: 再生中 3: 失って開き直し待ち */
+static Value fn_音声デバイス状態取得(int argc, Value* args) {
+    (void)argc; (void)args;
+    return NUM(eng_audio_device_state(g_a));
+}
+/* 音声デバイス待機([ミリ秒]) — デバイスが再生を始めるまで待つ (省略時 2000)。戻り値: 再生中か */
+static Value fn_音声デバイス待機(int argc, Value* args) {
+    uint32_t ms = argc > 0 ? (uint32_t)ARG_INT(0) : 2000;
+    return BVAL(eng_audio_wait_device(g_a, ms));
+}
+/* 音声デバイス再接続() — 今の既定の再生デバイスで開き直す (裏のスレッドで行う) */
+static Value fn_音声デバイス再接続(int argc, Value* args) { (void)argc; (void)args; return BVAL(eng_audio_reopen_device(g_a)); }
 static Value fn_音声終了(int argc, Value* args) {
     (void)argc; (void)args;
     if (g_a) { eng_audio_destroy(g_a); g_a = NULL; }
@@ -32,7 +131,10 @@ static Value fn_音声終了(int argc, Value* args) {
 }
 
 /* ── BGM ────────────────────────────────────────────────*/
-static Value fn_音楽読込(int argc, Value* args)        { return NUM(eng_bgm_load(g_a, ARG_STR(0))); }
+static Value fn_音楽読込(int argc, Value* args) {
+    ENG_LoadParams p = load_params(argc, args, 1, ENG_BUS_BGM, 0);
+    return NUM(eng_bgm_load_ex(g_a, ARG_STR(0), &p));
+}
 static Value fn_音楽再生(int argc, Value* args)        { eng_bgm_play(g_a, ARG_INT(0)); return NUL; }
 static Value fn_音楽停止(int argc, Value* args)        { eng_bgm_stop(g_a, ARG_INT(0)); return NUL; }
 static Value fn_音楽一時停止(int argc, Value* args)    { eng_bgm_pause(g_a, ARG_INT(0)); return NUL; }
@@ -44,17 +146,183 @@ static Value fn_音楽位置取得(int argc, Value* args)    { return NUM(eng_bg
 static Value fn_音楽再生中(int argc, Value* args)      { return BVAL(eng_bgm_is_playing(g_a, ARG_INT(0))); }
 static Value fn_音楽削除(int argc, Value* args)        { eng_bgm_free(g_a, ARG_INT(0)); return NUL; }
 static Value fn_音楽ピッチ設定(int argc, Value* args)  { eng_bgm_set_pitch(g_a, ARG_INT(0), ARG_F(1)); return NUL; }
+static Value fn_音楽非同期読込(int argc, Value* args) {
+    ENG_LoadParams p = load_params(argc, args, 1, ENG_BUS_BGM, ENG_LOAD_FLAG_ASYNC);
+    return NUM(eng_bgm_load_ex(g_a, ARG_STR(0), &p));
+}
+static Value fn_音楽読込状態(int argc, Value* args)    { return NUM(eng_bgm_load_state(g_a, ARG_INT(0), NULL)); }
+static Value fn_音楽予約再生(int argc, Value* args)    { eng_bgm_play_at(g_a, ARG_INT(0), ARG_U64(1)); return NUL; }
+static Value fn_音楽予約停止(int argc, Value* args)    { eng_bgm_stop_at(g_a, ARG_INT(0), ARG_U64(1)); return NUL; }
+/* 音楽ループ区間設定(id, 開始, 終了) — ファイルのサンプルレートでのフレーム。終了 0 = 曲末 */
+static Value fn_音楽ループ区間設定(int argc, Value* args) {
+    return BVAL(eng_bgm_set_loop_points(g_a, ARG_INT(0), ARG_U64(1), ARG_U64(2)));
+}
+/* 音楽キュー追加(id, パス[, ループ]) — 今の曲が終わったら途切れずに続けて鳴らす */
+static Value fn_音楽キュー追加(int argc, Value* args) {
+    return BVAL(eng_bgm_queue(g_a, ARG_INT(0), ARG_STR(1), ARG_B(2)));
+}
+static Value fn_音楽キュー中(int argc, Value* args)    { return BVAL(eng_bgm_is_queued(g_a, ARG_INT(0))); }
+
+/* ── バンク ─────────────────────────────────────────────*/
+static Value fn_バンク読込(int argc, Value* args)      { return NUM(eng_bank_load(g_a, ARG_STR(0))); }
+static Value fn_バンク解放(int argc, Value* args)      { return BVAL(eng_bank_unload(g_a, (ENG_BankID)ARG_INT(0))); }
+
+/* ── デコードキャッシュ ─────────────────────────────────*/
+/* キャッシュ上限設定(メガバイト) — 未使用の SE データを残しておく上限 */
+static Value fn_キャッシュ上限設定(int argc, Value* args) {
+    eng_audio_set_cache_budget(g_a, (uint64_t)(ARG_NUM(0) > 0.0 ? ARG_NUM(0) * 1024.0 * 1024.0 : 0.0));
+    return NUL;
+}
+/*
+ * キャッシュ統計取得(項目) — "ヒット" "ミス" "追い出し" "常駐" "未使用" "件数" "上限"
+ * "圧縮" (常駐のうち圧縮 SE の圧縮データ) "ボイス" (圧縮 SE のボイスの先読み)。バイト数はそのまま
+ */
+static Value fn_キャッシュ統計取得(int argc, Value* args) {
+    ENG_CacheStats st;
+    eng_audio_get_cache_stats(g_a, &st);
+    const char* k = ARG_STR(0);
+    if (strcmp(k, "ヒット") == 0)   return NUM(st.hits);
+    if (strcmp(k, "ミス") == 0)     return NUM(st.misses);
+    if (strcmp(k, "追い出し") == 0) return NUM(st.evictions);
+    if (strcmp(k, "常駐") == 0)     return NUM(st.resident_bytes);
+    if (strcmp(k, "未使用") == 0)   return NUM(st.unused_bytes);
+    if (strcmp(k, "件数") == 0)     return NUM(st.entries);
+    if (strcmp(k, "上限") == 0)     return NUM(st.budget);
+    if (strcmp(k, "圧縮") == 0)     return NUM(st.encoded_bytes);
+    if (strcmp(k, "ボイス") == 0)   return NUM(st.voice_bytes);
+    return NUL;
+}
 
 /* ── SE ─────────────────────────────────────────────────*/
-static Value fn_SE読込(int argc, Value* args)          { return NUM(eng_se_load(g_a, ARG_STR(0))); }
+static Value fn_SE読込(int argc, Value* args) {
+    ENG_LoadParams p = load_params(argc, args, 1, ENG_BUS_SE, 0);
+    return NUM(eng_se_load_ex(g_a, ARG_STR(0), &p));
+}
+static Value fn_SE非同期読込(int argc, Value* args) {
+    ENG_LoadParams p = load_params(argc, args, 1, ENG_BUS_SE, ENG_LOAD_FLAG_ASYNC);
+    return NUM(eng_se_load_ex(g_a, ARG_STR(0), &p));
+}
+/* SE圧縮読込(パス[, 先読みミリ秒[, バス]]) — 圧縮したまま持ち、発音ごとにデコードする */
+static Value fn_SE圧縮読込(int argc, Value* args) {
+    ENG_LoadParams p = load_params(argc, args, 2, ENG_BUS_SE, ENG_LOAD_FLAG_COMPRESSED);
+    p.decode_ahead_ms = (uint32_t)(ARG_INT(1) > 0 ? ARG_INT(1) : 0);
+    return NUM(eng_se_load_ex(g_a, ARG_STR(0), &p));
+}
+/* SEメモリ取得(ID, 項目) — "圧縮" "デコード済み" "ボイス" "全デコード時" (バイト数) */
+static Value fn_SEメモリ取得(int argc, Value* args) {
+    ENG_SoundMemory m;
+    if (!eng_se_get_memory(g_a, ARG_INT(0), &m)) return NUL;
+    const char* k = ARG_STR(1);
+    if (strcmp(k, "圧縮") == 0)         return NUM(m.encoded_bytes);
+    if (strcmp(k, "デコード済み") == 0) return NUM(m.decoded_bytes);
+    if (strcmp(k, "ボイス") == 0)       return NUM(m.voice_bytes);
+    if (strcmp(k, "全デコード時") == 0) return NUM(m.full_bytes);
+    return NUL;
+}
+static Value fn_SE読込状態(int argc, Value* args)      { return NUM(eng_se_load_state(g_a, ARG_INT(0), NULL)); }
 static Value fn_SE再生(int argc, Value* args)          { eng_se_play(g_a, ARG_INT(0)); return NUL; }
 static Value fn_SE再生音量(int argc, Value* args)      { eng_se_play_vol(g_a, ARG_INT(0), ARG_F(1)); return NUL; }
+static Value fn_SE予約再生(int argc, Value* args)      { eng_se_play_at(g_a, ARG_INT(0), ARG_U64(1)); return NUL; }
 static Value fn_SE停止(int argc, Value* args)          { eng_se_stop(g_a, ARG_INT(0)); return NUL; }
 static Value fn_SE音量設定(int argc, Value* args)      { eng_se_set_volume(g_a, ARG_INT(0), ARG_F(1)); return NUL; }
 static Value fn_SEピッチ設定(int argc, Value* args)    { eng_se_set_pitch(g_a, ARG_INT(0), ARG_F(1)); return NUL; }
 static Value fn_SEループ設定(int argc, Value* args)    { eng_se_set_loop(g_a, ARG_INT(0), ARG_B(1)); return NUL; }
 static Value fn_SE再生確認(int argc, Value* args)      { return BVAL(eng_se_is_playing(g_a, ARG_INT(0))); }
 static Value fn_SE削除(int argc, Value* args)          { eng_se_free(g_a, ARG_INT(0)); return NUL; }
+static Value fn_SE同時発音数設定(int argc, Value* args) {
+    return BVAL(eng_se_set_voices(g_a, ARG_INT(0), (uint32_t)ARG_INT(1), (ENG_StealMode)ARG_INT(2)));
+}
+static Value fn_SE優先度設定(int argc, Value* args)    { eng_se_set_priority(g_a, ARG_INT(0), ARG_INT(1)); return NUL; }
+/* SEリサンプル品質設定(ID, ローパス次数 0〜8) — 負の値は既定に戻す */
+static Value fn_SEリサンプル品質設定(int argc, Value* args) {
+    int order = ARG_INT(1);
+    return BVAL(eng_se_set_resample(g_a, ARG_INT(0), order < 0 ? ENG_RESAMPLE_DEFAULT : ENG_RESAMPLE_ORDER(order)));
+}
+
+/* ── ミキサーバス ───────────────────────────────────────*/
+static Value fn_バス音量設定(int argc, Value* args) { eng_bus_set_volume(g_a, (ENG_Bus)ARG_INT(0), ARG_F(1)); return NUL; }
+static Value fn_バス音量取得(int argc, Value* args) { return NUM(eng_bus_get_volume(g_a, (ENG_Bus)ARG_INT(0))); }
+static Value fn_バスパン設定(int argc, Value* args) { eng_bus_set_pan(g_a, (ENG_Bus)ARG_INT(0), ARG_F(1)); return NUL; }
+static Value fn_バスフェード(int argc, Value* args) { eng_bus_fade(g_a, (ENG_Bus)ARG_INT(0), ARG_F(1), ARG_F(2)); return NUL; }
+static Value fn_バスミュート(int argc, Value* args) { eng_bus_set_mute(g_a, (ENG_Bus)ARG_INT(0), ARG_B(1)); return NUL; }
+static Value fn_バスミュート中(int argc, Value* args) { return BVAL(eng_bus_is_muted(g_a, (ENG_Bus)ARG_INT(0))); }
+
+/* ── インサートエフェクト ───────────────────────────────*/
+/* エフェクト作成(種類) — "ローパス" "ハイパス" "ピーク" "コンプレッサー" "リミッター" "リバーブ" "解析" */
+static Value fn_エフェクト作成(int argc, Value* args) {
+    static const char* names[ENG_FX_TYPE_COUNT] = {
+        "ローパス", "ハイパス", "ピーク", "コンプレッサー", "リミッター", "リバーブ", "解析",
+    };
+    const char* k = ARG_STR(0);
+    for (int i = 0; i < ENG_FX_TYPE_COUNT; ++i)
+        if (strcmp(k, names[i]) == 0) return NUM(eng_fx_create(g_a, (ENG_FxType)i));
+    return NUM(0);
+}
+/*
+ * エフェクト設定(id, 項目, 値) — "周波数" "Q" "ゲイン" (dB) "しきい値" (dB) "比率"
+ * "アタック" "リリース" (ミリ秒) "残響時間" (秒) "減衰" "ウェット" "ドライ"
+ */
+static Value fn_エフェクト設定(int argc, Value* args) {
+    static const char* names[ENG_FX_PARAM_COUNT] = {
+        "周波数", "Q", "ゲイン", "しきい値", "比率", "アタック", "リリース",
+        "残響時間", "減衰", "ウェット", "ドライ",
+    };
+    const char* k = ARG_STR(1);
+    for (int i = 0; i < ENG_FX_PARAM_COUNT; ++i)
+        if (strcmp(k, names[i]) == 0)
+            return BVAL(eng_fx_set_param(g_a, (ENG_FxID)ARG_INT(0), (ENG_FxParam)i, ARG_F(2)));
+    return BVAL(false);
+}
+static Value fn_エフェクト削除(int argc, Value* args)     { eng_fx_free(g_a, (ENG_FxID)ARG_INT(0)); return NUL; }
+static Value fn_エフェクトバス接続(int argc, Value* args) { return BVAL(eng_fx_attach_bus(g_a, (ENG_FxID)ARG_INT(0), (ENG_Bus)ARG_INT(1))); }
+static Value fn_エフェクト音楽接続(int argc, Value* args) { return BVAL(eng_fx_attach_bgm(g_a, (ENG_FxID)ARG_INT(0), ARG_INT(1))); }
+static Value fn_エフェクトSE接続(int argc, Value* args)   { return BVAL(eng_fx_attach_se(g_a, (ENG_FxID)ARG_INT(0), ARG_INT(1))); }
+static Value fn_エフェクト切断(int argc, Value* args)     { eng_fx_detach(g_a, (ENG_FxID)ARG_INT(0)); return NUL; }
+static Value fn_エフェクトマスター接続(int argc, Value* args) { return BVAL(eng_fx_attach_master(g_a, (ENG_FxID)ARG_INT(0))); }
+
+/*
+ * 解析の結果はメーター更新で 1 回分を写し、メーター取得・スペクトル取得はその写しから読む
+ * (同じフレームの値がそろう)。
+ */
+static ENG_MeterLevels g_meter;
+static float           g_spectrum[ENG_METER_BINS];
+static uint32_t        g_spectrum_count;
+
+/* メーター更新(id[, 帯域数]) — 帯域数は省略時 32 (ENG_METER_BINS 以上で FFT のビンそのまま) */
+static Value fn_メーター更新(int argc, Value* args) {
+    ENG_FxID id    = (ENG_FxID)ARG_INT(0);
+    uint32_t bands = argc > 1 && ARG_INT(1) > 0 ? (uint32_t)ARG_INT(1) : 32;
+    if (!eng_fx_get_meter(g_a, id, &g_meter)) return BVAL(false);
+    g_spectrum_count = eng_fx_get_spectrum(g_a, id, g_spectrum, bands);
+    return BVAL(true);
+}
+/*
+ * メーター取得(項目[, チャンネル]) — "ピーク" "最大ピーク" "RMS" (dBFS。チャンネル省略時は最大のもの)
+ * "LUFS瞬時" "LUFS短期" "帯域数"
+ */
+static Value fn_メーター取得(int argc, Value* args) {
+    const char* k = ARG_STR(0);
+    if (strcmp(k, "LUFS瞬時") == 0) return NUM(g_meter.lufs_momentary);
+    if (strcmp(k, "LUFS短期") == 0) return NUM(g_meter.lufs_short);
+    if (strcmp(k, "帯域数") == 0)   return NUM(g_spectrum_count);
+    const float* v = strcmp(k, "ピーク") == 0     ? g_meter.peak_db
+                   : strcmp(k, "最大ピーク") == 0 ? g_meter.peak_max_db
+                   : strcmp(k, "RMS") == 0        ? g_meter.rms_db : NULL;
+    if (!v) return NUL;
+    if (argc > 1) {
+        int c = ARG_INT(1);
+        return c >= 0 && (uint32_t)c < g_meter.channels ? NUM(v[c]) : NUL;
+    }
+    float m = ENG_METER_FLOOR_DB;
+    for (uint32_t c = 0; c < g_meter.channels; ++c) if (v[c] > m) m = v[c];
+    return NUM(m);
+}
+/* スペクトル取得(帯域) — dBFS */
+static Value fn_スペクトル取得(int argc, Value* args) {
+    int i = ARG_INT(0);
+    return i >= 0 && (uint32_t)i < g_spectrum_count ? NUM(g_spectrum[i]) : NUL;
+}
+static Value fn_メーターリセット(int argc, Value* args) { eng_fx_reset_meter(g_a, (ENG_FxID)ARG_INT(0)); return NUL; }
 
 /* ── グローバル ─────────────────────────────────────────*/
 static Value fn_主音量設定(int argc, Value* args) {
@@ -64,19 +332,72 @@ static Value fn_主音量取得(int argc, Value* args) {
     (void)argc; (void)args;
     return NUM(eng_audio_get_master_volume(g_a));
 }
+/* 無音停止設定(しきい値[, ミリ秒]) — 0 で無効 */
+static Value fn_無音停止設定(int argc, Value* args) {
+    eng_audio_set_cull(g_a, ARG_F(0), (uint32_t)ARG_INT(1));
+    return NUL;
+}
+/* 発音上限設定(数) — 実際に鳴らす SE ボイスの数。0 で無制限 */
+static Value fn_発音上限設定(int argc, Value* args) {
+    return BVAL(eng_audio_set_voice_budget(g_a, (uint32_t)ARG_INT(0)));
+}
 static Value fn_SE長さ取得(int argc, Value* args) {
     return NUM(eng_se_duration(g_a, ARG_INT(0)));
 }
 
 /* ── フェード ────────────────────────────────────────────*/
 static Value fn_音楽フェードイン(int argc, Value* args)  { eng_bgm_fade_in(g_a, ARG_INT(0), ARG_F(1)); return NUL; }
-static Value fn_音楽フェードアウト(int argc, Value* args){ eng_bgm_fade_out(g_a, ARG_INT(0), ARG_F(1)); return NUL; }
-static Value fn_音楽クロスフェード(int argc, Value* args){ eng_bgm_crossfade(g_a, ARG_INT(0), ARG_INT(1), ARG_F(2)); return NUL; }
+/* 終了動作: 0=鳴らし続ける 1=停止 2=一時停止 3=解放 */
+static Value fn_音楽フェードアウト(int argc, Value* args){
+    eng_bgm_fade_out_ex(g_a, ARG_INT(0), ARG_F(1), (ENG_FadeEnd)ARG_INT(2));
+    return NUL;
+}
+static Value fn_音楽クロスフェード(int argc, Value* args){
+    eng_bgm_crossfade_ex(g_a, ARG_INT(0), ARG_INT(1), ARG_F(2), (ENG_FadeEnd)ARG_INT(3));
+    return NUL;
+}
 
 /* ── パン ────────────────────────────────────────────────*/
 static Value fn_音楽パン設定(int argc, Value* args) { eng_bgm_set_pan(g_a, ARG_INT(0), ARG_F(1)); return NUL; }
 static Value fn_SEパン設定(int argc, Value* args)   { eng_se_set_pan(g_a, ARG_INT(0), ARG_F(1)); return NUL; }
 
+/* ── 3D 定位 ────────────────────────────────────────────*/
+/*
+ * SE空間設定(id, 項目, 値) / 音楽空間設定 — "有効" "減衰" (0=なし 1=逆数 2=線形 3=指数)
+ * "最小距離" "最大距離" "ロールオフ" "内角" "外角" (度) "外側音量" "ドップラー"
+ */
+static int spatial_param(const char* k) {
+    static const char* names[ENG_SPATIAL_PARAM_COUNT] = {
+        "有効", "減衰", "最小距離", "最大距離", "ロールオフ", "内角", "外角", "外側音量", "ドップラー",
+    };
+    for (int i = 0; i < ENG_SPATIAL_PARAM_COUNT; ++i)
+        if (strcmp(k, names[i]) == 0) return i;
+    return -1;
+}
+static Value fn_聴取者座標設定(int argc, Value* args) { eng_audio_set_listener_position(g_a, ARG_F(0), ARG_F(1), ARG_F(2)); return NUL; }
+static Value fn_聴取者速度設定(int argc, Value* args) { eng_audio_set_listener_velocity(g_a, ARG_F(0), ARG_F(1), ARG_F(2)); return NUL; }
+/* 聴取者向き設定(前x, 前y, 前z[, 上x, 上y, 上z]) */
+static Value fn_聴取者向き設定(int argc, Value* args) {
+    eng_audio_set_listener_direction(g_a, ARG_F(0), ARG_F(1), ARG_F(2));
+    if (argc >= 6) eng_audio_set_listener_up(g_a, ARG_F(3), ARG_F(4), ARG_F(5));
+    return NUL;
+}
+/* 空間LOD設定(距離) — これより遠い SE は簡易定位。0 で切り替えない */
+static Value fn_空間LOD設定(int argc, Value* args) { eng_audio_set_spatial_lod(g_a, ARG_F(0)); return NUL; }
+static Value fn_SE座標設定(int argc, Value* args) { eng_se_set_position(g_a, ARG_INT(0), ARG_F(1), ARG_F(2), ARG_F(3)); return NUL; }
+static Value fn_SE速度設定(int argc, Value* args) { eng_se_set_velocity(g_a, ARG_INT(0), ARG_F(1), ARG_F(2), ARG_F(3)); return NUL; }
+static Value fn_SE向き設定(int argc, Value* args) { eng_se_set_direction(g_a, ARG_INT(0), ARG_F(1), ARG_F(2), ARG_F(3)); return NUL; }
+static Value fn_SE空間設定(int argc, Value* args) {
+    int p = spatial_param(ARG_STR(1));
+    return BVAL(p >= 0 && eng_se_set_spatial(g_a, ARG_INT(0), (ENG_SpatialParam)p, ARG_F(2)));
+}
+static Value fn_音楽座標設定(int argc, Value* args) { eng_bgm_set_position(g_a, ARG_INT(0), ARG_F(1), ARG_F(2), ARG_F(3)); return NUL; }
+static Value fn_音楽速度設定(int argc, Value* args) { eng_bgm_set_velocity(g_a, ARG_INT(0), ARG_F(1), ARG_F(2), ARG_F(3)); return NUL; }
+static Value fn_音楽空間設定(int argc, Value* args) {
+    int p = spatial_param(ARG_STR(1));
+    return BVAL(p >= 0 && eng_bgm_set_spatial(g_a, ARG_INT(0), (ENG_SpatialParam)p, ARG_F(2)));
+}
+
 /* ── 長さ ────────────────────────────────────────────────*/
 static Value fn_音楽長さ取得(int argc, Value* args) { return NUM(eng_bgm_duration(g_a, ARG_INT(0))); }
 
@@ -85,10 +406,25 @@ static Value fn_音楽長さ取得(int argc, Value* args) { return NUM(eng_bgm_d
 
 static HajimuPluginFunc funcs[] = {
     /* ライフサイクル */
-    FN(音声初期化, 0, 0),
+    FN(音声初期化, 0, 8),
     FN(音声終了,   0, 0),
+    FN(音声遅延取得, 0, 0),
+    FN(音声時刻取得, 0, 0),
+    FN(音声サンプルレート取得, 0, 0),
+    FN(読込進捗取得, 0, 0),
+    FN(読込待機,   0, 0),
+    FN(音声一括開始, 0, 0),
+    FN(音声一括終了, 0, 0),
+    FN(音声統計取得, 1, 1),
+    FN(音声統計リセット, 0, 0),
+    FN(録音開始, 1, 2),
+    FN(録音停止, 0, 0),
+    FN(録音情報取得, 1, 1),
+    FN(音声デバイス状態取得, 0, 0),
+    FN(音声デバイス待機, 0, 1),
+    FN(音声デバイス再接続, 0, 0),
     /* BGM */
-    FN(音楽読込,     1, 1),
+    FN(音楽読込,     1, 2),
     FN(音楽再生,     1, 1),
     FN(音楽停止,     1, 1),
     FN(音楽一時停止, 1, 1),
@@ -100,26 +436,81 @@ static HajimuPluginFunc funcs[] = {
     FN(音楽再生中,   1, 1),
     FN(音楽削除,     1, 1),
     FN(音楽ピッチ設定, 2, 2),
+    FN(音楽非同期読込, 1, 2),
+    FN(音楽読込状態, 1, 1),
+    FN(音楽予約再生, 2, 2),
+    FN(音楽予約停止, 2, 2),
+    FN(音楽ループ区間設定, 3, 3),
+    FN(音楽キュー追加, 2, 3),
+    FN(音楽キュー中, 1, 1),
+    /* バンク */
+    FN(バンク読込, 1, 1),
+    FN(バンク解放, 1, 1),
+    /* デコードキャッシュ */
+    FN(キャッシュ上限設定, 1, 1),
+    FN(キャッシュ統計取得, 1, 1),
     /* SE */
-    FN(SE読込,    1, 1),
+    FN(SE読込,    1, 2),
+    FN(SE非同期読込, 1, 2),
+    FN(SE圧縮読込, 1, 3),
+    FN(SEメモリ取得, 2, 2),
+    FN(SE読込状態, 1, 1),
     FN(SE再生,    1, 1),
     FN(SE再生音量, 2, 2),
+    FN(SE予約再生, 2, 2),
     FN(SE停止,    1, 1),
     FN(SE音量設定, 2, 2),
     FN(SEピッチ設定, 2, 2),
     FN(SEループ設定, 2, 2),
     FN(SE再生確認, 1, 1),
     FN(SE削除,    1, 1),
+    FN(SE同時発音数設定, 2, 3),
+    FN(SE優先度設定, 2, 2),
+    FN(SEリサンプル品質設定, 2, 2),
     /* グローバル */
     FN(主音量設定, 1, 1),
     FN(主音量取得, 0, 0),
+    /* ミキサーバス */
+    FN(バス音量設定, 2, 2),
+    FN(バス音量取得, 1, 1),
+    FN(バスパン設定, 2, 2),
+    FN(バスフェード, 3, 3),
+    FN(バスミュート, 2, 2),
+    FN(バスミュート中, 1, 1),
+    /* インサートエフェクト */
+    FN(エフェクト作成, 1, 1),
+    FN(エフェクト設定, 3, 3),
+    FN(エフェクト削除, 1, 1),
+    FN(エフェクトバス接続, 2, 2),
+    FN(エフェクト音楽接続, 2, 2),
+    FN(エフェクトSE接続, 2, 2),
+    FN(エフェクト切断, 1, 1),
+    FN(エフェクトマスター接続, 1, 1),
+    FN(メーター更新, 1, 2),
+    FN(メーター取得, 1, 2),
+    FN(スペクトル取得, 1, 1),
+    FN(メーターリセット, 1, 1),
+    FN(無音停止設定, 1, 2),
+    FN(発音上限設定, 1, 1),
     /* フェード */
     FN(音楽フェードイン,  2, 2),
-    FN(音楽フェードアウト, 2, 2),
-    FN(音楽クロスフェード, 3, 3),
+    FN(音楽フェードアウト, 2, 3),
+    FN(音楽クロスフェード, 3, 4),
     /* パン */
     FN(音楽パン設定, 2, 2),
     FN(SEパン設定,   2, 2),
+    /* 3D 定位 */
+    FN(聴取者座標設定, 3, 3),
+    FN(聴取者向き設定, 3, 6),
+    FN(聴取者速度設定, 3, 3),
+    FN(空間LOD設定,   1, 1),
+    FN(SE座標設定,    4, 4),
+    FN(SE速度設定,    4, 4),
+    FN(SE向き設定,    4, 4),
+    FN(SE空間設定,    3, 3),
+    FN(音楽座標設定,  4, 4),
+    FN(音楽速度設定,  4, 4),
+    FN(音楽空間設定,  3, 3),
     /* 長さ */
     FN(音楽長さ取得, 1, 1),
     FN(SE長さ取得,   1, 1),
@@ -130,7 +521,7 @@ HAJIMU_PLUGIN_EXPORT HajimuPluginInfo* hajimu_plugin_init(void) {
         .name           = "engine_audio",
         .version        = "1.3.0",
         .author         = "Reo Shiozawa",
-        .description    = "はじむ用オーディオエンジン (miniaudio BGM/SE/フェード/クロスフェード/パン/ピッチ/ループ)",
+        .description    = "はじむ用オーディオエンジン (miniaudio BGM/SE/フェード/クロスフェード/パン/3D 定位/ピッチ/ループ)",
         .functions      = funcs,
         .function_count = sizeof(funcs) / sizeof(funcs[0]),
     };
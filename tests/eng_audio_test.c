@@ -0,0 +1,350 @@
+/**
+ * tests/eng_audio_test.c — ヘッドレスのレンダリングによる回帰テスト
+ *
+ * 正弦波の素材を書き出し、フェード・クロスフェード・パン・ピッチ・ループ・曲の予約・簡易定位の各場面を
+ * eng_audio_render で描いて、50ms ごとの要約を tests/golden/ の期待値と比べる。
+ *
+ *   eng_audio_test <golden ディレクトリ> [--update]
+ *
+ * 要約はチャンネルごとの RMS と、差分 (x[n] - x[n-1]) の RMS。後者は周波数で
+ * 大きさが変わるので、ピッチや曲の取り違えも拾える。SIMD やコンパイラの違いで
+ * 出る端数は許し、聞いて分かる違い (-60dB 程度) から落とす。
+ * 各場面は 2 回描いてビット単位で一致することも確かめる (ヘッドレスは決定的)。
+ * --update は期待値を書き直す (挙動を意図して変えたときだけ使う)。
+ *
+ * Copyright (c) 2026 Reo Shiozawa — MIT License
+ */
+#include "eng_test_util.h"
+
+#define RATE       48000
+#define CHANNELS   2
+#define WINDOW     2400      /* 要約の単位 (50ms) */
+#define MAX_FRAMES (RATE * 2)
+#define TOLERANCE  1e-3      /* 要約の値の許容差 (振幅 1 に対して) */
+
+#define TONE_500   "eng_audio_test_500.wav"  /* 1 秒、500Hz */
+#define TONE_1000  "eng_audio_test_1000.wav" /* 1 秒、1000Hz */
+#define TONE_LOOP  "eng_audio_test_loop.wav" /* 0.5 秒の 300Hz の後に 1 秒の 600Hz */
+
+typedef struct {
+    const char* name;
+    uint32_t    frames;
+    /* 場面を組み、frames フレームを out に描く。失敗時は 0 */
+    int (*run)(ENG_Audio* a, float* out, uint32_t frames);
+} TestCase;
+
+/* 振幅 0.5 の正弦波。frames を超えた分は freq2 にする。 */
+typedef struct {
+    uint32_t frames;
+    double   freq, freq2;
+} Tone;
+
+static double tone_wave(uint32_t i, uint32_t ch, void* user) {
+    const Tone* t = (const Tone*)user;
+    (void)ch;
+    return 0.5 * sin(ENG_TEST_TAU * (i < t->frames ? t->freq : t->freq2) * (double)i / RATE);
+}
+
+/* モノラル 16bit の WAV を書き出す。frames を超えた分は freq2 の正弦波にする。 */
+static int write_tone(const char* path, uint32_t frames, double freq, uint32_t frames2, double freq2) {
+    Tone t = { frames, freq, freq2 };
+    return eng_test_write_wav(path, RATE, 1, frames + frames2, false, tone_wave, &t);
+}
+
+/* frames を step ずつ描く。途中で操作を挟む場面用。 */
+static void render(ENG_Audio* a, float* out, uint32_t* at, uint32_t frames) {
+    *at += (uint32_t)eng_audio_render(a, out + (size_t)*at * CHANNELS, frames);
+}
+
+/* end フレームで終わる窓の ch の RMS と差分 RMS。 */
+static void window_rms(const float* out, uint32_t end, uint32_t ch, double* rms, double* drms) {
+    double sq = 0.0, dsq = 0.0;
+    for (uint32_t i = end - WINDOW; i < end; ++i) {
+        double x = out[(size_t)i * CHANNELS + ch], d = x - out[(size_t)(i - 1) * CHANNELS + ch];
+        sq  += x * x;
+        dsq += d * d;
+    }
+    *rms  = sqrt(sq / WINDOW);
+    *drms = sqrt(dsq / WINDOW);
+}
+
+/*
+ * end フレームで終わる窓の ch0 が freq の正弦波らしいか。差分 RMS / RMS は
+ * 2 sin(π f / RATE) になるので、その ±10% に収まり、かつ無音でないことを見る。
+ */
+static int window_is_tone(const float* out, uint32_t end, double freq) {
+    double rms, drms;
+    window_rms(out, end, 0, &rms, &drms);
+    if (rms < 0.03) return 0;
+    double want = 2.0 * sin(3.141592653589793 * freq / RATE);
+    return fabs(drms / rms - want) < want * 0.1;
+}
+
+static int window_is_silent(const float* out, uint32_t end) {
+    double rms, drms;
+    window_rms(out, end, 0, &rms, &drms);
+    return rms < 1e-4;
+}
+
+/* ── 場面 ───────────────────────────────────────────────*/
+static int case_fade_in(ENG_Audio* a, float* out, uint32_t frames) {
+    ENG_SoundID bgm = eng_bgm_load(a, TONE_500);
+    if (!bgm) return 0;
+    eng_bgm_set_loop(a, bgm, true);
+    eng_bgm_play(a, bgm);
+    eng_bgm_fade_in(a, bgm, 0.5f);
+    uint32_t at = 0;
+    render(a, out, &at, frames);
+    return at == frames;
+}
+
+static int case_fade_out(ENG_Audio* a, float* out, uint32_t frames) {
+    ENG_SoundID bgm = eng_bgm_load(a, TONE_500);
+    if (!bgm) return 0;
+    eng_bgm_set_loop(a, bgm, true);
+    eng_bgm_play(a, bgm);
+    uint32_t at = 0;
+    render(a, out, &at, RATE / 4);
+    eng_bgm_fade_out_ex(a, bgm, 0.5f, ENG_FADE_STOP);
+    render(a, out, &at, frames - at);
+    return at == frames && !eng_bgm_is_playing(a, bgm);
+}
+
+static int case_crossfade(ENG_Audio* a, float* out, uint32_t frames) {
+    ENG_SoundID from = eng_bgm_load(a, TONE_500);
+    ENG_SoundID to   = eng_bgm_load(a, TONE_1000);
+    if (!from || !to) return 0;
+    eng_bgm_set_loop(a, from, true);
+    eng_bgm_set_loop(a, to, true);
+    eng_bgm_play(a, from);
+    uint32_t at = 0;
+    render(a, out, &at, RATE / 4);
+    eng_bgm_crossfade_ex(a, from, to, 0.5f, ENG_FADE_STOP);
+    render(a, out, &at, frames - at);
+    return at == frames && !eng_bgm_is_playing(a, from) && eng_bgm_is_playing(a, to)
+        && window_is_tone(out, frames, 1000.0); /* 入ってくる曲が実際に聞こえている */
+}
+
+static int case_pan(ENG_Audio* a, float* out, uint32_t frames) {
+    ENG_SoundID se = eng_se_load(a, TONE_500);
+    if (!se) return 0;
+    eng_se_set_loop(a, se, true);
+    eng_se_set_pan(a, se, -0.5f);
+    eng_se_play(a, se);
+    uint32_t at = 0;
+    render(a, out, &at, frames / 2);
+    eng_se_set_pan(a, se, 1.0f);
+    render(a, out, &at, frames - at);
+    return at == frames;
+}
+
+static int case_pitch(ENG_Audio* a, float* out, uint32_t frames) {
+    ENG_SoundID se = eng_se_load(a, TONE_500);
+    if (!se) return 0;
+    eng_se_set_loop(a, se, true);
+    eng_se_set_pitch(a, se, 1.5f);
+    eng_se_play(a, se);
+    uint32_t at = 0;
+    render(a, out, &at, frames / 2);
+    eng_se_set_pitch(a, se, 0.75f);
+    render(a, out, &at, frames - at);
+    return at == frames;
+}
+
+/* 300Hz の頭を 1 回鳴らした後、600Hz の区間だけを繰り返すはず (区間は 1 秒以上にする決まり) */
+static int case_loop(ENG_Audio* a, float* out, uint32_t frames) {
+    ENG_SoundID bgm = eng_bgm_load(a, TONE_LOOP);
+    if (!bgm) return 0;
+    eng_bgm_set_loop(a, bgm, true);
+    if (!eng_bgm_set_loop_points(a, bgm, RATE / 2, RATE * 3 / 2)) return 0;
+    eng_bgm_play(a, bgm);
+    uint32_t at = 0;
+    render(a, out, &at, frames);
+    return at == frames && eng_bgm_is_playing(a, bgm);
+}
+
+/* ループを切った 1 秒の曲は 1 秒で終わる (先読みが折り返していても鳴らさない) */
+static int case_no_loop(ENG_Audio* a, float* out, uint32_t frames) {
+    ENG_SoundID bgm = eng_bgm_load(a, TONE_500);
+    if (!bgm) return 0;
+    eng_bgm_set_loop(a, bgm, false);
+    eng_bgm_play(a, bgm);
+    uint32_t at = 0;
+    render(a, out, &at, frames);
+    return at == frames && !eng_bgm_is_playing(a, bgm)
+        && window_is_tone(out, RATE - WINDOW, 500.0) && window_is_silent(out, RATE + 2 * WINDOW)
+        && window_is_silent(out, frames);
+}
+
+/* ループなしの 500Hz の後に予約した 1000Hz が隙間なく続き、2 秒で終わる */
+static int case_queue(ENG_Audio* a, float* out, uint32_t frames) {
+    ENG_SoundID bgm = eng_bgm_load(a, TONE_500);
+    if (!bgm) return 0;
+    eng_bgm_set_loop(a, bgm, false);
+    if (!eng_bgm_queue(a, bgm, TONE_1000, false)) return 0;
+    eng_bgm_play(a, bgm);
+    uint32_t at = 0;
+    render(a, out, &at, frames - WINDOW);
+    int queued = eng_bgm_is_playing(a, bgm) && !eng_bgm_is_queued(a, bgm);
+    render(a, out, &at, WINDOW);
+    return at == frames && queued
+        && window_is_tone(out, RATE - WINDOW, 500.0) && window_is_tone(out, RATE + 2 * WINDOW, 1000.0)
+        && window_is_tone(out, frames - 2 * WINDOW, 1000.0);
+}
+
+/*
+ * 左 5m の SE を 3D で鳴らした後、簡易定位に切り替える。ユーザーのパン (右へ 0.5) も
+ * 重ねたまま、切り替えの前後で左右それぞれの音量が変わらないこと (2% 以内)。
+ */
+static int case_spatial_lod(ENG_Audio* a, float* out, uint32_t frames) {
+    ENG_SoundID se = eng_se_load(a, TONE_500);
+    if (!se) return 0;
+    eng_se_set_loop(a, se, true);
+    eng_se_set_pan(a, se, 0.5f);
+    eng_se_set_position(a, se, -5.0f, 0.0f, 0.0f);
+    eng_audio_set_spatial_lod(a, 10.0f);
+    eng_se_play(a, se);
+    uint32_t at = 0;
+    render(a, out, &at, frames / 2);
+    eng_audio_set_spatial_lod(a, 4.0f);
+    render(a, out, &at, frames - at);
+    int ok = at == frames;
+    for (uint32_t c = 0; c < CHANNELS; ++c) {
+        double full, lod, drms;
+        window_rms(out, frames / 2, c, &full, &drms);
+        window_rms(out, frames, c, &lod, &drms);
+        ok &= full > 0.001 && fabs(lod - full) <= full * 0.02;
+    }
+    return ok;
+}
+
+static const TestCase k_cases[] = {
+    { "fade_in",   RATE,         case_fade_in   },
+    { "fade_out",  RATE,         case_fade_out  },
+    { "crossfade", RATE,         case_crossfade },
+    { "pan",       RATE,         case_pan       },
+    { "pitch",     RATE,         case_pitch     },
+    { "loop",      RATE * 2,     case_loop      },
+    { "no_loop",   RATE * 2,     case_no_loop   },
+    { "queue",     RATE * 2,     case_queue     },
+    { "spatial_lod", RATE,       case_spatial_lod },
+};
+
+/* ── 要約と比較 ─────────────────────────────────────────*/
+/* 窓ごとに [ch0 RMS, ch1 RMS, ch0 差分 RMS, ch1 差分 RMS] を並べる。 */
+static uint32_t summarize(const float* pcm, uint32_t frames, double* sum) {
+    uint32_t windows = frames / WINDOW;
+    for (uint32_t w = 0; w < windows; ++w) {
+        for (uint32_t c = 0; c < CHANNELS; ++c) {
+            double sq = 0.0, dsq = 0.0;
+            for (uint32_t i = w * WINDOW; i < (w + 1) * WINDOW; ++i) {
+                double x    = pcm[(size_t)i * CHANNELS + c];
+                double prev = i > 0 ? pcm[(size_t)(i - 1) * CHANNELS + c] : 0.0;
+                sq  += x * x;
+                dsq += (x - prev) * (x - prev);
+            }
+            sum[w * 4 + c]            = sqrt(sq / WINDOW);
+            sum[w * 4 + CHANNELS + c] = sqrt(dsq / WINDOW);
+        }
+    }
+    return windows;
+}
+
+static int write_golden(const char* path, const double* sum, uint32_t windows) {
+    FILE* f = fopen(path, "w");
+    if (!f) return 0;
+    fprintf(f, "# 50ms ごと: L の RMS, R の RMS, L の差分 RMS, R の差分 RMS\n");
+    for (uint32_t w = 0; w < windows; ++w)
+        fprintf(f, "%.6f %.6f %.6f %.6f\n", sum[w * 4], sum[w * 4 + 1], sum[w * 4 + 2], sum[w * 4 + 3]);
+    return fclose(f) == 0;
+}
+
+/* 期待値と比べ、ずれた窓を報告する。戻り値: 一致したか。 */
+static int check_golden(const char* name, const char* path, const double* sum, uint32_t windows) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "[eng_audio_test] %s: 期待値がない: %s (--update で作る)\n", name, path);
+        return 0;
+    }
+    char     line[256];
+    uint32_t w  = 0;
+    int      ok = 1;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') continue;
+        double e[4];
+        if (sscanf(line, "%lf %lf %lf %lf", &e[0], &e[1], &e[2], &e[3]) != 4) continue;
+        if (w >= windows) { ok = 0; break; }
+        for (int k = 0; k < 4; ++k) {
+            if (fabs(sum[w * 4 + k] - e[k]) > TOLERANCE) {
+                fprintf(stderr, "[eng_audio_test] %s: %u ms 付近の値 %d が %.6f (期待値 %.6f)\n",
+                        name, w * WINDOW * 1000 / RATE, k, sum[w * 4 + k], e[k]);
+                ok = 0;
+            }
+        }
+        ++w;
+    }
+    fclose(f);
+    if (w != windows) {
+        fprintf(stderr, "[eng_audio_test] %s: 窓の数が %u (期待値 %u)\n", name, windows, w);
+        ok = 0;
+    }
+    return ok;
+}
+
+static int render_case(const TestCase* t, float* out) {
+    ENG_AudioConfig cfg = eng_audio_config_default();
+    cfg.no_device   = true;
+    cfg.sample_rate = RATE;
+    cfg.channels    = CHANNELS;
+    ENG_Audio* a = eng_audio_create_ex(&cfg);
+    if (!a) return 0;
+    memset(out, 0, sizeof(float) * (size_t)t->frames * CHANNELS);
+    int ok = t->run(a, out, t->frames);
+    eng_audio_destroy(a);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "使い方: eng_audio_test <golden ディレクトリ> [--update]\n");
+        return 2;
+    }
+    const char* dir    = argv[1];
+    int         update = argc > 2 && strcmp(argv[2], "--update") == 0;
+
+    if (!write_tone(TONE_500, RATE, 500.0, 0, 0.0) || !write_tone(TONE_1000, RATE, 1000.0, 0, 0.0)
+        || !write_tone(TONE_LOOP, RATE / 2, 300.0, RATE, 600.0)) {
+        fprintf(stderr, "[eng_audio_test] 素材を書き出せない\n");
+        return 1;
+    }
+    float*  out   = malloc(sizeof(float) * MAX_FRAMES * CHANNELS);
+    float*  again = malloc(sizeof(float) * MAX_FRAMES * CHANNELS);
+    double* sum   = malloc(sizeof(double) * (MAX_FRAMES / WINDOW) * 4);
+    if (!out || !again || !sum) return 1;
+
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(k_cases) / sizeof(k_cases[0]); ++i) {
+        const TestCase* t = &k_cases[i];
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s.txt", dir, t->name);
+        int ok = render_case(t, out) && render_case(t, again);
+        if (!ok) {
+            fprintf(stderr, "[eng_audio_test] %s: 場面を組めない\n", t->name);
+        } else if (memcmp(out, again, sizeof(float) * (size_t)t->frames * CHANNELS) != 0) {
+            fprintf(stderr, "[eng_audio_test] %s: 2 回の描画が一致しない\n", t->name);
+            ok = 0;
+        } else {
+            uint32_t windows = summarize(out, t->frames, sum);
+            ok = update ? write_golden(path, sum, windows) : check_golden(t->name, path, sum, windows);
+        }
+        printf("%-10s %s\n", t->name, ok ? (update ? "更新" : "ok") : "失敗");
+        failed += !ok;
+    }
+    remove(TONE_500);
+    remove(TONE_1000);
+    remove(TONE_LOOP);
+    free(out);
+    free(again);
+    free(sum);
+    return failed ? 1 : 0;
+}
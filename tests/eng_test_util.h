@@ -0,0 +1,79 @@
+/**
+ * tests/eng_test_util.h — テストとベンチマークの共通部品
+ *
+ * 素材の WAV の書き出し、時計、使い方の表示、ヘッドレスのエンジンからブロックを
+ * 引き出して時間を測るループ。tests/ と bench/ の各プログラムが取り込む (ヘッダだけで完結)。
+ *
+ * Copyright (c) 2026 Reo Shiozawa — MIT License
+ */
+#pragma once
+#include "eng_audio.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ENG_TEST_TAU 6.283185307179586
+
+/* 素材の波形。frame フレーム目、channel チャンネル目の値 (-1〜1) を返す。 */
+typedef double (*EngTestWave)(uint32_t frame, uint32_t channel, void* user);
+
+static inline double eng_test_now_ns(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* "使い方: <args>" を出して終了する。 */
+static inline void eng_test_usage(const char* args) {
+    fprintf(stderr, "使い方: %s\n", args);
+    exit(1);
+}
+
+static inline void eng_test_put_u16(FILE* f, uint16_t v) { fputc(v & 0xFF, f); fputc(v >> 8, f); }
+static inline void eng_test_put_u32(FILE* f, uint32_t v) {
+    eng_test_put_u16(f, (uint16_t)(v & 0xFFFF));
+    eng_test_put_u16(f, (uint16_t)(v >> 16));
+}
+
+/*
+ * wave の波形で WAV を書き出す。is_float=true で 32bit float、false で 16bit 整数
+ * (値 × 32768 を丸めて 32767 で頭打ち)。失敗時は 0。
+ */
+static inline int eng_test_write_wav(const char* path, uint32_t rate, uint16_t channels, uint32_t frames,
+                                     bool is_float, EngTestWave wave, void* user) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return 0;
+    uint16_t bps   = is_float ? 4 : 2;
+    uint32_t bytes = frames * channels * bps;
+    fwrite("RIFF", 1, 4, f); eng_test_put_u32(f, 36 + bytes); fwrite("WAVE", 1, 4, f);
+    fwrite("fmt ", 1, 4, f); eng_test_put_u32(f, 16);
+    eng_test_put_u16(f, is_float ? 3 : 1); eng_test_put_u16(f, channels); eng_test_put_u32(f, rate);
+    eng_test_put_u32(f, rate * channels * bps); eng_test_put_u16(f, (uint16_t)(channels * bps));
+    eng_test_put_u16(f, (uint16_t)(8 * bps));
+    fwrite("data", 1, 4, f); eng_test_put_u32(f, bytes);
+    for (uint32_t i = 0; i < frames; ++i) {
+        for (uint16_t c = 0; c < channels; ++c) {
+            double v = wave(i, c, user);
+            if (is_float) {
+                float    s = (float)v;
+                uint32_t bits;
+                memcpy(&bits, &s, sizeof(bits));
+                eng_test_put_u32(f, bits);
+            } else {
+                long s = lrint(v * 32768.0);
+                eng_test_put_u16(f, (uint16_t)(int16_t)(s > 32767 ? 32767 : s < -32768 ? -32768 : s));
+            }
+        }
+    }
+    return fclose(f) == 0;
+}
+
+/* warmup ブロック慣らしてから blocks ブロック分を引き出し、1 ブロックあたりの時間 (ns) を返す。 */
+static inline double eng_test_run(ENG_Audio* a, float* out, uint32_t block, uint32_t blocks, uint32_t warmup) {
+    for (uint32_t i = 0; i < warmup; ++i) eng_audio_render(a, out, block);
+    double t0 = eng_test_now_ns();
+    for (uint32_t b = 0; b < blocks; ++b) eng_audio_render(a, out, block);
+    return (eng_test_now_ns() - t0) / (double)blocks;
+}
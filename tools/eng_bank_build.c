@@ -0,0 +1,264 @@
+/**
+ * tools/eng_bank_build.c — サウンドバンク (.bank) ビルダー
+ *
+ * 複数の音声ファイルをデコードして 1 つのバンクにまとめる。
+ * 形式は src/eng_bank_format.h を参照。
+ *
+ *   eng_bank_build [-r レート] [-f f32|s16|encoded] [-l リスト] -o 出力.bank ファイル...
+ *
+ *   -r  PCM を揃えるサンプルレート (既定 48000, 0 = 元のまま)
+ *   -f  格納形式 (既定 f32。encoded は元ファイルをそのまま入れ、読込時にデコード)
+ *   -l  1 行 1 パスのリストファイルから入力を追加する
+ *
+ * エントリ名は引数に渡したパスそのもの (区切りは '/' に統一)。
+ * ゲーム側は eng_se_load に同じパスを渡せばバンクから読まれる。
+ *
+ * Copyright (c) 2026 Reo Shiozawa — MIT License
+ */
+#define MINIAUDIO_IMPLEMENTATION
+#define MA_NO_DEVICE_IO
+#include "miniaudio.h"
+
+#include "eng_bank_format.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DECODE_CHUNK 4096 /* 1 回にデコードするフレーム数 */
+
+typedef struct {
+    char*    name;
+    char*    path;
+    uint32_t channels;
+    uint32_t sample_rate;
+    uint64_t frame_count;
+    void*    data;
+    uint64_t size;
+} Item;
+
+typedef struct {
+    Item*  items;
+    size_t count;
+    size_t cap;
+} ItemList;
+
+static void die(const char* msg, const char* arg) {
+    fprintf(stderr, "[eng_bank_build] %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+    exit(1);
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "使い方: eng_bank_build [-r レート] [-f f32|s16|encoded] [-l リスト] -o 出力.bank ファイル...\n");
+    exit(1);
+}
+
+static void add_item(ItemList* l, const char* path) {
+    if (l->count == l->cap) {
+        l->cap   = l->cap ? l->cap * 2 : 64;
+        l->items = realloc(l->items, sizeof(Item) * l->cap);
+        if (!l->items) die("メモリ不足", NULL);
+    }
+    Item* it = &l->items[l->count++];
+    memset(it, 0, sizeof(*it));
+    it->path = strdup(path);
+    it->name = strdup(path);
+    if (!it->path || !it->name) die("メモリ不足", NULL);
+    for (char* p = it->name; *p; ++p)
+        if (*p == '\\') *p = '/';
+}
+
+static void add_list(ItemList* l, const char* list_path) {
+    FILE* f = fopen(list_path, "r");
+    if (!f) die("リストを開けない", list_path);
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        size_t n = strcspn(line, "\r\n");
+        line[n] = '\0';
+        if (n > 0 && line[0] != '#') add_item(l, line);
+    }
+    fclose(f);
+}
+
+/* ファイルを丸ごと読む (encoded 用)。 */
+static void load_encoded(Item* it) {
+    FILE* f = fopen(it->path, "rb");
+    if (!f) die("開けない", it->path);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size <= 0) die("空のファイル", it->path);
+    it->data = malloc((size_t)size);
+    if (!it->data) die("メモリ不足", NULL);
+    if (fread(it->data, 1, (size_t)size, f) != (size_t)size) die("読めない", it->path);
+    fclose(f);
+    it->size = (uint64_t)size;
+}
+
+/* 指定形式・レートにデコードする。長さの分からない形式もあるので伸ばしながら読む。 */
+static void load_pcm(Item* it, ma_format fmt, uint32_t rate) {
+    ma_decoder_config dc = ma_decoder_config_init(fmt, 0, rate);
+    ma_decoder dec;
+    ma_result r = ma_decoder_init_file(it->path, &dc, &dec);
+    if (r != MA_SUCCESS) die("デコードできない", it->path);
+    it->channels    = dec.outputChannels;
+    it->sample_rate = dec.outputSampleRate;
+    size_t   frame_bytes = ma_get_bytes_per_frame(fmt, it->channels);
+    ma_uint64 cap        = 0;
+    ma_decoder_get_length_in_pcm_frames(&dec, &cap);
+    if (cap == 0) cap = DECODE_CHUNK;
+    unsigned char* buf = malloc((size_t)cap * frame_bytes);
+    if (!buf) die("メモリ不足", NULL);
+    uint64_t frames = 0;
+    for (;;) {
+        if (frames + DECODE_CHUNK > cap) {
+            cap = (frames + DECODE_CHUNK) * 2;
+            buf = realloc(buf, (size_t)cap * frame_bytes);
+            if (!buf) die("メモリ不足", NULL);
+        }
+        ma_uint64 got = 0;
+        r = ma_decoder_read_pcm_frames(&dec, buf + frames * frame_bytes, DECODE_CHUNK, &got);
+        frames += got;
+        if (r != MA_SUCCESS || got == 0) break;
+    }
+    ma_decoder_uninit(&dec);
+    if (frames == 0) die("音声データがない", it->path);
+    it->data        = buf;
+    it->frame_count = frames;
+    it->size        = frames * frame_bytes;
+}
+
+static uint64_t align_up(uint64_t v, uint64_t a) {
+    return (v + a - 1) / a * a;
+}
+
+static void write_zeros(FILE* f, uint64_t n) {
+    static const unsigned char zeros[ENG_BANK_ALIGN];
+    while (n > 0) {
+        size_t k = n > sizeof(zeros) ? sizeof(zeros) : (size_t)n;
+        fwrite(zeros, 1, k, f);
+        n -= k;
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* out    = NULL;
+    uint32_t    rate   = 48000;
+    uint32_t    format = ENG_BANK_PCM_F32;
+    ItemList    list   = {0};
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (a[0] == '-' && a[1] && !a[2] && i + 1 < argc) {
+            const char* v = argv[++i];
+            switch (a[1]) {
+            case 'o': out = v; break;
+            case 'r': rate = (uint32_t)strtoul(v, NULL, 10); break;
+            case 'l': add_list(&list, v); break;
+            case 'f':
+                if      (strcmp(v, "f32") == 0)     format = ENG_BANK_PCM_F32;
+                else if (strcmp(v, "s16") == 0)     format = ENG_BANK_PCM_S16;
+                else if (strcmp(v, "encoded") == 0) format = ENG_BANK_ENCODED;
+                else die("不明な形式", v);
+                break;
+            default: usage();
+            }
+        } else if (a[0] == '-') {
+            usage();
+        } else {
+            add_item(&list, a);
+        }
+    }
+    if (!out || list.count == 0) usage();
+    if (list.count > UINT32_MAX / 2) die("エントリが多すぎる", NULL);
+
+    /* 読込 */
+    for (size_t i = 0; i < list.count; ++i) {
+        if (format == ENG_BANK_ENCODED) load_encoded(&list.items[i]);
+        else load_pcm(&list.items[i], format == ENG_BANK_PCM_F32 ? ma_format_f32 : ma_format_s16, rate);
+    }
+
+    /* ハッシュ表 (埋まりを半分以下に保つ) */
+    uint32_t entry_count  = (uint32_t)list.count;
+    uint32_t bucket_count = 1;
+    while (bucket_count < entry_count * 2) bucket_count <<= 1;
+    uint32_t* buckets = calloc(bucket_count, sizeof(uint32_t));
+    if (!buckets) die("メモリ不足", NULL);
+    for (uint32_t i = 0; i < entry_count; ++i) {
+        uint32_t h = eng_bank_hash(list.items[i].name);
+        uint32_t b = h & (bucket_count - 1);
+        while (buckets[b]) {
+            if (strcmp(list.items[buckets[b] - 1].name, list.items[i].name) == 0)
+                die("名前が重複している", list.items[i].name);
+            b = (b + 1) & (bucket_count - 1);
+        }
+        buckets[b] = i + 1;
+    }
+
+    /* 配置 */
+    uint64_t names_size = 0;
+    for (uint32_t i = 0; i < entry_count; ++i) names_size += strlen(list.items[i].name) + 1;
+    if (names_size > UINT32_MAX) die("名前表が大きすぎる", NULL);
+
+    ENG_BankHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic          = ENG_BANK_MAGIC;
+    hdr.version        = ENG_BANK_VERSION;
+    hdr.sample_rate    = format == ENG_BANK_ENCODED ? 0 : rate;
+    hdr.entry_count    = entry_count;
+    hdr.bucket_count   = bucket_count;
+    hdr.names_size     = (uint32_t)names_size;
+    hdr.entries_offset = sizeof(ENG_BankHeader);
+    hdr.buckets_offset = hdr.entries_offset + (uint64_t)entry_count * sizeof(ENG_BankEntry);
+    hdr.names_offset   = hdr.buckets_offset + (uint64_t)bucket_count * sizeof(uint32_t);
+
+    ENG_BankEntry* entries = calloc(entry_count, sizeof(ENG_BankEntry));
+    if (!entries) die("メモリ不足", NULL);
+    uint64_t name_off = 0;
+    uint64_t data_off = align_up(hdr.names_offset + names_size, ENG_BANK_ALIGN);
+    for (uint32_t i = 0; i < entry_count; ++i) {
+        const Item* it = &list.items[i];
+        ENG_BankEntry* e = &entries[i];
+        e->name_hash   = eng_bank_hash(it->name);
+        e->name_offset = (uint32_t)name_off;
+        e->format      = format;
+        e->channels    = it->channels;
+        e->sample_rate = it->sample_rate;
+        e->frame_count = it->frame_count;
+        e->data_offset = data_off;
+        e->data_size   = it->size;
+        name_off += strlen(it->name) + 1;
+        data_off  = align_up(data_off + it->size, ENG_BANK_ALIGN);
+    }
+    hdr.file_size = data_off;
+
+    /* 書き出し */
+    FILE* f = fopen(out, "wb");
+    if (!f) die("書き込めない", out);
+    fwrite(&hdr, sizeof(hdr), 1, f);
+    fwrite(entries, sizeof(ENG_BankEntry), entry_count, f);
+    fwrite(buckets, sizeof(uint32_t), bucket_count, f);
+    for (uint32_t i = 0; i < entry_count; ++i)
+        fwrite(list.items[i].name, 1, strlen(list.items[i].name) + 1, f);
+    uint64_t pos = hdr.names_offset + names_size;
+    for (uint32_t i = 0; i < entry_count; ++i) {
+        write_zeros(f, entries[i].data_offset - pos);
+        fwrite(list.items[i].data, 1, (size_t)entries[i].data_size, f);
+        pos = entries[i].data_offset + entries[i].data_size;
+    }
+    write_zeros(f, hdr.file_size - pos);
+    if (fclose(f) != 0) die("書き込み失敗", out);
+
+    printf("[eng_bank_build] %s: %u エントリ, %.1f MiB\n",
+           out, entry_count, (double)hdr.file_size / (1024.0 * 1024.0));
+
+    for (size_t i = 0; i < list.count; ++i) {
+        free(list.items[i].name);
+        free(list.items[i].path);
+        free(list.items[i].data);
+    }
+    free(list.items);
+    free(entries);
+    free(buckets);
+    return 0;
+}